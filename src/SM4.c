@@ -12,6 +12,11 @@ Function List:
      1. SM4_KeySchedule     //Generate the required round keys
      2. SM4_Encrypt         //Encryption fuction
      3. SM4_Decrypt         //Decryption fuction
+     4. SM4_SetEncKey       //Expand a key for encryption
+     5. SM4_SetDecKey       //Expand a key for decryption
+     6. SM4_CryptBlocks     //Process blocks with an expanded key, widest kernel available
+     7. SM4_Ctr32Blocks     //Encrypt counter blocks and xor them into the data
+     8. SM4_CryptJobs       //Process a few blocks under each of many keys
 History:
      Date:Sep 13,2016
      Author:Mao Yingying,Huo Lili
@@ -21,6 +26,76 @@ History:
 
 #include "SM4.h"
 
+#include <string.h>
+#ifdef SM4_X86
+#include <immintrin.h>
+#endif
+
+unsigned int SM4_CK[32] = {
+	0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269,
+	0x70777e85, 0x8c939aa1, 0xa8afb6bd, 0xc4cbd2d9,
+	0xe0e7eef5, 0xfc030a11, 0x181f262d, 0x343b4249,
+	0x50575e65, 0x6c737a81, 0x888f969d, 0xa4abb2b9,
+	0xc0c7ced5, 0xdce3eaf1, 0xf8ff060d, 0x141b2229,
+	0x30373e45, 0x4c535a61, 0x686f767d, 0x848b9299,
+	0xa0a7aeb5, 0xbcc3cad1, 0xd8dfe6ed, 0xf4fb0209,
+	0x10171e25, 0x2c333a41, 0x484f565d, 0x646b7279};
+
+unsigned char SM4_Sbox[256] = {
+	0xd6, 0x90, 0xe9, 0xfe, 0xcc, 0xe1, 0x3d, 0xb7, 0x16, 0xb6, 0x14, 0xc2, 0x28, 0xfb, 0x2c, 0x05,
+	0x2b, 0x67, 0x9a, 0x76, 0x2a, 0xbe, 0x04, 0xc3, 0xaa, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
+	0x9c, 0x42, 0x50, 0xf4, 0x91, 0xef, 0x98, 0x7a, 0x33, 0x54, 0x0b, 0x43, 0xed, 0xcf, 0xac, 0x62,
+	0xe4, 0xb3, 0x1c, 0xa9, 0xc9, 0x08, 0xe8, 0x95, 0x80, 0xdf, 0x94, 0xfa, 0x75, 0x8f, 0x3f, 0xa6,
+	0x47, 0x07, 0xa7, 0xfc, 0xf3, 0x73, 0x17, 0xba, 0x83, 0x59, 0x3c, 0x19, 0xe6, 0x85, 0x4f, 0xa8,
+	0x68, 0x6b, 0x81, 0xb2, 0x71, 0x64, 0xda, 0x8b, 0xf8, 0xeb, 0x0f, 0x4b, 0x70, 0x56, 0x9d, 0x35,
+	0x1e, 0x24, 0x0e, 0x5e, 0x63, 0x58, 0xd1, 0xa2, 0x25, 0x22, 0x7c, 0x3b, 0x01, 0x21, 0x78, 0x87,
+	0xd4, 0x00, 0x46, 0x57, 0x9f, 0xd3, 0x27, 0x52, 0x4c, 0x36, 0x02, 0xe7, 0xa0, 0xc4, 0xc8, 0x9e,
+	0xea, 0xbf, 0x8a, 0xd2, 0x40, 0xc7, 0x38, 0xb5, 0xa3, 0xf7, 0xf2, 0xce, 0xf9, 0x61, 0x15, 0xa1,
+	0xe0, 0xae, 0x5d, 0xa4, 0x9b, 0x34, 0x1a, 0x55, 0xad, 0x93, 0x32, 0x30, 0xf5, 0x8c, 0xb1, 0xe3,
+	0x1d, 0xf6, 0xe2, 0x2e, 0x82, 0x66, 0xca, 0x60, 0xc0, 0x29, 0x23, 0xab, 0x0d, 0x53, 0x4e, 0x6f,
+	0xd5, 0xdb, 0x37, 0x45, 0xde, 0xfd, 0x8e, 0x2f, 0x03, 0xff, 0x6a, 0x72, 0x6d, 0x6c, 0x5b, 0x51,
+	0x8d, 0x1b, 0xaf, 0x92, 0xbb, 0xdd, 0xbc, 0x7f, 0x11, 0xd9, 0x5c, 0x41, 0x1f, 0x10, 0x5a, 0xd8,
+	0x0a, 0xc1, 0x31, 0x88, 0xa5, 0xcd, 0x7b, 0xbd, 0x2d, 0x74, 0xd0, 0x12, 0xb8, 0xe5, 0xb4, 0xb0,
+	0x89, 0x69, 0x97, 0x4a, 0x0c, 0x96, 0x77, 0x7e, 0x65, 0xb9, 0xf1, 0x09, 0xc5, 0x6e, 0xc6, 0x84,
+	0x18, 0xf0, 0x7d, 0xec, 0x3a, 0xdc, 0x4d, 0x20, 0x79, 0xee, 0x5f, 0x3e, 0xd7, 0xcb, 0x39, 0x48};
+
+unsigned int SM4_FK[4] = {0xA3B1BAC6, 0x56AA3350, 0x677D9197, 0xB27022DC};
+
+//SM4_T[a]=L(Sbox(a)<<24),the other bytes of the round function input are handled by rotation
+unsigned int SM4_T[256] = {
+	0x8ed55b5b, 0xd0924242, 0x4deaa7a7, 0x06fdfbfb, 0xfccf3333, 0x65e28787, 0xc93df4f4, 0x6bb5dede,
+	0x4e165858, 0x6eb4dada, 0x44145050, 0xcac10b0b, 0x8828a0a0, 0x17f8efef, 0x9c2cb0b0, 0x11051414,
+	0x872bacac, 0xfb669d9d, 0xf2986a6a, 0xae77d9d9, 0x822aa8a8, 0x46bcfafa, 0x14041010, 0xcfc00f0f,
+	0x02a8aaaa, 0x54451111, 0x5f134c4c, 0xbe269898, 0x6d482525, 0x9e841a1a, 0x1e061818, 0xfd9b6666,
+	0xec9e7272, 0x4a430909, 0x10514141, 0x24f7d3d3, 0xd5934646, 0x53ecbfbf, 0xf89a6262, 0x927be9e9,
+	0xff33cccc, 0x04555151, 0x270b2c2c, 0x4f420d0d, 0x59eeb7b7, 0xf3cc3f3f, 0x1caeb2b2, 0xea638989,
+	0x74e79393, 0x7fb1cece, 0x6c1c7070, 0x0daba6a6, 0xedca2727, 0x28082020, 0x48eba3a3, 0xc1975656,
+	0x80820202, 0xa3dc7f7f, 0xc4965252, 0x12f9ebeb, 0xa174d5d5, 0xb38d3e3e, 0xc33ffcfc, 0x3ea49a9a,
+	0x5b461d1d, 0x1b071c1c, 0x3ba59e9e, 0x0cfff3f3, 0x3ff0cfcf, 0xbf72cdcd, 0x4b175c5c, 0x52b8eaea,
+	0x8f810e0e, 0x3d586565, 0xcc3cf0f0, 0x7d196464, 0x7ee59b9b, 0x91871616, 0x734e3d3d, 0x08aaa2a2,
+	0xc869a1a1, 0xc76aadad, 0x85830606, 0x7ab0caca, 0xb570c5c5, 0xf4659191, 0xb2d96b6b, 0xa7892e2e,
+	0x18fbe3e3, 0x47e8afaf, 0x330f3c3c, 0x674a2d2d, 0xb071c1c1, 0x0e575959, 0xe99f7676, 0xe135d4d4,
+	0x661e7878, 0xb4249090, 0x360e3838, 0x265f7979, 0xef628d8d, 0x38596161, 0x95d24747, 0x2aa08a8a,
+	0xb1259494, 0xaa228888, 0x8c7df1f1, 0xd73becec, 0x05010404, 0xa5218484, 0x9879e1e1, 0x9b851e1e,
+	0x84d75353, 0x00000000, 0x5e471919, 0x0b565d5d, 0xe39d7e7e, 0x9fd04f4f, 0xbb279c9c, 0x1a534949,
+	0x7c4d3131, 0xee36d8d8, 0x0a020808, 0x7be49f9f, 0x20a28282, 0xd4c71313, 0xe8cb2323, 0xe69c7a7a,
+	0x42e9abab, 0x43bdfefe, 0xa2882a2a, 0x9ad14b4b, 0x40410101, 0xdbc41f1f, 0xd838e0e0, 0x61b7d6d6,
+	0x2fa18e8e, 0x2bf4dfdf, 0x3af1cbcb, 0xf6cd3b3b, 0x1dfae7e7, 0xe5608585, 0x41155454, 0x25a38686,
+	0x60e38383, 0x16acbaba, 0x295c7575, 0x34a69292, 0xf7996e6e, 0xe434d0d0, 0x721a6868, 0x01545555,
+	0x19afb6b6, 0xdf914e4e, 0xfa32c8c8, 0xf030c0c0, 0x21f6d7d7, 0xbc8e3232, 0x75b3c6c6, 0x6fe08f8f,
+	0x691d7474, 0x2ef5dbdb, 0x6ae18b8b, 0x962eb8b8, 0x8a800a0a, 0xfe679999, 0xe2c92b2b, 0xe0618181,
+	0xc0c30303, 0x8d29a4a4, 0xaf238c8c, 0x07a9aeae, 0x390d3434, 0x1f524d4d, 0x764f3939, 0xd36ebdbd,
+	0x81d65757, 0xb7d86f6f, 0xeb37dcdc, 0x51441515, 0xa6dd7b7b, 0x09fef7f7, 0xb68c3a3a, 0x932fbcbc,
+	0x0f030c0c, 0x03fcffff, 0xc26ba9a9, 0xba73c9c9, 0xd96cb5b5, 0xdc6db1b1, 0x375a6d6d, 0x15504545,
+	0xb98f3636, 0x771b6c6c, 0x13adbebe, 0xda904a4a, 0x57b9eeee, 0xa9de7777, 0x4cbef2f2, 0x837efdfd,
+	0x55114444, 0xbdda6767, 0x2c5d7171, 0x45400505, 0x631f7c7c, 0x50104040, 0x325b6969, 0xb8db6363,
+	0x220a2828, 0xc5c20707, 0xf531c4c4, 0xa88a2222, 0x31a79696, 0xf9ce3737, 0x977aeded, 0x49bff6f6,
+	0x992db4b4, 0xa475d1d1, 0x90d34343, 0x5a124848, 0x58bae2e2, 0x71e69797, 0x64b6d2d2, 0x70b2c2c2,
+	0xad8b2626, 0xcd68a5a5, 0xcb955e5e, 0x624b2929, 0x3c0c3030, 0xce945a5a, 0xab76dddd, 0x867ff9f9,
+	0xf1649595, 0x5dbbe6e6, 0x35f2c7c7, 0x2d092424, 0xd1c61717, 0xd66fb9b9, 0xdec51b1b, 0x94861212,
+	0x78186060, 0x30f3c3c3, 0x897cf5f5, 0x5cefb3b3, 0xd23ae8e8, 0xacdf7373, 0x794c3535, 0xa0208080,
+	0x9d78e5e5, 0x56edbbbb, 0x235e7d7d, 0xc63ef8f8, 0x8bd45f5f, 0xe7c82f2f, 0xdd39e4e4, 0x68492121};
+
 /************************************************************
 Function:
          void SM4_KeySchedule(unsigned char MK[], unsigned int rk[]);
@@ -153,6 +228,693 @@ void SM4_Decrypt(unsigned char MK[], unsigned char CipherText[], unsigned char P
 	}
 }
 
+/************************************************************
+Function:
+         void SM4_SetEncKey(unsigned char MK[], SM4_KEY *key);
+Description:
+         Expand a master key once for encryption
+Calls:
+         SM4_KeySchedule
+Called By:
+Input:
+         MK[]: Master key
+Output:
+         key: expanded key
+Return:null
+Others:
+************************************************************/
+void SM4_SetEncKey(unsigned char MK[], SM4_KEY *key)
+{
+	SM4_KeySchedule(MK, key->rk);
+}
+
+/************************************************************
+Function:
+         void SM4_SetDecKey(unsigned char MK[], SM4_KEY *key);
+Description:
+         Expand a master key once for decryption
+Calls:
+         SM4_KeySchedule
+Called By:
+Input:
+         MK[]: Master key
+Output:
+         key: expanded key with the round keys reversed
+Return:null
+Others:
+************************************************************/
+void SM4_SetDecKey(unsigned char MK[], SM4_KEY *key)
+{
+	unsigned int rk[32];
+	int i;
+
+	SM4_KeySchedule(MK, rk);
+	for (i = 0; i < 32; i++)
+		key->rk[i] = rk[31 - i];
+}
+
+//nonlinear and linear operation of one round through the SM4_T table
+#define SM4_TL(x) (SM4_T[(x) >> 24] ^ SM4_Rotl32(SM4_T[((x) >> 16) & 0xFF], 24) ^ SM4_Rotl32(SM4_T[((x) >> 8) & 0xFF], 16) ^ SM4_Rotl32(SM4_T[(x) & 0xFF], 8))
+
+/************************************************************
+Function:
+         static void SM4_Crypt1(const unsigned int rk[], unsigned int X[]);
+Description:
+         32 rounds over one block kept as four words
+Calls:
+Called By:
+         SM4_CryptBlocks;
+         SM4_Ctr32Blocks
+Input:
+         rk[]: round keys
+         X[]: X0,X1,X2,X3
+Output:
+         X[]: X35,X34,X33,X32
+Return:null
+Others:
+************************************************************/
+static void SM4_Crypt1(const unsigned int rk[], unsigned int X[])
+{
+	unsigned int x0 = X[0], x1 = X[1], x2 = X[2], x3 = X[3], tmp;
+	int i;
+
+	for (i = 0; i < 32; i += 4)
+	{
+		tmp = x1 ^ x2 ^ x3 ^ rk[i];
+		x0 ^= SM4_TL(tmp);
+		tmp = x2 ^ x3 ^ x0 ^ rk[i + 1];
+		x1 ^= SM4_TL(tmp);
+		tmp = x3 ^ x0 ^ x1 ^ rk[i + 2];
+		x2 ^= SM4_TL(tmp);
+		tmp = x0 ^ x1 ^ x2 ^ rk[i + 3];
+		x3 ^= SM4_TL(tmp);
+	}
+
+	X[0] = x3;
+	X[1] = x2;
+	X[2] = x1;
+	X[3] = x0;
+}
+
+/************************************************************
+Function:
+         static void SM4_Crypt2(const unsigned int rk[], unsigned int X[], unsigned int Y[]);
+Description:
+         32 rounds over two independent blocks, the rounds of both
+         blocks are interleaved so their latencies overlap
+Calls:
+Called By:
+         SM4_CryptBlocks;
+         SM4_Ctr32Blocks
+Input:
+         rk[]: round keys
+         X[],Y[]: X0,X1,X2,X3 of each block
+Output:
+         X[],Y[]: X35,X34,X33,X32 of each block
+Return:null
+Others:
+************************************************************/
+static void SM4_Crypt2(const unsigned int rk[], unsigned int X[], unsigned int Y[])
+{
+	unsigned int x0 = X[0], x1 = X[1], x2 = X[2], x3 = X[3];
+	unsigned int y0 = Y[0], y1 = Y[1], y2 = Y[2], y3 = Y[3];
+	unsigned int t, u;
+	int i;
+
+	for (i = 0; i < 32; i += 4)
+	{
+		t = x1 ^ x2 ^ x3 ^ rk[i];
+		u = y1 ^ y2 ^ y3 ^ rk[i];
+		x0 ^= SM4_TL(t);
+		y0 ^= SM4_TL(u);
+		t = x2 ^ x3 ^ x0 ^ rk[i + 1];
+		u = y2 ^ y3 ^ y0 ^ rk[i + 1];
+		x1 ^= SM4_TL(t);
+		y1 ^= SM4_TL(u);
+		t = x3 ^ x0 ^ x1 ^ rk[i + 2];
+		u = y3 ^ y0 ^ y1 ^ rk[i + 2];
+		x2 ^= SM4_TL(t);
+		y2 ^= SM4_TL(u);
+		t = x0 ^ x1 ^ x2 ^ rk[i + 3];
+		u = y0 ^ y1 ^ y2 ^ rk[i + 3];
+		x3 ^= SM4_TL(t);
+		y3 ^= SM4_TL(u);
+	}
+
+	X[0] = x3;
+	X[1] = x2;
+	X[2] = x1;
+	X[3] = x0;
+	Y[0] = y3;
+	Y[1] = y2;
+	Y[2] = y1;
+	Y[3] = y0;
+}
+
+#ifdef SM4_X86
+
+/*
+ * The SIMD kernels keep word j of every block in lane i of register Xj,
+ * so one round is four table gathers for all the blocks at once. Blocks
+ * are loaded as 16 byte lanes and transposed 4x4 inside each 128bit lane,
+ * which leaves block b of an 8 (16) block group in the dword position
+ * given by SM4_LANE8 (SM4_LANE16).
+ */
+static const int SM4_LANE8[8] = {0, 2, 4, 6, 1, 3, 5, 7};
+static const int SM4_LANE16[16] = {0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15};
+
+#define SM4_BSWAP32_MASK 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+
+__attribute__((target("avx2"))) static inline __m256i SM4_TL_AVX2(__m256i x)
+{
+	const __m256i m = _mm256_set1_epi32(0xFF);
+	__m256i t0, t1, t2, t3;
+
+	t0 = _mm256_i32gather_epi32((const int *)SM4_T, _mm256_srli_epi32(x, 24), 4);
+	t1 = _mm256_i32gather_epi32((const int *)SM4_T, _mm256_and_si256(_mm256_srli_epi32(x, 16), m), 4);
+	t2 = _mm256_i32gather_epi32((const int *)SM4_T, _mm256_and_si256(_mm256_srli_epi32(x, 8), m), 4);
+	t3 = _mm256_i32gather_epi32((const int *)SM4_T, _mm256_and_si256(x, m), 4);
+	t1 = _mm256_or_si256(_mm256_srli_epi32(t1, 8), _mm256_slli_epi32(t1, 24));
+	t2 = _mm256_or_si256(_mm256_srli_epi32(t2, 16), _mm256_slli_epi32(t2, 16));
+	t3 = _mm256_or_si256(_mm256_srli_epi32(t3, 24), _mm256_slli_epi32(t3, 8));
+	return _mm256_xor_si256(_mm256_xor_si256(t0, t1), _mm256_xor_si256(t2, t3));
+}
+
+#define SM4_ROUND_AVX2(a, b, c, d, k) \
+	a = _mm256_xor_si256(a, SM4_TL_AVX2(_mm256_xor_si256(_mm256_xor_si256(b, c), _mm256_xor_si256(d, _mm256_set1_epi32(k)))))
+
+__attribute__((target("avx2"))) static inline void SM4_Transpose_AVX2(__m256i X[])
+{
+	__m256i t0, t1, t2, t3;
+
+	t0 = _mm256_unpacklo_epi32(X[0], X[1]);
+	t1 = _mm256_unpackhi_epi32(X[0], X[1]);
+	t2 = _mm256_unpacklo_epi32(X[2], X[3]);
+	t3 = _mm256_unpackhi_epi32(X[2], X[3]);
+	X[0] = _mm256_unpacklo_epi64(t0, t2);
+	X[1] = _mm256_unpackhi_epi64(t0, t2);
+	X[2] = _mm256_unpacklo_epi64(t1, t3);
+	X[3] = _mm256_unpackhi_epi64(t1, t3);
+}
+
+//32 rounds over 8 transposed blocks, X[] ends up as X35,X34,X33,X32 in block order
+__attribute__((target("avx2"))) static void SM4_Rounds_AVX2(const unsigned int rk[], __m256i X[])
+{
+	const __m256i bswap = _mm256_setr_epi8(SM4_BSWAP32_MASK, SM4_BSWAP32_MASK);
+	__m256i x0 = X[0], x1 = X[1], x2 = X[2], x3 = X[3];
+	int i;
+
+	for (i = 0; i < 32; i += 4)
+	{
+		SM4_ROUND_AVX2(x0, x1, x2, x3, rk[i]);
+		SM4_ROUND_AVX2(x1, x2, x3, x0, rk[i + 1]);
+		SM4_ROUND_AVX2(x2, x3, x0, x1, rk[i + 2]);
+		SM4_ROUND_AVX2(x3, x0, x1, x2, rk[i + 3]);
+	}
+
+	X[0] = x3;
+	X[1] = x2;
+	X[2] = x1;
+	X[3] = x0;
+	SM4_Transpose_AVX2(X);
+	for (i = 0; i < 4; i++)
+		X[i] = _mm256_shuffle_epi8(X[i], bswap);
+}
+
+__attribute__((target("avx2"))) static void SM4_CryptBlocks8_AVX2(const unsigned int rk[], const unsigned char in[], unsigned char out[], size_t blocks)
+{
+	const __m256i bswap = _mm256_setr_epi8(SM4_BSWAP32_MASK, SM4_BSWAP32_MASK);
+	__m256i X[4];
+	int i;
+
+	for (; blocks >= 8; blocks -= 8, in += 128, out += 128)
+	{
+		for (i = 0; i < 4; i++)
+			X[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in + 32 * i)), bswap);
+		SM4_Transpose_AVX2(X);
+		SM4_Rounds_AVX2(rk, X);
+		for (i = 0; i < 4; i++)
+			_mm256_storeu_si256((__m256i *)(out + 32 * i), X[i]);
+	}
+}
+
+__attribute__((target("avx2"))) static void SM4_Ctr32Blocks8_AVX2(const unsigned int rk[], const unsigned char in[], unsigned char out[], size_t blocks, const unsigned int W[])
+{
+	const __m256i lane = _mm256_loadu_si256((const __m256i *)SM4_LANE8);
+	__m256i X[4], ctr = _mm256_add_epi32(_mm256_set1_epi32(W[3]), lane);
+	int i;
+
+	for (; blocks >= 8; blocks -= 8, in += 128, out += 128)
+	{
+		X[0] = _mm256_set1_epi32(W[0]);
+		X[1] = _mm256_set1_epi32(W[1]);
+		X[2] = _mm256_set1_epi32(W[2]);
+		X[3] = ctr;
+		ctr = _mm256_add_epi32(ctr, _mm256_set1_epi32(8));
+		SM4_Rounds_AVX2(rk, X);
+		for (i = 0; i < 4; i++)
+			_mm256_storeu_si256((__m256i *)(out + 32 * i), _mm256_xor_si256(X[i], _mm256_loadu_si256((const __m256i *)(in + 32 * i))));
+	}
+}
+
+__attribute__((target("avx512f"))) static inline __m512i SM4_TL_AVX512(__m512i x)
+{
+	const __m512i m = _mm512_set1_epi32(0xFF);
+	__m512i t0, t1, t2, t3;
+
+	t0 = _mm512_i32gather_epi32(_mm512_srli_epi32(x, 24), SM4_T, 4);
+	t1 = _mm512_i32gather_epi32(_mm512_and_si512(_mm512_srli_epi32(x, 16), m), SM4_T, 4);
+	t2 = _mm512_i32gather_epi32(_mm512_and_si512(_mm512_srli_epi32(x, 8), m), SM4_T, 4);
+	t3 = _mm512_i32gather_epi32(_mm512_and_si512(x, m), SM4_T, 4);
+	return _mm512_ternarylogic_epi32(_mm512_xor_si512(t0, _mm512_ror_epi32(t1, 8)), _mm512_ror_epi32(t2, 16), _mm512_ror_epi32(t3, 24), 0x96);
+}
+
+#define SM4_ROUND_AVX512(a, b, c, d, k) \
+	a = _mm512_xor_si512(a, SM4_TL_AVX512(_mm512_ternarylogic_epi32(b, c, _mm512_xor_si512(d, _mm512_set1_epi32(k)), 0x96)))
+
+__attribute__((target("avx512f"))) static inline void SM4_Transpose_AVX512(__m512i X[])
+{
+	__m512i t0, t1, t2, t3;
+
+	t0 = _mm512_unpacklo_epi32(X[0], X[1]);
+	t1 = _mm512_unpackhi_epi32(X[0], X[1]);
+	t2 = _mm512_unpacklo_epi32(X[2], X[3]);
+	t3 = _mm512_unpackhi_epi32(X[2], X[3]);
+	X[0] = _mm512_unpacklo_epi64(t0, t2);
+	X[1] = _mm512_unpackhi_epi64(t0, t2);
+	X[2] = _mm512_unpacklo_epi64(t1, t3);
+	X[3] = _mm512_unpackhi_epi64(t1, t3);
+}
+
+//byte swap of every dword, AVX512F has no byte shuffle
+__attribute__((target("avx512f"))) static inline __m512i SM4_Bswap_AVX512(__m512i x)
+{
+	const __m512i m = _mm512_set1_epi32(0x00FF00FF);
+
+	x = _mm512_ror_epi32(x, 16);
+	return _mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(x, 8), m), _mm512_slli_epi32(_mm512_and_si512(x, m), 8));
+}
+
+//32 rounds over 16 transposed blocks, X[] ends up as X35,X34,X33,X32 in block order
+__attribute__((target("avx512f"))) static void SM4_Rounds_AVX512(const unsigned int rk[], __m512i X[])
+{
+	__m512i x0 = X[0], x1 = X[1], x2 = X[2], x3 = X[3];
+	int i;
+
+	for (i = 0; i < 32; i += 4)
+	{
+		SM4_ROUND_AVX512(x0, x1, x2, x3, rk[i]);
+		SM4_ROUND_AVX512(x1, x2, x3, x0, rk[i + 1]);
+		SM4_ROUND_AVX512(x2, x3, x0, x1, rk[i + 2]);
+		SM4_ROUND_AVX512(x3, x0, x1, x2, rk[i + 3]);
+	}
+
+	X[0] = x3;
+	X[1] = x2;
+	X[2] = x1;
+	X[3] = x0;
+	SM4_Transpose_AVX512(X);
+	for (i = 0; i < 4; i++)
+		X[i] = SM4_Bswap_AVX512(X[i]);
+}
+
+__attribute__((target("avx512f"))) static void SM4_CryptBlocks16_AVX512(const unsigned int rk[], const unsigned char in[], unsigned char out[], size_t blocks)
+{
+	__m512i X[4];
+	int i;
+
+	for (; blocks >= 16; blocks -= 16, in += 256, out += 256)
+	{
+		for (i = 0; i < 4; i++)
+			X[i] = SM4_Bswap_AVX512(_mm512_loadu_si512(in + 64 * i));
+		SM4_Transpose_AVX512(X);
+		SM4_Rounds_AVX512(rk, X);
+		for (i = 0; i < 4; i++)
+			_mm512_storeu_si512(out + 64 * i, X[i]);
+	}
+}
+
+__attribute__((target("avx512f"))) static void SM4_Ctr32Blocks16_AVX512(const unsigned int rk[], const unsigned char in[], unsigned char out[], size_t blocks, const unsigned int W[])
+{
+	const __m512i lane = _mm512_loadu_si512(SM4_LANE16);
+	__m512i X[4], ctr = _mm512_add_epi32(_mm512_set1_epi32(W[3]), lane);
+	int i;
+
+	for (; blocks >= 16; blocks -= 16, in += 256, out += 256)
+	{
+		X[0] = _mm512_set1_epi32(W[0]);
+		X[1] = _mm512_set1_epi32(W[1]);
+		X[2] = _mm512_set1_epi32(W[2]);
+		X[3] = ctr;
+		ctr = _mm512_add_epi32(ctr, _mm512_set1_epi32(16));
+		SM4_Rounds_AVX512(rk, X);
+		for (i = 0; i < 4; i++)
+			_mm512_storeu_si512(out + 64 * i, _mm512_xor_si512(X[i], _mm512_loadu_si512(in + 64 * i)));
+	}
+}
+
+/*
+ * Multi-key kernels: block i of the group takes its round keys from rk[i].
+ * The byte offsets of the key schedules from rk[0] are kept in 64bit
+ * lanes and the round keys are gathered from them, 4 bytes further on
+ * every round.
+ */
+#define SM4_ROUNDK_AVX2(a, b, c, d, k) \
+	a = _mm256_xor_si256(a, SM4_TL_AVX2(_mm256_xor_si256(_mm256_xor_si256(b, c), _mm256_xor_si256(d, k))))
+
+__attribute__((target("avx2"))) static void SM4_CryptLanes8_AVX2(const unsigned int *const rk[], unsigned char buf[])
+{
+	const __m256i bswap = _mm256_setr_epi8(SM4_BSWAP32_MASK, SM4_BSWAP32_MASK);
+	const __m256i four = _mm256_set1_epi64x(4);
+	long long off[8];
+	__m256i K[32], X[4], lo, hi, x0, x1, x2, x3;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		off[i] = (const char *)rk[SM4_LANE8[i]] - (const char *)rk[0];
+	lo = _mm256_loadu_si256((const __m256i *)off);
+	hi = _mm256_loadu_si256((const __m256i *)(off + 4));
+	for (i = 0; i < 32; i++)
+	{
+		K[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_i64gather_epi32((const int *)rk[0], lo, 1)),
+		                               _mm256_i64gather_epi32((const int *)rk[0], hi, 1), 1);
+		lo = _mm256_add_epi64(lo, four);
+		hi = _mm256_add_epi64(hi, four);
+	}
+
+	for (i = 0; i < 4; i++)
+		X[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(buf + 32 * i)), bswap);
+	SM4_Transpose_AVX2(X);
+	x0 = X[0];
+	x1 = X[1];
+	x2 = X[2];
+	x3 = X[3];
+	for (i = 0; i < 32; i += 4)
+	{
+		SM4_ROUNDK_AVX2(x0, x1, x2, x3, K[i]);
+		SM4_ROUNDK_AVX2(x1, x2, x3, x0, K[i + 1]);
+		SM4_ROUNDK_AVX2(x2, x3, x0, x1, K[i + 2]);
+		SM4_ROUNDK_AVX2(x3, x0, x1, x2, K[i + 3]);
+	}
+	X[0] = x3;
+	X[1] = x2;
+	X[2] = x1;
+	X[3] = x0;
+	SM4_Transpose_AVX2(X);
+	for (i = 0; i < 4; i++)
+		_mm256_storeu_si256((__m256i *)(buf + 32 * i), _mm256_shuffle_epi8(X[i], bswap));
+}
+
+#define SM4_ROUNDK_AVX512(a, b, c, d, k) \
+	a = _mm512_xor_si512(a, SM4_TL_AVX512(_mm512_ternarylogic_epi32(b, c, _mm512_xor_si512(d, k), 0x96)))
+
+__attribute__((target("avx512f"))) static void SM4_CryptLanes16_AVX512(const unsigned int *const rk[], unsigned char buf[])
+{
+	const __m512i four = _mm512_set1_epi64(4);
+	long long off[16];
+	__m512i K[32], X[4], lo, hi, x0, x1, x2, x3;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		off[i] = (const char *)rk[SM4_LANE16[i]] - (const char *)rk[0];
+	lo = _mm512_loadu_si512(off);
+	hi = _mm512_loadu_si512(off + 8);
+	for (i = 0; i < 32; i++)
+	{
+		K[i] = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_i64gather_epi32(lo, rk[0], 1)),
+		                          _mm512_i64gather_epi32(hi, rk[0], 1), 1);
+		lo = _mm512_add_epi64(lo, four);
+		hi = _mm512_add_epi64(hi, four);
+	}
+
+	for (i = 0; i < 4; i++)
+		X[i] = SM4_Bswap_AVX512(_mm512_loadu_si512(buf + 64 * i));
+	SM4_Transpose_AVX512(X);
+	x0 = X[0];
+	x1 = X[1];
+	x2 = X[2];
+	x3 = X[3];
+	for (i = 0; i < 32; i += 4)
+	{
+		SM4_ROUNDK_AVX512(x0, x1, x2, x3, K[i]);
+		SM4_ROUNDK_AVX512(x1, x2, x3, x0, K[i + 1]);
+		SM4_ROUNDK_AVX512(x2, x3, x0, x1, K[i + 2]);
+		SM4_ROUNDK_AVX512(x3, x0, x1, x2, K[i + 3]);
+	}
+	X[0] = x3;
+	X[1] = x2;
+	X[2] = x1;
+	X[3] = x0;
+	SM4_Transpose_AVX512(X);
+	for (i = 0; i < 4; i++)
+		_mm512_storeu_si512(buf + 64 * i, SM4_Bswap_AVX512(X[i]));
+}
+
+#define SM4_HAS_AVX2() __builtin_cpu_supports("avx2")
+#define SM4_HAS_AVX512() __builtin_cpu_supports("avx512f")
+
+#endif
+
+/************************************************************
+Function:
+         void SM4_CryptBlocks(const SM4_KEY *key, const unsigned char in[], unsigned char out[], size_t blocks);
+Description:
+         Encrypt or decrypt (depending on how the key was expanded)
+         consecutive blocks, 16 (AVX-512) or 8 (AVX2) blocks at a time
+         when the CPU allows it
+Calls:
+         SM4_Crypt1;
+         SM4_Crypt2
+Called By:
+Input:
+         key: expanded key
+         in[]: input blocks
+         blocks: the number of 16 byte blocks
+Output:
+         out[]: output blocks, may be the same as in[]
+Return:null
+Others:
+************************************************************/
+void SM4_CryptBlocks(const SM4_KEY *key, const unsigned char in[], unsigned char out[], size_t blocks)
+{
+	unsigned int X[4], Y[4];
+	size_t n;
+	int j;
+
+#ifdef SM4_X86
+	if (blocks >= 16 && SM4_HAS_AVX512())
+	{
+		n = blocks & ~(size_t)15;
+		SM4_CryptBlocks16_AVX512(key->rk, in, out, n);
+		in += 16 * n;
+		out += 16 * n;
+		blocks -= n;
+	}
+	if (blocks >= 8 && SM4_HAS_AVX2())
+	{
+		n = blocks & ~(size_t)7;
+		SM4_CryptBlocks8_AVX2(key->rk, in, out, n);
+		in += 16 * n;
+		out += 16 * n;
+		blocks -= n;
+	}
+#endif
+
+	for (; blocks >= 2; blocks -= 2, in += 32, out += 32)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			X[j] = SM4_GetU32(in + 4 * j);
+			Y[j] = SM4_GetU32(in + 16 + 4 * j);
+		}
+		SM4_Crypt2(key->rk, X, Y);
+		for (j = 0; j < 4; j++)
+		{
+			SM4_PutU32(out + 4 * j, X[j]);
+			SM4_PutU32(out + 16 + 4 * j, Y[j]);
+		}
+	}
+	if (blocks)
+	{
+		for (j = 0; j < 4; j++)
+			X[j] = SM4_GetU32(in + 4 * j);
+		SM4_Crypt1(key->rk, X);
+		for (j = 0; j < 4; j++)
+			SM4_PutU32(out + 4 * j, X[j]);
+	}
+}
+
+/************************************************************
+Function:
+         void SM4_Ctr32Blocks(const SM4_KEY *key, const unsigned char in[], unsigned char out[], size_t blocks, const unsigned char ivec[]);
+Description:
+         Counter mode kernel: encrypt ivec, ivec+1, ... and xor the key
+         stream into the data. Only the last 32bit word of the counter
+         block is incremented (modulo 2^32), carrying into the upper words
+         is left to the caller. Counter blocks are built directly in SIMD
+         registers.
+Calls:
+         SM4_Crypt1;
+         SM4_Crypt2
+Called By:
+Input:
+         key: expanded encryption key
+         in[]: input blocks
+         blocks: the number of 16 byte blocks
+         ivec[]: the first counter block, not modified
+Output:
+         out[]: output blocks, may be the same as in[]
+Return:null
+Others:
+************************************************************/
+void SM4_Ctr32Blocks(const SM4_KEY *key, const unsigned char in[], unsigned char out[], size_t blocks, const unsigned char ivec[])
+{
+	unsigned int W[4], X[4], Y[4];
+	size_t n;
+	int j;
+
+	for (j = 0; j < 4; j++)
+		W[j] = SM4_GetU32(ivec + 4 * j);
+
+#ifdef SM4_X86
+	if (blocks >= 16 && SM4_HAS_AVX512())
+	{
+		n = blocks & ~(size_t)15;
+		SM4_Ctr32Blocks16_AVX512(key->rk, in, out, n, W);
+		W[3] += (unsigned int)n;
+		in += 16 * n;
+		out += 16 * n;
+		blocks -= n;
+	}
+	if (blocks >= 8 && SM4_HAS_AVX2())
+	{
+		n = blocks & ~(size_t)7;
+		SM4_Ctr32Blocks8_AVX2(key->rk, in, out, n, W);
+		W[3] += (unsigned int)n;
+		in += 16 * n;
+		out += 16 * n;
+		blocks -= n;
+	}
+#endif
+
+	for (; blocks >= 2; blocks -= 2, in += 32, out += 32)
+	{
+		memcpy(X, W, sizeof(X));
+		memcpy(Y, W, sizeof(Y));
+		Y[3]++;
+		SM4_Crypt2(key->rk, X, Y);
+		for (j = 0; j < 4; j++)
+		{
+			SM4_PutU32(out + 4 * j, X[j] ^ SM4_GetU32(in + 4 * j));
+			SM4_PutU32(out + 16 + 4 * j, Y[j] ^ SM4_GetU32(in + 16 + 4 * j));
+		}
+		W[3] += 2;
+	}
+	if (blocks)
+	{
+		memcpy(X, W, sizeof(X));
+		SM4_Crypt1(key->rk, X);
+		for (j = 0; j < 4; j++)
+			SM4_PutU32(out + 4 * j, X[j] ^ SM4_GetU32(in + 4 * j));
+	}
+}
+
+//one block under its own round keys, out may be the same as in
+static void SM4_CryptOne(const unsigned int rk[], const unsigned char in[], unsigned char out[])
+{
+	unsigned int X[4];
+	int j;
+
+	for (j = 0; j < 4; j++)
+		X[j] = SM4_GetU32(in + 4 * j);
+	SM4_Crypt1(rk, X);
+	for (j = 0; j < 4; j++)
+		SM4_PutU32(out + 4 * j, X[j]);
+}
+
+/************************************************************
+Function:
+         void SM4_CryptJobs(const SM4_JOB job[], size_t count);
+Description:
+         Process the blocks of many jobs, each under its own expanded
+         key, 16 (AVX-512) or 8 (AVX2) blocks of any jobs at a time
+Calls:
+         SM4_CryptLanes16_AVX512;
+         SM4_CryptLanes8_AVX2;
+         SM4_CryptOne
+Called By:
+         SM4_SelfCheck
+Input:
+         job[]: key, input, output and number of blocks of every job
+         count: number of jobs
+Output:
+         job[].out: output blocks
+Return:null
+Others:
+         Blocks are copied into a group buffer, so the output of a job
+         may overlap its own input. A last group of at least 4 blocks is
+         padded with copies of the first lane; fewer are done one by one.
+************************************************************/
+void SM4_CryptJobs(const SM4_JOB job[], size_t count)
+{
+	unsigned char buf[16 * 16];
+	const unsigned int *rk[16];
+	unsigned char *dst[16];
+	size_t i, k;
+	int lanes = 0, n = 0, j;
+
+#ifdef SM4_X86
+	if (SM4_HAS_AVX512())
+		lanes = 16;
+	else if (SM4_HAS_AVX2())
+		lanes = 8;
+#endif
+
+	for (i = 0; i < count; i++)
+		for (k = 0; k < job[i].blocks; k++)
+		{
+			if (!lanes)
+			{
+				SM4_CryptOne(job[i].key->rk, job[i].in + 16 * k, job[i].out + 16 * k);
+				continue;
+			}
+			memcpy(buf + 16 * n, job[i].in + 16 * k, 16);
+			rk[n] = job[i].key->rk;
+			dst[n++] = job[i].out + 16 * k;
+			if (n < lanes)
+				continue;
+#ifdef SM4_X86
+			if (lanes == 16)
+				SM4_CryptLanes16_AVX512(rk, buf);
+			else
+				SM4_CryptLanes8_AVX2(rk, buf);
+#endif
+			for (j = 0; j < n; j++)
+				memcpy(dst[j], buf + 16 * j, 16);
+			n = 0;
+		}
+
+#ifdef SM4_X86
+	if (n >= 4)
+	{
+		for (j = n; j < lanes; j++)
+		{
+			rk[j] = rk[0];
+			memcpy(buf + 16 * j, buf, 16);
+		}
+		if (lanes == 16)
+			SM4_CryptLanes16_AVX512(rk, buf);
+		else
+			SM4_CryptLanes8_AVX2(rk, buf);
+		for (j = 0; j < n; j++)
+			memcpy(dst[j], buf + 16 * j, 16);
+		n = 0;
+	}
+#endif
+	for (j = 0; j < n; j++)
+		SM4_CryptOne(rk[j], buf + 16 * j, dst[j]);
+}
+
 /************************************************************
 Function:
          int SM4_SelfCheck()
@@ -161,12 +923,19 @@ Description:
 Calls:
          SM4_Encrypt;
          SM4_Decrypt;
+         SM4_CryptBlocks;
+         SM4_Ctr32Blocks;
+         SM4_CryptJobs
 Called By:
 Input:
 Output:
 Return:
          1 fail; 0 success
 Others:
+         The multi-block kernels are checked against the single block
+         functions over 45 blocks, so every kernel width gets used. The
+         multi-key kernel gets jobs of 1..3 blocks under 13 keys, half
+         of them expanded for decryption.
 ************************************************************/
 int SM4_SelfCheck()
 {
@@ -183,6 +952,12 @@ int SM4_SelfCheck()
 	unsigned char En_output[16];
 	unsigned char De_output[16];
 
+	SM4_KEY enc_key, dec_key;
+	unsigned char data[45 * 16], buf[45 * 16], ctr[45 * 16];
+	SM4_KEY keys[13];
+	SM4_JOB job[23];
+	size_t off;
+
 	SM4_Encrypt(key, plain, En_output);
 	SM4_Decrypt(key, cipher, De_output);
 
@@ -190,10 +965,59 @@ int SM4_SelfCheck()
 		if ((En_output[i] != cipher[i]) | (De_output[i] != plain[i]))
 			return 1;
 
-	return 0;
-}
+	//multi-block kernels
+	SM4_SetEncKey(key, &enc_key);
+	SM4_SetDecKey(key, &dec_key);
+	for (i = 0; i < (int)sizeof(data); i++)
+		data[i] = (unsigned char)(i * 7 + 1);
 
-int main(void)
-{
-	return SM4_SelfCheck();
+	SM4_CryptBlocks(&enc_key, data, buf, 45);
+	for (i = 0; i < 45; i++)
+	{
+		SM4_Encrypt(key, data + 16 * i, En_output);
+		if (memcmp(En_output, buf + 16 * i, 16))
+			return 1;
+	}
+	SM4_CryptBlocks(&dec_key, buf, buf, 45);
+	if (memcmp(buf, data, sizeof(data)))
+		return 1;
+
+	//counter blocks wrap around in the last word
+	for (i = 0; i < 45; i++)
+	{
+		memcpy(ctr + 16 * i, plain, 12);
+		SM4_PutU32(ctr + 16 * i + 12, 0xfffffff0 + (unsigned int)i);
+	}
+	SM4_Ctr32Blocks(&enc_key, data, buf, 45, ctr);
+	SM4_CryptBlocks(&enc_key, ctr, ctr, 45);
+	for (i = 0; i < (int)sizeof(data); i++)
+		if (buf[i] != (data[i] ^ ctr[i]))
+			return 1;
+
+	//one key per job, jobs of 1..3 blocks
+	for (i = 0; i < 13; i++)
+	{
+		memcpy(ctr, key, 16);
+		ctr[0] ^= (unsigned char)i;
+		if (i & 1)
+			SM4_SetDecKey(ctr, &keys[i]);
+		else
+			SM4_SetEncKey(ctr, &keys[i]);
+	}
+	for (i = 0, off = 0; i < 23; off += job[i].blocks, i++)
+	{
+		job[i].key = &keys[(i * 5) % 13];
+		job[i].in = data + 16 * off;
+		job[i].out = buf + 16 * off;
+		job[i].blocks = 1 + i % 3;
+	}
+	SM4_CryptJobs(job, 23);
+	for (i = 0; i < 23; i++)
+	{
+		SM4_CryptBlocks(job[i].key, job[i].in, ctr, job[i].blocks);
+		if (memcmp(ctr, job[i].out, 16 * job[i].blocks))
+			return 1;
+	}
+
+	return 0;
 }
@@ -0,0 +1,181 @@
+/************************************************************
+FileName:
+     SM4_CBC.c
+Version:
+     SM4_CBC_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 cipher block chaining (CBC) mode.
+     Encryption is serial by construction. Every plain text block of the
+     decryption depends only on two cipher text blocks, so 16 blocks are
+     decrypted per call of the multi-block kernel and then xored with the
+     preceding cipher text.
+Function List:
+     1. SM4_CBC_Encrypt    //CBC encryption
+     2. SM4_CBC_Decrypt    //CBC decryption, many blocks per kernel call
+     3. SM4_CBC_SelfCheck  //Self-check
+************************************************************/
+
+#include "SM4_CBC.h"
+
+#include <string.h>
+
+//blocks decrypted per kernel call
+#define SM4_CBC_STRIDE 16
+
+/************************************************************
+Function:
+         int SM4_CBC_Encrypt(const SM4_KEY *key, unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         CBC encryption, the chaining value is returned in iv[] so a
+         long message can be encrypted in several calls
+Calls:
+         SM4_CryptBlocks
+Called By:
+         SM4_CBC_SelfCheck
+Input:
+         key: expanded encryption key, see SM4_SetEncKey
+         iv[]: initialization vector
+         in[]: plain text
+         len: byte length of in[], a multiple of 16
+Output:
+         iv[]: last cipher text block
+         out[]: cipher text, may be the same as in[]
+Return:
+         1 len is not a multiple of 16; 0 success
+Others:
+************************************************************/
+int SM4_CBC_Encrypt(const SM4_KEY *key, unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len)
+{
+	unsigned char X[16];
+	int i;
+
+	if (len % 16)
+		return 1;
+
+	memcpy(X, iv, 16);
+	for (; len; len -= 16, in += 16, out += 16)
+	{
+		for (i = 0; i < 16; i++)
+			X[i] ^= in[i];
+		SM4_CryptBlocks(key, X, X, 1);
+		memcpy(out, X, 16);
+	}
+	memcpy(iv, X, 16);
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_CBC_Decrypt(const SM4_KEY *key, unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         CBC decryption, 16 blocks per call of the multi-block kernel;
+         the chaining value is returned in iv[]
+Calls:
+         SM4_CryptBlocks
+Called By:
+         SM4_CBC_SelfCheck
+Input:
+         key: expanded decryption key, see SM4_SetDecKey
+         iv[]: initialization vector
+         in[]: cipher text
+         len: byte length of in[], a multiple of 16
+Output:
+         iv[]: last cipher text block
+         out[]: plain text, may be the same as in[]
+Return:
+         1 len is not a multiple of 16; 0 success
+Others:
+         Blocks of a stride are xored from the last one backwards, so
+         in place decryption still sees the cipher text it needs.
+************************************************************/
+int SM4_CBC_Decrypt(const SM4_KEY *key, unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len)
+{
+	unsigned char buf[16 * SM4_CBC_STRIDE], last[16];
+	size_t blocks = len / 16, n, i;
+	int j;
+
+	if (len % 16)
+		return 1;
+
+	for (; blocks; blocks -= n, in += 16 * n, out += 16 * n)
+	{
+		n = blocks < SM4_CBC_STRIDE ? blocks : SM4_CBC_STRIDE;
+		SM4_CryptBlocks(key, in, buf, n);
+		memcpy(last, in + 16 * (n - 1), 16);
+		for (i = n - 1; i > 0; i--)
+			for (j = 0; j < 16; j++)
+				out[16 * i + j] = buf[16 * i + j] ^ in[16 * (i - 1) + j];
+		for (j = 0; j < 16; j++)
+			out[j] = buf[j] ^ iv[j];
+		memcpy(iv, last, 16);
+	}
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_CBC_SelfCheck()
+Description:
+         Self-check with standard data
+Calls:
+         SM4_CBC_Encrypt;
+         SM4_CBC_Decrypt;
+         SM4_Decrypt
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         A longer message is decrypted in place, in two calls, and
+         compared with block by block decryption.
+************************************************************/
+int SM4_CBC_SelfCheck()
+{
+	unsigned char key[16] = {
+			0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10};
+	unsigned char iv0[16] = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+	unsigned char cipher[64] = {
+			0x26, 0x77, 0xf4, 0x6b, 0x09, 0xc1, 0x22, 0xcc, 0x97, 0x55, 0x33, 0x10, 0x5b, 0xd4, 0xa2, 0x2a,
+			0xd9, 0xee, 0x98, 0x83, 0x0e, 0x69, 0x74, 0x5c, 0x98, 0x27, 0xf9, 0x34, 0xa1, 0x96, 0x21, 0xf8,
+			0xdb, 0x45, 0xa4, 0x86, 0x45, 0x90, 0x9e, 0xef, 0xda, 0x6b, 0xae, 0x89, 0xa7, 0x2e, 0x65, 0x9b,
+			0xa6, 0x39, 0x4a, 0x4e, 0x05, 0xbd, 0x7c, 0xfe, 0x51, 0x48, 0x52, 0xa2, 0xab, 0x9a, 0x2d, 0x80};
+	unsigned char plain[64], out[64], iv[16];
+	unsigned char data[45 * 16], buf[45 * 16], X[16];
+	SM4_KEY ek, dk;
+	size_t i;
+	int j;
+
+	SM4_SetEncKey(key, &ek);
+	SM4_SetDecKey(key, &dk);
+	for (i = 0; i < sizeof(plain); i++)
+		plain[i] = (unsigned char)i;
+
+	memcpy(iv, iv0, 16);
+	SM4_CBC_Encrypt(&ek, iv, plain, out, 64);
+	if (memcmp(out, cipher, 64) || memcmp(iv, cipher + 48, 16))
+		return 1;
+	memcpy(iv, iv0, 16);
+	SM4_CBC_Decrypt(&dk, iv, cipher, out, 64);
+	if (memcmp(out, plain, 64))
+		return 1;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (unsigned char)(i * 13 + 5);
+	memcpy(buf, data, sizeof(buf));
+	memcpy(iv, iv0, 16);
+	SM4_CBC_Decrypt(&dk, iv, buf, buf, 29 * 16);
+	SM4_CBC_Decrypt(&dk, iv, buf + 29 * 16, buf + 29 * 16, 16 * 16);
+	for (i = 0; i < 45; i++)
+	{
+		SM4_Decrypt(key, data + 16 * i, X);
+		for (j = 0; j < 16; j++)
+			if (buf[16 * i + j] != (X[j] ^ (i ? data[16 * (i - 1) + j] : iv0[j])))
+				return 1;
+	}
+
+	return 0;
+}
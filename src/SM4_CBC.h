@@ -0,0 +1,23 @@
+/************************************************************
+FileName:
+     SM4_CBC.h
+Version:
+     SM4_CBC_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the function declarations of the SM4 cipher
+     block chaining (CBC) mode.
+Function List:
+     1. SM4_CBC_Encrypt    //CBC encryption
+     2. SM4_CBC_Decrypt    //CBC decryption, many blocks per kernel call
+     3. SM4_CBC_SelfCheck  //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+int SM4_CBC_Encrypt(const SM4_KEY *key, unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len);
+int SM4_CBC_Decrypt(const SM4_KEY *key, unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len);
+int SM4_CBC_SelfCheck();
@@ -0,0 +1,326 @@
+/************************************************************
+FileName:
+     SM4_CCM.c
+Version:
+     SM4_CCM_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 Counter with CBC-MAC (CCM) authenticated
+     encryption, NIST SP 800-38C and RFC 8998. The nonce is 7..13 bytes
+     and the tag 4..16 bytes (even).
+     The data is read once: for every block the next CBC-MAC step and the
+     next counter block are handed to the kernel together, so the two
+     encryptions are interleaved instead of running in two passes.
+Function List:
+     1. SM4_CCM_Encrypt    //Encrypt and authenticate a message
+     2. SM4_CCM_Decrypt    //Decrypt and verify a message
+     3. SM4_CCM_SelfCheck  //Self-check
+************************************************************/
+
+#include "SM4_CCM.h"
+#include "SM4_CTR.h"
+
+#include <string.h>
+
+/************************************************************
+Function:
+         static int SM4_CCM_Start(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                                  size_t len, size_t taglen, unsigned char X[], unsigned char A[], unsigned char S0[]);
+Description:
+         Check the parameters, format B0 and the first counter block,
+         and run the CBC-MAC over B0 and the AAD
+Calls:
+         SM4_CryptBlocks
+Called By:
+         SM4_CCM_Encrypt;
+         SM4_CCM_Decrypt
+Input:
+         key: expanded encryption key
+         nonce[]: nonce, 7..13 bytes
+         aad[]: additional authenticated data
+         len: byte length of the text
+         taglen: byte length of the tag
+Output:
+         X[]: CBC-MAC state after the AAD
+         A[]: counter block A1
+         S0[]: E(K,A0), masks the tag
+Return:
+         1 bad parameter; 0 success
+Others:
+************************************************************/
+static int SM4_CCM_Start(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                         size_t len, size_t taglen, unsigned char X[], unsigned char A[], unsigned char S0[])
+{
+	unsigned char pair[32], enc[10];
+	unsigned long long n;
+	size_t i, L, k;
+
+	if (noncelen < SM4_CCM_MIN_NONCE || noncelen > SM4_CCM_MAX_NONCE)
+		return 1;
+	if (taglen < 4 || taglen > 16 || (taglen & 1))
+		return 1;
+	L = 15 - noncelen;
+	if (L < 8 && ((unsigned long long)len >> (8 * L)))
+		return 1;
+
+	//B0=flags||N||Q and A0=flags'||N||0, encrypted together
+	pair[0] = (unsigned char)((aadlen ? 0x40 : 0) | (((taglen - 2) / 2) << 3) | (L - 1));
+	memcpy(pair + 1, nonce, noncelen);
+	for (i = 15, n = len; i > noncelen; i--, n >>= 8)
+		pair[i] = (unsigned char)n;
+	pair[16] = (unsigned char)(L - 1);
+	memcpy(pair + 17, nonce, noncelen);
+	memset(pair + 17 + noncelen, 0, L);
+	memcpy(A, pair + 16, 16);
+	SM4_CryptBlocks(key, pair, pair, 2);
+	memcpy(X, pair, 16);
+	memcpy(S0, pair + 16, 16);
+	SM4_CTR_AddCounter(A, 1, SM4_CTR_WIDTH128);
+
+	if (!aadlen)
+		return 0;
+
+	//encoded length of the AAD: 2, 0xfffe||4 or 0xffff||8 bytes
+	n = aadlen;
+	if (n < 0xFF00)
+		k = 2;
+	else
+	{
+		k = (n >> 32) ? 10 : 6;
+		enc[0] = 0xFF;
+		enc[1] = (k == 6) ? 0xFE : 0xFF;
+	}
+	for (i = k; i > (k == 2 ? 0 : 2); i--, n >>= 8)
+		enc[i - 1] = (unsigned char)n;
+	for (i = 0; i < k; i++)
+		X[i] ^= enc[i];
+
+	for (i = 0; i < aadlen; i++)
+	{
+		X[k++] ^= aad[i];
+		if (k == 16)
+		{
+			SM4_CryptBlocks(key, X, X, 1);
+			k = 0;
+		}
+	}
+	if (k)
+		SM4_CryptBlocks(key, X, X, 1);
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_CCM_Encrypt(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                             const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[], size_t taglen);
+Description:
+         Encrypt and authenticate a message in one pass
+Calls:
+         SM4_CCM_Start;
+         SM4_CryptBlocks;
+         SM4_CTR_AddCounter
+Called By:
+         SM4_CCM_SelfCheck
+Input:
+         key: expanded encryption key, see SM4_SetEncKey
+         nonce[]: nonce
+         noncelen: byte length of nonce[], 7..13
+         aad[]: additional authenticated data
+         aadlen: byte length of aad[]
+         in[]: plain text
+         len: byte length of in[], < 2^(8*(15-noncelen))
+         taglen: byte length of the tag, 4,6,...,16
+Output:
+         out[]: cipher text, may be the same as in[]
+         tag[]: authentication tag
+Return:
+         1 bad parameter; 0 success
+Others:
+************************************************************/
+int SM4_CCM_Encrypt(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[], size_t taglen)
+{
+	unsigned char X[16], A[16], S0[16], pair[32];
+	size_t i, n;
+
+	if (SM4_CCM_Start(key, nonce, noncelen, aad, aadlen, len, taglen, X, A, S0))
+		return 1;
+
+	//pair = X^Pi || Ai, one kernel call per block
+	for (; len; len -= n, in += n, out += n)
+	{
+		n = len < 16 ? len : 16;
+		memcpy(pair, X, 16);
+		for (i = 0; i < n; i++)
+			pair[i] ^= in[i];
+		memcpy(pair + 16, A, 16);
+		SM4_CTR_AddCounter(A, 1, SM4_CTR_WIDTH128);
+		SM4_CryptBlocks(key, pair, pair, 2);
+		memcpy(X, pair, 16);
+		for (i = 0; i < n; i++)
+			out[i] = in[i] ^ pair[16 + i];
+	}
+
+	for (i = 0; i < taglen; i++)
+		tag[i] = X[i] ^ S0[i];
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_CCM_Decrypt(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                             const unsigned char in[], size_t len, const unsigned char tag[], size_t taglen, unsigned char out[]);
+Description:
+         Decrypt and verify a message in one pass
+Calls:
+         SM4_CCM_Start;
+         SM4_CryptBlocks;
+         SM4_CTR_AddCounter
+Called By:
+         SM4_CCM_SelfCheck
+Input:
+         key: expanded encryption key, see SM4_SetEncKey
+         nonce[]: nonce
+         noncelen: byte length of nonce[], 7..13
+         aad[]: additional authenticated data
+         aadlen: byte length of aad[]
+         in[]: cipher text
+         len: byte length of in[]
+         tag[]: received tag
+         taglen: byte length of tag[], 4,6,...,16
+Output:
+         out[]: plain text, may be the same as in[]; zeroed on failure
+Return:
+         1 authentication failed or bad parameter; 0 success
+Others:
+         The MAC needs the plain text, so the key stream runs one block
+         ahead: the MAC step of block i is paired with the key stream
+         of block i+1.
+************************************************************/
+int SM4_CCM_Decrypt(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, const unsigned char tag[], size_t taglen, unsigned char out[])
+{
+	unsigned char X[16], A[16], S0[16], pair[32], diff = 0;
+	unsigned char *p = out;
+	size_t i, n, total = len;
+
+	if (SM4_CCM_Start(key, nonce, noncelen, aad, aadlen, len, taglen, X, A, S0))
+		return 1;
+
+	if (len)
+	{
+		SM4_CryptBlocks(key, A, pair + 16, 1);
+		SM4_CTR_AddCounter(A, 1, SM4_CTR_WIDTH128);
+	}
+	for (; len; len -= n, in += n, out += n)
+	{
+		n = len < 16 ? len : 16;
+		memcpy(pair, X, 16);
+		for (i = 0; i < n; i++)
+		{
+			out[i] = in[i] ^ pair[16 + i];
+			pair[i] ^= out[i];
+		}
+		if (len > 16)
+		{
+			memcpy(pair + 16, A, 16);
+			SM4_CTR_AddCounter(A, 1, SM4_CTR_WIDTH128);
+			SM4_CryptBlocks(key, pair, pair, 2);
+		}
+		else
+			SM4_CryptBlocks(key, pair, pair, 1);
+		memcpy(X, pair, 16);
+	}
+
+	for (i = 0; i < taglen; i++)
+		diff |= X[i] ^ S0[i] ^ tag[i];
+	if (diff)
+	{
+		memset(p, 0, total);
+		return 1;
+	}
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_CCM_SelfCheck()
+Description:
+         Self-check with standard data
+Calls:
+         SM4_CCM_Encrypt;
+         SM4_CCM_Decrypt
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         Test vector from RFC 8998 appendix A.2, then a 7 byte nonce with
+         a short tag and an AAD long enough for the 6 byte length encoding.
+************************************************************/
+int SM4_CCM_SelfCheck()
+{
+	unsigned char key[16] = {
+			0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10};
+	unsigned char nonce[13] = {0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00, 0xab, 0xcd, 0x00};
+	unsigned char aad[20] = {
+			0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+			0xab, 0xad, 0xda, 0xd2};
+	unsigned char plain[64] = {
+			0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb,
+			0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd,
+			0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+			0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa};
+	unsigned char cipher[64] = {
+			0x48, 0xaf, 0x93, 0x50, 0x1f, 0xa6, 0x2a, 0xdb, 0xcd, 0x41, 0x4c, 0xce, 0x60, 0x34, 0xd8, 0x95,
+			0xdd, 0xa1, 0xbf, 0x8f, 0x13, 0x2f, 0x04, 0x20, 0x98, 0x66, 0x15, 0x72, 0xe7, 0x48, 0x30, 0x94,
+			0xfd, 0x12, 0xe5, 0x18, 0xce, 0x06, 0x2c, 0x98, 0xac, 0xee, 0x28, 0xd9, 0x5d, 0xf4, 0x41, 0x6b,
+			0xed, 0x31, 0xa2, 0xf0, 0x44, 0x76, 0xc1, 0x8b, 0xb4, 0x0c, 0x84, 0xa7, 0x4b, 0x97, 0xdc, 0x5b};
+	unsigned char Std_tag[16] = {
+			0x16, 0x84, 0x2d, 0x4f, 0xa1, 0x86, 0xf5, 0x6a, 0xb3, 0x32, 0x56, 0x97, 0x1f, 0xa1, 0x10, 0xf4};
+	unsigned char cipher2[37] = {
+			0xf4, 0x70, 0xcc, 0xc7, 0x2c, 0x5b, 0x97, 0x9c, 0xfc, 0xc4, 0xfd, 0xa0, 0xd0, 0x5d, 0x10, 0x84,
+			0x7a, 0x1b, 0x48, 0xb2, 0xf2, 0x38, 0x71, 0x51, 0x1c, 0xa9, 0x79, 0x5d, 0x2e, 0x97, 0xd7, 0x0a,
+			0xae, 0xb1, 0x93, 0x0d, 0xfe};
+	unsigned char Std_tag2[4] = {0x77, 0x1f, 0x4e, 0xbd};
+	unsigned char cipher3[20] = {
+			0xd2, 0x11, 0x06, 0x8e, 0x69, 0x93, 0xea, 0xa7, 0x72, 0xa6, 0xff, 0x8b, 0xeb, 0xd0, 0x01, 0xee,
+			0xab, 0x64, 0x4d, 0x7d};
+	unsigned char Std_tag3[8] = {0xd9, 0xb3, 0x47, 0x92, 0xf5, 0xe0, 0x58, 0x3a};
+	static unsigned char longaad[0xFF00];
+	unsigned char out[64], tag[16], seq[37];
+	SM4_KEY ek;
+	size_t i;
+
+	SM4_SetEncKey(key, &ek);
+
+	if (SM4_CCM_Encrypt(&ek, nonce, 12, aad, 20, plain, 64, out, tag, 16))
+		return 1;
+	if (memcmp(out, cipher, 64) || memcmp(tag, Std_tag, 16))
+		return 1;
+	if (SM4_CCM_Decrypt(&ek, nonce, 12, aad, 20, cipher, 64, Std_tag, 16, out) || memcmp(out, plain, 64))
+		return 1;
+	tag[0] ^= 0x80;
+	if (!SM4_CCM_Decrypt(&ek, nonce, 12, aad, 20, cipher, 64, tag, 16, out))
+		return 1;
+
+	for (i = 0; i < sizeof(seq); i++)
+		seq[i] = (unsigned char)i;
+	if (SM4_CCM_Encrypt(&ek, seq, 7, NULL, 0, seq, 37, out, tag, 4))
+		return 1;
+	if (memcmp(out, cipher2, 37) || memcmp(tag, Std_tag2, 4))
+		return 1;
+	if (SM4_CCM_Decrypt(&ek, seq, 7, NULL, 0, cipher2, 37, Std_tag2, 4, out) || memcmp(out, seq, 37))
+		return 1;
+
+	for (i = 0; i < sizeof(longaad); i++)
+		longaad[i] = (unsigned char)(i * 7 + 3);
+	if (SM4_CCM_Encrypt(&ek, seq, 13, longaad, sizeof(longaad), seq, 20, out, tag, 8))
+		return 1;
+	if (memcmp(out, cipher3, 20) || memcmp(tag, Std_tag3, 8))
+		return 1;
+
+	return 0;
+}
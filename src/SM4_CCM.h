@@ -0,0 +1,29 @@
+/************************************************************
+FileName:
+     SM4_CCM.h
+Version:
+     SM4_CCM_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the function declarations of the SM4 Counter
+     with CBC-MAC (CCM) authenticated encryption, NIST SP 800-38C and
+     RFC 8998.
+Function List:
+     1. SM4_CCM_Encrypt    //Encrypt and authenticate a message
+     2. SM4_CCM_Decrypt    //Decrypt and verify a message
+     3. SM4_CCM_SelfCheck  //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+#define SM4_CCM_MIN_NONCE 7
+#define SM4_CCM_MAX_NONCE 13
+
+int SM4_CCM_Encrypt(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[], size_t taglen);
+int SM4_CCM_Decrypt(const SM4_KEY *key, const unsigned char nonce[], size_t noncelen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, const unsigned char tag[], size_t taglen, unsigned char out[]);
+int SM4_CCM_SelfCheck();
@@ -0,0 +1,36 @@
+/************************************************************
+FileName:
+     SM4_CMAC.h
+Version:
+     SM4_CMAC_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the data type and function declarations of
+     the SM4 cipher-based message authentication code (CMAC, NIST
+     SP 800-38B).
+Function List:
+     1. SM4_CMAC_Init       //Expanded key and cached subkeys K1, K2
+     2. SM4_CMAC            //MAC of one message
+     3. SM4_CMAC_Batch      //MACs of many messages, chains interleaved
+     4. SM4_CMAC_SelfCheck  //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+//maximum number of chains advanced per kernel call of SM4_CMAC_Batch
+#define SM4_CMAC_LANES 16
+
+typedef struct
+{
+     SM4_KEY key;           //expanded encryption key
+     unsigned char K1[16];  //subkey for a complete last block
+     unsigned char K2[16];  //subkey for a padded last block
+} SM4_CMAC_KEY;
+
+void SM4_CMAC_Init(SM4_CMAC_KEY *ck, const SM4_KEY *key);
+void SM4_CMAC(const SM4_CMAC_KEY *ck, const unsigned char msg[], size_t len, unsigned char mac[16]);
+void SM4_CMAC_Batch(const SM4_CMAC_KEY *ck, const unsigned char *const msg[], const size_t len[], size_t count, unsigned char mac[][16]);
+int SM4_CMAC_SelfCheck();
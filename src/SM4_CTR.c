@@ -0,0 +1,427 @@
+/************************************************************
+FileName:
+     SM4_CTR.c
+Version:
+     SM4_CTR_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 counter (CTR) mode. Every block of key
+     stream is independent, so whole runs of blocks are handed to the
+     multi-block counter kernel SM4_Ctr32Blocks. The counter is incremented
+     either in its last 32bit word only or as a 128bit number, and the key
+     stream can be positioned at any byte offset.
+     The scatter-gather calls work on the fragments in place: the input
+     and output chains are cut where either of them has a boundary and
+     each piece goes straight to the update function, which carries the
+     key stream of a block split between two fragments.
+Function List:
+     1. SM4_CTR_AddCounter  //Advance a counter block by n blocks
+     2. SM4_CTR_Init        //Initialise a CTR context with an expanded key
+     3. SM4_CTR_Seek        //Move the key stream to an arbitrary byte offset
+     4. SM4_CTR_Update      //Encrypt/decrypt the next part of the stream
+     5. SM4_CTR_Encrypt     //One-shot encryption/decryption
+     6. SM4_CTR_ForIov      //Walk a pair of iovec arrays in contiguous pieces
+     7. SM4_CTR_UpdateIov   //Encrypt/decrypt the next part of the stream, scatter-gather
+     8. SM4_CTR_SelfCheck   //Self-check
+************************************************************/
+
+#include "SM4_CTR.h"
+
+#include <string.h>
+
+/************************************************************
+Function:
+         void SM4_CTR_AddCounter(unsigned char ctr[], unsigned long long n, int width);
+Description:
+         Advance a big-endian counter block by n
+Calls:
+Called By:
+         SM4_CTR_Seek;
+         SM4_CTR_Update
+Input:
+         ctr[]: counter block
+         n: the number of blocks
+         width: SM4_CTR_WIDTH32 or SM4_CTR_WIDTH128
+Output:
+         ctr[]: counter block + n, modulo 2^width
+Return:null
+Others:
+************************************************************/
+void SM4_CTR_AddCounter(unsigned char ctr[], unsigned long long n, int width)
+{
+	unsigned int c = 0;
+	int i, last = (width == SM4_CTR_WIDTH32) ? 12 : 0;
+
+	for (i = 15; i >= last && (n || c); i--)
+	{
+		c += ctr[i] + (unsigned int)(n & 0xFF);
+		ctr[i] = (unsigned char)c;
+		c >>= 8;
+		n >>= 8;
+	}
+}
+
+/************************************************************
+Function:
+         int SM4_CTR_Init(SM4_CTR_CTX *ctx, const SM4_KEY *key, unsigned char iv[], int width);
+Description:
+         Initialise a CTR context, the stream starts at offset 0
+Calls:
+Called By:
+         SM4_CTR_Encrypt
+Input:
+         key: expanded encryption key, see SM4_SetEncKey
+         iv[]: initial counter block, 16 bytes
+         width: SM4_CTR_WIDTH32 or SM4_CTR_WIDTH128
+Output:
+         ctx: CTR context
+Return:
+         1 unsupported width; 0 success
+Others:
+************************************************************/
+int SM4_CTR_Init(SM4_CTR_CTX *ctx, const SM4_KEY *key, unsigned char iv[], int width)
+{
+	if (width != SM4_CTR_WIDTH32 && width != SM4_CTR_WIDTH128)
+		return 1;
+
+	ctx->key = *key;
+	memcpy(ctx->iv, iv, 16);
+	memcpy(ctx->ctr, iv, 16);
+	ctx->num = 0;
+	ctx->width = width;
+	return 0;
+}
+
+/************************************************************
+Function:
+         void SM4_CTR_Seek(SM4_CTR_CTX *ctx, unsigned long long offset);
+Description:
+         Position the key stream at a byte offset from the start
+         of the stream, without generating the skipped blocks
+Calls:
+         SM4_CTR_AddCounter;
+         SM4_CryptBlocks
+Called By:
+Input:
+         ctx: CTR context
+         offset: byte offset
+Output:
+         ctx: CTR context
+Return:null
+Others:
+************************************************************/
+void SM4_CTR_Seek(SM4_CTR_CTX *ctx, unsigned long long offset)
+{
+	memcpy(ctx->ctr, ctx->iv, 16);
+	SM4_CTR_AddCounter(ctx->ctr, offset >> 4, ctx->width);
+
+	ctx->num = (unsigned int)(offset & 15);
+	if (ctx->num)
+	{
+		SM4_CryptBlocks(&ctx->key, ctx->ctr, ctx->ks, 1);
+		SM4_CTR_AddCounter(ctx->ctr, 1, ctx->width);
+	}
+}
+
+/************************************************************
+Function:
+         void SM4_CTR_Update(SM4_CTR_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Encrypt or decrypt the next len bytes of the stream
+Calls:
+         SM4_Ctr32Blocks;
+         SM4_CryptBlocks;
+         SM4_CTR_AddCounter
+Called By:
+         SM4_CTR_Encrypt
+Input:
+         ctx: CTR context
+         in[]: input data
+         len: byte length of in[]
+Output:
+         out[]: output data, may be the same as in[]
+Return:null
+Others:
+************************************************************/
+void SM4_CTR_Update(SM4_CTR_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len)
+{
+	unsigned long long room;
+	size_t i, n;
+
+	//use up the key stream left by the previous call
+	while (ctx->num && len)
+	{
+		*out++ = *in++ ^ ctx->ks[ctx->num];
+		ctx->num = (ctx->num + 1) & 15;
+		len--;
+	}
+
+	while (len >= 16)
+	{
+		n = len / 16;
+		if (ctx->width == SM4_CTR_WIDTH128)
+		{
+			//the kernel only counts in the last word, stop where it wraps
+			room = 0x100000000ULL - SM4_GetU32(ctx->ctr + 12);
+			if (n > room)
+				n = (size_t)room;
+		}
+		SM4_Ctr32Blocks(&ctx->key, in, out, n, ctx->ctr);
+		SM4_CTR_AddCounter(ctx->ctr, n, ctx->width);
+		in += 16 * n;
+		out += 16 * n;
+		len -= 16 * n;
+	}
+
+	if (len)
+	{
+		SM4_CryptBlocks(&ctx->key, ctx->ctr, ctx->ks, 1);
+		SM4_CTR_AddCounter(ctx->ctr, 1, ctx->width);
+		for (i = 0; i < len; i++)
+			out[i] = in[i] ^ ctx->ks[i];
+		ctx->num = (unsigned int)len;
+	}
+}
+
+/************************************************************
+Function:
+         int SM4_CTR_Encrypt(unsigned char MK[], unsigned char iv[], int width, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         One-shot CTR encryption, decryption is the same operation
+Calls:
+         SM4_SetEncKey;
+         SM4_CTR_Init;
+         SM4_CTR_Update
+Called By:
+         SM4_CTR_SelfCheck
+Input:
+         MK[]: Master key
+         iv[]: initial counter block, 16 bytes
+         width: SM4_CTR_WIDTH32 or SM4_CTR_WIDTH128
+         in[]: input data
+         len: byte length of in[]
+Output:
+         out[]: output data, may be the same as in[]
+Return:
+         1 unsupported width; 0 success
+Others:
+************************************************************/
+int SM4_CTR_Encrypt(unsigned char MK[], unsigned char iv[], int width, const unsigned char in[], unsigned char out[], size_t len)
+{
+	SM4_CTR_CTX ctx;
+	SM4_KEY key;
+
+	SM4_SetEncKey(MK, &key);
+	if (SM4_CTR_Init(&ctx, &key, iv, width))
+		return 1;
+	SM4_CTR_Update(&ctx, in, out, len);
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_CTR_ForIov(const struct iovec in[], int incnt, const struct iovec out[], int outcnt,
+                            SM4_CTR_IOV_FUNC fn, void *arg);
+Description:
+         Cut two chains of buffers of the same total length into pieces
+         that are contiguous in both and call fn for each piece in order
+Calls:
+Called By:
+         SM4_CTR_UpdateIov;
+         SM4_GCM_EncryptIov;
+         SM4_GCM_DecryptIov
+Input:
+         in[]: input buffers
+         incnt: number of in[] entries
+         out[]: output buffers, NULL to work in place on in[]
+         outcnt: number of out[] entries
+         fn: function called for every piece
+         arg: first argument of fn
+Output:
+Return:
+         1 total lengths differ or fn failed; 0 success
+Others:
+         Empty entries are skipped. The lengths are compared before fn
+         is called for the first time.
+************************************************************/
+int SM4_CTR_ForIov(const struct iovec in[], int incnt, const struct iovec out[], int outcnt,
+                   SM4_CTR_IOV_FUNC fn, void *arg)
+{
+	size_t inlen = 0, outlen = 0, ioff = 0, ooff = 0, n;
+	int i, j;
+
+	if (!out)
+	{
+		out = in;
+		outcnt = incnt;
+	}
+	for (i = 0; i < incnt; i++)
+		inlen += in[i].iov_len;
+	for (j = 0; j < outcnt; j++)
+		outlen += out[j].iov_len;
+	if (inlen != outlen)
+		return 1;
+
+	for (i = 0, j = 0; i < incnt && j < outcnt;)
+	{
+		if (ioff == in[i].iov_len)
+		{
+			i++;
+			ioff = 0;
+			continue;
+		}
+		if (ooff == out[j].iov_len)
+		{
+			j++;
+			ooff = 0;
+			continue;
+		}
+		n = in[i].iov_len - ioff;
+		if (n > out[j].iov_len - ooff)
+			n = out[j].iov_len - ooff;
+		if (fn(arg, (const unsigned char *)in[i].iov_base + ioff, (unsigned char *)out[j].iov_base + ooff, n))
+			return 1;
+		ioff += n;
+		ooff += n;
+	}
+	return 0;
+}
+
+static int SM4_CTR_IovPiece(void *arg, const unsigned char in[], unsigned char out[], size_t len)
+{
+	SM4_CTR_Update((SM4_CTR_CTX *)arg, in, out, len);
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_CTR_UpdateIov(SM4_CTR_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt);
+Description:
+         Encrypt or decrypt the next part of the stream held in a chain
+         of buffers
+Calls:
+         SM4_CTR_ForIov;
+         SM4_CTR_Update
+Called By:
+Input:
+         ctx: CTR context
+         in[]: input buffers
+         incnt: number of in[] entries
+         out[]: output buffers, NULL to work in place on in[]
+         outcnt: number of out[] entries
+Output:
+         out[]: output data
+Return:
+         1 total lengths differ; 0 success
+Others:
+         The stream position moves by the total length, the next call
+         continues inside a block that was split.
+************************************************************/
+int SM4_CTR_UpdateIov(SM4_CTR_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt)
+{
+	return SM4_CTR_ForIov(in, incnt, out, outcnt, SM4_CTR_IovPiece, ctx);
+}
+
+/************************************************************
+Function:
+         int SM4_CTR_SelfCheck()
+Description:
+         Self-check with standard data
+Calls:
+         SM4_CTR_Encrypt;
+         SM4_CTR_Init;
+         SM4_CTR_Seek;
+         SM4_CTR_Update;
+         SM4_CTR_UpdateIov
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         The counter starts two blocks before the last word wraps, so
+         the two widths give different key streams from the third block.
+         The chains used for the scatter-gather call split blocks at
+         different places on the input and the output side.
+************************************************************/
+int SM4_CTR_SelfCheck()
+{
+	unsigned char key[16] = {
+			0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10};
+	unsigned char iv[16] = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xfe};
+	unsigned char cipher128[64] = {
+			0xe1, 0xb0, 0x47, 0xbf, 0x00, 0xe2, 0x5b, 0x36, 0x12, 0xcb, 0xe6, 0xc4, 0xb5, 0x22, 0x5c, 0xf4,
+			0x93, 0xd8, 0x0d, 0x56, 0x8c, 0x68, 0x21, 0xf4, 0xb9, 0x95, 0xf6, 0x97, 0x82, 0xcd, 0x55, 0xac,
+			0x32, 0xf0, 0x23, 0x9d, 0x0d, 0xfd, 0x6d, 0x98, 0x8c, 0x81, 0xaa, 0x18, 0x7c, 0xd9, 0x2f, 0x39,
+			0x2a, 0x83, 0xf6, 0x98, 0x82, 0xbc, 0xbc, 0x77, 0x50, 0x07, 0x90, 0x4e, 0xdc, 0x22, 0x91, 0x9e};
+	unsigned char cipher32[64] = {
+			0xe1, 0xb0, 0x47, 0xbf, 0x00, 0xe2, 0x5b, 0x36, 0x12, 0xcb, 0xe6, 0xc4, 0xb5, 0x22, 0x5c, 0xf4,
+			0x93, 0xd8, 0x0d, 0x56, 0x8c, 0x68, 0x21, 0xf4, 0xb9, 0x95, 0xf6, 0x97, 0x82, 0xcd, 0x55, 0xac,
+			0x8e, 0xc3, 0x4d, 0xc9, 0x62, 0xf2, 0x8a, 0x2d, 0x2b, 0xed, 0xde, 0xae, 0x4c, 0x78, 0x50, 0x7c,
+			0x91, 0x9e, 0x1b, 0xc0, 0x4c, 0x81, 0xde, 0xc7, 0x64, 0x13, 0xdf, 0xad, 0x85, 0xaa, 0x6d, 0xc9};
+	unsigned char plain[64], out[64];
+	unsigned char data[1000], ref[1000], buf[1000];
+	size_t chunks[6] = {1, 15, 17, 130, 256, 581};
+	SM4_CTR_CTX ctx;
+	SM4_KEY ek;
+	struct iovec iin[6], iout[4];
+	size_t i, off;
+
+	for (i = 0; i < sizeof(plain); i++)
+		plain[i] = (unsigned char)i;
+
+	SM4_CTR_Encrypt(key, iv, SM4_CTR_WIDTH128, plain, out, sizeof(plain));
+	if (memcmp(out, cipher128, sizeof(out)))
+		return 1;
+	SM4_CTR_Encrypt(key, iv, SM4_CTR_WIDTH32, plain, out, sizeof(plain));
+	if (memcmp(out, cipher32, sizeof(out)))
+		return 1;
+
+	//streaming in odd pieces and seeking give the one-shot result
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (unsigned char)(i * 13 + 5);
+	SM4_CTR_Encrypt(key, iv, SM4_CTR_WIDTH128, data, ref, sizeof(data));
+
+	SM4_SetEncKey(key, &ek);
+	SM4_CTR_Init(&ctx, &ek, iv, SM4_CTR_WIDTH128);
+	for (i = 0, off = 0; i < 6; off += chunks[i], i++)
+		SM4_CTR_Update(&ctx, data + off, buf + off, chunks[i]);
+	if (memcmp(buf, ref, sizeof(ref)))
+		return 1;
+
+	SM4_CTR_Seek(&ctx, 37);
+	SM4_CTR_Update(&ctx, data + 37, buf, sizeof(data) - 37);
+	if (memcmp(buf, ref + 37, sizeof(data) - 37))
+		return 1;
+
+	//input in the chunks above, output cut at 5, 5 (empty), 700
+	for (i = 0, off = 0; i < 6; off += chunks[i], i++)
+	{
+		iin[i].iov_base = data + off;
+		iin[i].iov_len = chunks[i];
+	}
+	iout[0].iov_base = buf;
+	iout[0].iov_len = 5;
+	iout[1].iov_base = buf + 5;
+	iout[1].iov_len = 0;
+	iout[2].iov_base = buf + 5;
+	iout[2].iov_len = 695;
+	iout[3].iov_base = buf + 700;
+	iout[3].iov_len = 300;
+	SM4_CTR_Init(&ctx, &ek, iv, SM4_CTR_WIDTH128);
+	if (SM4_CTR_UpdateIov(&ctx, iin, 6, iout, 4) || memcmp(buf, ref, sizeof(ref)))
+		return 1;
+	iout[3].iov_len = 299;
+	if (!SM4_CTR_UpdateIov(&ctx, iin, 6, iout, 4))
+		return 1;
+
+	//in place on the output chain
+	SM4_CTR_Init(&ctx, &ek, iv, SM4_CTR_WIDTH128);
+	iout[3].iov_len = 300;
+	if (SM4_CTR_UpdateIov(&ctx, iout, 4, NULL, 0) || memcmp(buf, data, sizeof(data)))
+		return 1;
+
+	return 0;
+}
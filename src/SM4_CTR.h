@@ -0,0 +1,53 @@
+/************************************************************
+FileName:
+     SM4_CTR.h
+Version:
+     SM4_CTR_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the context and function declarations of the
+     SM4 counter (CTR) mode.
+Function List:
+     1. SM4_CTR_AddCounter  //Advance a counter block by n blocks
+     2. SM4_CTR_Init        //Initialise a CTR context with an expanded key
+     3. SM4_CTR_Seek        //Move the key stream to an arbitrary byte offset
+     4. SM4_CTR_Update      //Encrypt/decrypt the next part of the stream
+     5. SM4_CTR_Encrypt     //One-shot encryption/decryption
+     6. SM4_CTR_ForIov      //Walk a pair of iovec arrays in contiguous pieces
+     7. SM4_CTR_UpdateIov   //Encrypt/decrypt the next part of the stream, scatter-gather
+     8. SM4_CTR_SelfCheck   //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+#include <sys/uio.h>
+
+//counter increment width
+#define SM4_CTR_WIDTH32  32  //only the last 32bit word is incremented (as in GCM)
+#define SM4_CTR_WIDTH128 128 //the whole block is a 128bit big-endian counter
+
+typedef struct
+{
+     SM4_KEY key;
+     unsigned char iv[16];  //counter block at offset 0
+     unsigned char ctr[16]; //next counter block
+     unsigned char ks[16];  //key stream of the current block
+     unsigned int num;      //bytes of ks[] already used
+     int width;             //SM4_CTR_WIDTH32 or SM4_CTR_WIDTH128
+} SM4_CTR_CTX;
+
+//called by SM4_CTR_ForIov for every piece contiguous in both arrays, nonzero stops the walk
+typedef int (*SM4_CTR_IOV_FUNC)(void *arg, const unsigned char in[], unsigned char out[], size_t len);
+
+void SM4_CTR_AddCounter(unsigned char ctr[], unsigned long long n, int width);
+int SM4_CTR_Init(SM4_CTR_CTX *ctx, const SM4_KEY *key, unsigned char iv[], int width);
+void SM4_CTR_Seek(SM4_CTR_CTX *ctx, unsigned long long offset);
+void SM4_CTR_Update(SM4_CTR_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+int SM4_CTR_Encrypt(unsigned char MK[], unsigned char iv[], int width, const unsigned char in[], unsigned char out[], size_t len);
+int SM4_CTR_ForIov(const struct iovec in[], int incnt, const struct iovec out[], int outcnt,
+                   SM4_CTR_IOV_FUNC fn, void *arg);
+int SM4_CTR_UpdateIov(SM4_CTR_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt);
+int SM4_CTR_SelfCheck();
@@ -0,0 +1,592 @@
+/************************************************************
+FileName:
+     SM4_DRBG.c
+Version:
+     SM4_DRBG_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 based CTR_DRBG with derivation function
+     (NIST SP 800-90A, 128bit key, 128bit counter). The working key is
+     kept expanded between requests and the output blocks come from the
+     multi-block CTR kernel. The two BCC chains of the derivation
+     function are run side by side through one kernel call per block.
+Function List:
+     1. SM4_DRBG_Urandom        //Entropy from getrandom
+     2. SM4_DRBG_Instantiate    //Seed a new instance
+     3. SM4_DRBG_Reseed         //Add fresh entropy
+     4. SM4_DRBG_Generate       //Output random bytes
+     5. SM4_DRBG_Uninstantiate  //Wipe an instance
+     6. SM4_DRBG_Thread         //Instance of the calling thread
+     7. SM4_DRBG_SelfCheck      //Self-check
+************************************************************/
+
+#include "SM4_DRBG.h"
+#include "SM4_CTR.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+static const unsigned char SM4_DRBG_zero[SM4_DRBG_SEEDLEN] = {0};
+
+/************************************************************
+Function:
+         static void SM4_DRBG_Blocks(SM4_DRBG_CTX *ctx, unsigned char out[], size_t len);
+Description:
+         Output E(Key,V+1)||E(Key,V+2)||..., len bytes, and leave V at
+         the last counter used
+Calls:
+         SM4_CTR_AddCounter;
+         SM4_CTR_Init;
+         SM4_CTR_Update
+Called By:
+         SM4_DRBG_Update;
+         SM4_DRBG_Generate
+Input:
+         ctx: DRBG context
+         len: number of bytes
+Output:
+         out[]: key stream
+         ctx: DRBG context
+Return:null
+Others:
+************************************************************/
+static void SM4_DRBG_Blocks(SM4_DRBG_CTX *ctx, unsigned char out[], size_t len)
+{
+	SM4_CTR_CTX ctr;
+
+	SM4_CTR_AddCounter(ctx->V, 1, SM4_CTR_WIDTH128);
+	SM4_CTR_Init(&ctr, &ctx->key, ctx->V, SM4_CTR_WIDTH128);
+	memset(out, 0, len);
+	SM4_CTR_Update(&ctr, out, out, len);
+	SM4_CTR_AddCounter(ctx->V, (len + 15) / 16 - 1, SM4_CTR_WIDTH128);
+	memset(&ctr, 0, sizeof(ctr));
+}
+
+/************************************************************
+Function:
+         static void SM4_DRBG_Update(SM4_DRBG_CTX *ctx, const unsigned char data[SM4_DRBG_SEEDLEN]);
+Description:
+         CTR_DRBG_Update: (Key,V) = leftmost 256 bits of the key stream
+         xored with data
+Calls:
+         SM4_DRBG_Blocks;
+         SM4_SetEncKey
+Called By:
+         SM4_DRBG_Instantiate;
+         SM4_DRBG_Reseed;
+         SM4_DRBG_Generate
+Input:
+         ctx: DRBG context
+         data[]: provided data
+Output:
+         ctx: DRBG context
+Return:null
+Others:
+************************************************************/
+static void SM4_DRBG_Update(SM4_DRBG_CTX *ctx, const unsigned char data[SM4_DRBG_SEEDLEN])
+{
+	unsigned char temp[SM4_DRBG_SEEDLEN];
+	int i;
+
+	SM4_DRBG_Blocks(ctx, temp, SM4_DRBG_SEEDLEN);
+	for (i = 0; i < SM4_DRBG_SEEDLEN; i++)
+		temp[i] ^= data[i];
+	SM4_SetEncKey(temp, &ctx->key);
+	memcpy(ctx->V, temp + 16, 16);
+	memset(temp, 0, sizeof(temp));
+}
+
+/************************************************************
+Function:
+         static void SM4_DRBG_DF(const unsigned char *in[], const size_t inlen[], int count, unsigned char out[SM4_DRBG_SEEDLEN]);
+Description:
+         Block_Cipher_df of the concatenation of the input strings,
+         output length SM4_DRBG_SEEDLEN
+Calls:
+         SM4_SetEncKey;
+         SM4_CryptBlocks
+Called By:
+         SM4_DRBG_Instantiate;
+         SM4_DRBG_Reseed;
+         SM4_DRBG_Generate
+Input:
+         in[]: input strings, NULL entries are empty
+         inlen[]: byte lengths of the strings, sum at most SM4_DRBG_MAX_INPUT+64
+         count: number of strings
+Output:
+         out[]: derived seed
+Return:null
+Others:
+         S=L||N||input||0x80||0^pad is never built: its bytes are fed to
+         both BCC chains (IV 0 and IV 1) as they are produced.
+************************************************************/
+static void SM4_DRBG_DF(const unsigned char *in[], const size_t inlen[], int count, unsigned char out[SM4_DRBG_SEEDLEN])
+{
+	unsigned char K0[16] = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+	unsigned char X[32] = {0}, blk[16];
+	size_t L = 0, i;
+	unsigned int pos;
+	SM4_KEY K;
+	int j, k;
+
+	for (j = 0; j < count; j++)
+		L += inlen[j];
+
+	//both chains start with their IV block
+	SM4_SetEncKey(K0, &K);
+	X[16 + 3] = 1;
+	SM4_CryptBlocks(&K, X, X, 2);
+
+	SM4_PutU32(blk, (unsigned int)L);
+	SM4_PutU32(blk + 4, SM4_DRBG_SEEDLEN);
+	pos = 8;
+	for (j = 0; j < count; j++)
+	{
+		for (i = 0; i < inlen[j]; i++)
+		{
+			blk[pos++] = in[j][i];
+			if (pos < 16)
+				continue;
+			for (k = 0; k < 16; k++)
+			{
+				X[k] ^= blk[k];
+				X[16 + k] ^= blk[k];
+			}
+			SM4_CryptBlocks(&K, X, X, 2);
+			pos = 0;
+		}
+	}
+	blk[pos++] = 0x80;
+	memset(blk + pos, 0, 16 - pos);
+	for (k = 0; k < 16; k++)
+	{
+		X[k] ^= blk[k];
+		X[16 + k] ^= blk[k];
+	}
+	SM4_CryptBlocks(&K, X, X, 2);
+
+	//K=leftmost 128 bits, X=next 128 bits, output E(K,X), E(K,E(K,X))
+	SM4_SetEncKey(X, &K);
+	SM4_CryptBlocks(&K, X + 16, out, 1);
+	SM4_CryptBlocks(&K, out, out + 16, 1);
+	memset(X, 0, sizeof(X));
+	memset(&K, 0, sizeof(K));
+}
+
+/************************************************************
+Function:
+         int SM4_DRBG_Urandom(void *arg, unsigned char buf[], size_t len);
+Description:
+         Entropy source reading the kernel pool through getrandom
+Calls:
+Called By:
+         SM4_DRBG_Thread
+Input:
+         arg: unused
+         len: number of bytes
+Output:
+         buf[]: entropy
+Return:
+         1 the kernel pool could not be read; 0 success
+Others:
+         Same pool as /dev/urandom, read straight into buf[] without a
+         file descriptor or stdio buffer. Blocks only until the pool is
+         first initialized at boot.
+************************************************************/
+int SM4_DRBG_Urandom(void *arg, unsigned char buf[], size_t len)
+{
+	ssize_t n;
+
+	(void)arg;
+	while (len)
+	{
+		n = getrandom(buf, len, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return 1;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_DRBG_Instantiate(SM4_DRBG_CTX *ctx, SM4_DRBG_ENTROPY entropy, void *arg,
+                                  const unsigned char nonce[], size_t noncelen, const unsigned char pers[], size_t perslen);
+Description:
+         Seed a new instance from the entropy source, a nonce and an
+         optional personalization string
+Calls:
+         SM4_DRBG_DF;
+         SM4_DRBG_Update
+Called By:
+         SM4_DRBG_Thread;
+         SM4_DRBG_SelfCheck
+Input:
+         entropy: entropy source, also used by every reseed
+         arg: argument of entropy
+         nonce[]: nonce, at least 8 bytes recommended
+         noncelen: byte length of nonce[]
+         pers[]: personalization string, may be NULL
+         perslen: byte length of pers[]
+Output:
+         ctx: DRBG context, reseed interval SM4_DRBG_MAX_INTERVAL
+Return:
+         1 entropy source failed or input too long; 0 success
+Others:
+         The reseed interval may be lowered afterwards through
+         ctx->reseed_interval.
+************************************************************/
+int SM4_DRBG_Instantiate(SM4_DRBG_CTX *ctx, SM4_DRBG_ENTROPY entropy, void *arg,
+                         const unsigned char nonce[], size_t noncelen, const unsigned char pers[], size_t perslen)
+{
+	unsigned char ent[SM4_DRBG_ENTROPYLEN], seed[SM4_DRBG_SEEDLEN];
+	const unsigned char *in[3];
+	size_t inlen[3];
+
+	memset(ctx, 0, sizeof(*ctx));
+	if (noncelen > SM4_DRBG_MAX_INPUT || perslen > SM4_DRBG_MAX_INPUT - noncelen)
+		return 1;
+	if (entropy(arg, ent, sizeof(ent)))
+		return 1;
+
+	in[0] = ent;
+	inlen[0] = sizeof(ent);
+	in[1] = nonce;
+	inlen[1] = noncelen;
+	in[2] = pers;
+	inlen[2] = perslen;
+	SM4_DRBG_DF(in, inlen, 3, seed);
+
+	//Key=0, V=0; the wiped entropy buffer serves as the zero key
+	memset(ent, 0, sizeof(ent));
+	SM4_SetEncKey(ent, &ctx->key);
+	SM4_DRBG_Update(ctx, seed);
+
+	ctx->reseed_counter = 1;
+	ctx->reseed_interval = SM4_DRBG_MAX_INTERVAL;
+	ctx->entropy = entropy;
+	ctx->arg = arg;
+	ctx->instantiated = 1;
+	memset(seed, 0, sizeof(seed));
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_DRBG_Reseed(SM4_DRBG_CTX *ctx, const unsigned char add[], size_t addlen);
+Description:
+         Mix fresh entropy and optional additional input into the state
+Calls:
+         SM4_DRBG_DF;
+         SM4_DRBG_Update
+Called By:
+         SM4_DRBG_Generate;
+         SM4_DRBG_SelfCheck
+Input:
+         ctx: DRBG context
+         add[]: additional input, may be NULL
+         addlen: byte length of add[]
+Output:
+         ctx: DRBG context
+Return:
+         1 not instantiated, entropy source failed or input too long; 0 success
+Others:
+************************************************************/
+int SM4_DRBG_Reseed(SM4_DRBG_CTX *ctx, const unsigned char add[], size_t addlen)
+{
+	unsigned char ent[SM4_DRBG_ENTROPYLEN], seed[SM4_DRBG_SEEDLEN];
+	const unsigned char *in[2];
+	size_t inlen[2];
+
+	if (!ctx->instantiated || addlen > SM4_DRBG_MAX_INPUT)
+		return 1;
+	if (ctx->entropy(ctx->arg, ent, sizeof(ent)))
+		return 1;
+
+	in[0] = ent;
+	inlen[0] = sizeof(ent);
+	in[1] = add;
+	inlen[1] = addlen;
+	SM4_DRBG_DF(in, inlen, 2, seed);
+	SM4_DRBG_Update(ctx, seed);
+	ctx->reseed_counter = 1;
+	memset(ent, 0, sizeof(ent));
+	memset(seed, 0, sizeof(seed));
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_DRBG_Generate(SM4_DRBG_CTX *ctx, unsigned char out[], size_t len, int pr, const unsigned char add[], size_t addlen);
+Description:
+         Output random bytes of any length
+Calls:
+         SM4_DRBG_Reseed;
+         SM4_DRBG_DF;
+         SM4_DRBG_Update;
+         SM4_DRBG_Blocks
+Called By:
+         SM4_DRBG_SelfCheck
+Input:
+         ctx: DRBG context
+         len: number of bytes
+         pr: 1 prediction resistance, reseed before generating
+         add[]: additional input, may be NULL
+         addlen: byte length of add[]
+Output:
+         out[]: random bytes
+         ctx: DRBG context
+Return:
+         1 not instantiated, reseed failed or input too long; 0 success
+Others:
+         A call longer than SM4_DRBG_MAX_REQUEST is served as several
+         requests with the same additional input, each one followed by
+         the state update; a reseed is done whenever the interval runs
+         out. With prediction resistance the additional input goes into
+         the reseed, as in SP 800-90A.
+************************************************************/
+int SM4_DRBG_Generate(SM4_DRBG_CTX *ctx, unsigned char out[], size_t len, int pr, const unsigned char add[], size_t addlen)
+{
+	unsigned char A[SM4_DRBG_SEEDLEN];
+	const unsigned char *in[1];
+	size_t inlen[1], n;
+	int derived = 0, use, ret = 1;
+
+	if (!ctx->instantiated || addlen > SM4_DRBG_MAX_INPUT)
+		return 1;
+
+	do
+	{
+		n = len < SM4_DRBG_MAX_REQUEST ? len : SM4_DRBG_MAX_REQUEST;
+		use = 0;
+		if (pr || ctx->reseed_counter > ctx->reseed_interval)
+		{
+			if (SM4_DRBG_Reseed(ctx, add, addlen))
+				goto end;
+			pr = 0;
+		}
+		else if (addlen)
+		{
+			//derived once, used by every request of the call
+			if (!derived)
+			{
+				in[0] = add;
+				inlen[0] = addlen;
+				SM4_DRBG_DF(in, inlen, 1, A);
+				derived = 1;
+			}
+			SM4_DRBG_Update(ctx, A);
+			use = 1;
+		}
+
+		if (n)
+			SM4_DRBG_Blocks(ctx, out, n);
+		SM4_DRBG_Update(ctx, use ? A : SM4_DRBG_zero);
+		ctx->reseed_counter++;
+		out += n;
+		len -= n;
+	} while (len);
+	ret = 0;
+
+end:
+	memset(A, 0, sizeof(A));
+	return ret;
+}
+
+/************************************************************
+Function:
+         void SM4_DRBG_Uninstantiate(SM4_DRBG_CTX *ctx);
+Description:
+         Wipe the internal state
+Calls:
+Called By:
+Input:
+         ctx: DRBG context
+Output:
+         ctx: DRBG context
+Return:null
+Others:
+************************************************************/
+void SM4_DRBG_Uninstantiate(SM4_DRBG_CTX *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+/************************************************************
+Function:
+         SM4_DRBG_CTX *SM4_DRBG_Thread();
+Description:
+         Instance owned by the calling thread, seeded from getrandom at
+         first use and reseeded in a child process after fork
+Calls:
+         SM4_DRBG_Urandom;
+         SM4_DRBG_Instantiate;
+         SM4_DRBG_Reseed
+Called By:
+         SM4_DRBG_SelfCheck
+Input:
+Output:
+Return:
+         the instance; NULL the entropy source failed
+Others:
+         Threads never share the state, so no lock is taken. The address
+         of the instance is used as personalization string. fork copies
+         the instance into the child, so the process id is kept with it
+         and a changed id forces a reseed with the new id as additional
+         input; parent and child never output the same bytes.
+************************************************************/
+SM4_DRBG_CTX *SM4_DRBG_Thread()
+{
+	static _Thread_local SM4_DRBG_CTX ctx;
+	static _Thread_local pid_t owner;
+	unsigned char nonce[16];
+	SM4_DRBG_CTX *self = &ctx;
+	pid_t pid = getpid();
+
+	if (!ctx.instantiated)
+	{
+		if (SM4_DRBG_Urandom(NULL, nonce, sizeof(nonce)) ||
+			SM4_DRBG_Instantiate(&ctx, SM4_DRBG_Urandom, NULL, nonce, sizeof(nonce), (const unsigned char *)&self, sizeof(self)))
+			return NULL;
+		owner = pid;
+	}
+	else if (owner != pid)
+	{
+		if (SM4_DRBG_Reseed(&ctx, (const unsigned char *)&pid, sizeof(pid)))
+			return NULL;
+		owner = pid;
+	}
+	return &ctx;
+}
+
+//entropy source of the self-check, hands out a fixed string
+static int SM4_DRBG_TestEntropy(void *arg, unsigned char buf[], size_t len)
+{
+	memcpy(buf, *(const unsigned char **)arg, len);
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_DRBG_SelfCheck()
+Description:
+         Self-check with known answers
+Calls:
+         SM4_DRBG_Instantiate;
+         SM4_DRBG_Generate;
+         SM4_DRBG_Reseed;
+         SM4_DRBG_Thread
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         The answers were cross-checked with the OpenSSL CTR-DRBG using
+         SM4-CTR and the derivation function. Explicit reseed and
+         prediction resistance must give the same bytes, and one long
+         call the same as several calls of SM4_DRBG_MAX_REQUEST bytes.
+************************************************************/
+int SM4_DRBG_SelfCheck()
+{
+	unsigned char ent1[32], ent2[32], nonce[16], pers[16], add[16];
+	unsigned char out[64], out2[64], big[2 * SM4_DRBG_MAX_REQUEST + 100], big2[sizeof(big)];
+	unsigned char Std_g1[64] = {
+			0x6e, 0x4c, 0xbb, 0x3d, 0x36, 0x2d, 0xb3, 0xc5, 0xaa, 0xb6, 0xbd, 0x82, 0x7d, 0x8d, 0xf4, 0xa0,
+			0x06, 0x76, 0x9c, 0x83, 0xc2, 0x6f, 0x05, 0xda, 0x08, 0x4a, 0x65, 0x51, 0x15, 0xd1, 0x94, 0x57,
+			0xdd, 0xb8, 0xfb, 0xea, 0x16, 0x23, 0x0a, 0xd9, 0xc0, 0xca, 0x87, 0x13, 0x18, 0x26, 0x97, 0x37,
+			0x3d, 0x94, 0xaf, 0x77, 0x0f, 0x92, 0xa6, 0x3b, 0xd7, 0x1d, 0xee, 0x5d, 0x8a, 0xbe, 0x67, 0x79};
+	unsigned char Std_g2[64] = {
+			0x01, 0x3d, 0x9b, 0xe0, 0xe1, 0xc4, 0x5c, 0xfb, 0x68, 0x25, 0xfb, 0x6f, 0x5e, 0x35, 0xe2, 0xbe,
+			0x11, 0x3e, 0xbb, 0xb6, 0x8a, 0xe7, 0x19, 0x97, 0x1b, 0x00, 0x73, 0xb9, 0xba, 0xdb, 0x8e, 0x82,
+			0x6d, 0x5a, 0x2f, 0xb0, 0xbc, 0xf9, 0xdc, 0x4a, 0x40, 0x56, 0x3c, 0xbb, 0x73, 0xa2, 0x7a, 0x1d,
+			0x19, 0x9b, 0xf3, 0x52, 0x90, 0xc3, 0x5e, 0x5c, 0xfc, 0xa0, 0x37, 0xdd, 0xcb, 0x8c, 0x45, 0xd4};
+	unsigned char Std_g3[64] = {
+			0x57, 0x25, 0xc7, 0xab, 0x24, 0x13, 0xf2, 0x91, 0x3b, 0x29, 0xaf, 0xa6, 0x65, 0xb9, 0x0b, 0x6e,
+			0x73, 0x6a, 0xa5, 0xbb, 0xd4, 0x81, 0x20, 0x02, 0xd1, 0x2b, 0x09, 0x13, 0xed, 0xdd, 0xd9, 0x3d,
+			0x94, 0xd8, 0x90, 0x8a, 0xf9, 0x31, 0x8b, 0xcc, 0x09, 0x8b, 0x4b, 0xf8, 0xf3, 0x1f, 0xa7, 0x69,
+			0xf1, 0x22, 0xae, 0x07, 0xb6, 0x06, 0xbf, 0x7b, 0xfe, 0x8c, 0xac, 0xe3, 0xae, 0x06, 0xc9, 0x95};
+	const unsigned char *src = ent1;
+	SM4_DRBG_CTX ctx, ctx2;
+	int i, pr, fd[2], status;
+	pid_t child;
+	ssize_t n;
+
+	for (i = 0; i < 32; i++)
+	{
+		ent1[i] = (unsigned char)i;
+		ent2[i] = (unsigned char)(0x80 + i);
+	}
+	for (i = 0; i < 16; i++)
+	{
+		nonce[i] = (unsigned char)(0x20 + i);
+		pers[i] = (unsigned char)(0x40 + i);
+		add[i] = (unsigned char)(0x60 + i);
+	}
+
+	for (pr = 0; pr <= 1; pr++)
+	{
+		src = ent1;
+		if (SM4_DRBG_Instantiate(&ctx, SM4_DRBG_TestEntropy, &src, nonce, 16, pers, 16))
+			return 1;
+		if (SM4_DRBG_Generate(&ctx, out, 64, 0, NULL, 0) || memcmp(out, Std_g1, 64))
+			return 1;
+		if (SM4_DRBG_Generate(&ctx, out, 64, 0, add, 16) || memcmp(out, Std_g2, 64))
+			return 1;
+		src = ent2;
+		if (!pr && SM4_DRBG_Reseed(&ctx, add, 16))
+			return 1;
+		if (SM4_DRBG_Generate(&ctx, out, 64, pr, pr ? add : NULL, pr ? 16 : 0) || memcmp(out, Std_g3, 64))
+			return 1;
+	}
+
+	//one long call equals a sequence of maximal requests
+	ctx2 = ctx;
+	SM4_DRBG_Generate(&ctx, big, sizeof(big), 0, add, 16);
+	SM4_DRBG_Generate(&ctx2, big2, SM4_DRBG_MAX_REQUEST, 0, add, 16);
+	SM4_DRBG_Generate(&ctx2, big2 + SM4_DRBG_MAX_REQUEST, SM4_DRBG_MAX_REQUEST, 0, add, 16);
+	SM4_DRBG_Generate(&ctx2, big2 + 2 * SM4_DRBG_MAX_REQUEST, 100, 0, add, 16);
+	if (memcmp(big, big2, sizeof(big)) || memcmp(ctx.V, ctx2.V, 16))
+		return 1;
+
+	if (!SM4_DRBG_Thread() || SM4_DRBG_Generate(SM4_DRBG_Thread(), out, 64, 0, NULL, 0))
+		return 1;
+
+	//the child inherits the instance of this thread and must reseed
+	if (pipe(fd))
+		return 1;
+	child = fork();
+	if (child < 0)
+	{
+		close(fd[0]);
+		close(fd[1]);
+		return 1;
+	}
+	if (child == 0)
+	{
+		close(fd[0]);
+		if (!SM4_DRBG_Thread() || SM4_DRBG_Generate(SM4_DRBG_Thread(), out, 64, 0, NULL, 0))
+			_exit(1);
+		_exit(write(fd[1], out, 64) != 64);
+	}
+	close(fd[1]);
+	n = read(fd[0], out2, 64);
+	close(fd[0]);
+	if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) || n != 64)
+		return 1;
+	if (SM4_DRBG_Generate(SM4_DRBG_Thread(), out, 64, 0, NULL, 0) || !memcmp(out, out2, 64))
+		return 1;
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+/************************************************************
+FileName:
+     SM4_DRBG.h
+Version:
+     SM4_DRBG_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the context and function declarations of the
+     SM4 based CTR_DRBG with derivation function (NIST SP 800-90A).
+Function List:
+     1. SM4_DRBG_Urandom        //Entropy from getrandom
+     2. SM4_DRBG_Instantiate    //Seed a new instance
+     3. SM4_DRBG_Reseed         //Add fresh entropy
+     4. SM4_DRBG_Generate       //Output random bytes
+     5. SM4_DRBG_Uninstantiate  //Wipe an instance
+     6. SM4_DRBG_Thread         //Instance of the calling thread
+     7. SM4_DRBG_SelfCheck      //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+#define SM4_DRBG_SEEDLEN    32 //key and V, bytes
+#define SM4_DRBG_ENTROPYLEN 32 //entropy input requested per (re)seed
+
+//bytes per internal request, 2^19 bits, larger calls are split
+#define SM4_DRBG_MAX_REQUEST (1 << 16)
+//largest reseed interval allowed, in requests
+#define SM4_DRBG_MAX_INTERVAL (1ULL << 48)
+//largest nonce, personalization string or additional input, bytes
+#define SM4_DRBG_MAX_INPUT 0xffffff00UL
+
+//entropy source, fill buf[] with len bytes; return 0 on success
+typedef int (*SM4_DRBG_ENTROPY)(void *arg, unsigned char buf[], size_t len);
+
+typedef struct
+{
+     SM4_KEY key;                         //expanded working key
+     unsigned char V[16];                 //counter
+     unsigned long long reseed_counter;   //requests since the last (re)seed, plus one
+     unsigned long long reseed_interval;  //reseed when reseed_counter exceeds it
+     SM4_DRBG_ENTROPY entropy;
+     void *arg;                           //argument of entropy
+     int instantiated;
+} SM4_DRBG_CTX;
+
+int SM4_DRBG_Urandom(void *arg, unsigned char buf[], size_t len);
+int SM4_DRBG_Instantiate(SM4_DRBG_CTX *ctx, SM4_DRBG_ENTROPY entropy, void *arg,
+                         const unsigned char nonce[], size_t noncelen, const unsigned char pers[], size_t perslen);
+int SM4_DRBG_Reseed(SM4_DRBG_CTX *ctx, const unsigned char add[], size_t addlen);
+int SM4_DRBG_Generate(SM4_DRBG_CTX *ctx, unsigned char out[], size_t len, int pr, const unsigned char add[], size_t addlen);
+void SM4_DRBG_Uninstantiate(SM4_DRBG_CTX *ctx);
+SM4_DRBG_CTX *SM4_DRBG_Thread();
+int SM4_DRBG_SelfCheck();
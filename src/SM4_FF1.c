@@ -0,0 +1,512 @@
+/************************************************************
+FileName:
+     SM4_FF1.c
+Version:
+     SM4_FF1_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 FF1 format-preserving encryption (NIST
+     SP 800-38G). The block P and every block of Q that holds only tweak
+     bytes are the same in all ten rounds and for every record of the
+     same length, so their CBC-MAC is computed once by SM4_FF1_Init.
+     The batch functions run the rounds of up to 16 records side by
+     side, each CBC-MAC step and the expansion of S being one call of
+     the multi-block kernel for all of them.
+     Only the m low digits of y are needed, so NUM(A) is never formed:
+     y is reduced digit by digit and added to A as a numeral string.
+Function List:
+     1. SM4_FF1_Init          //Bind key, radix, length and tweak
+     2. SM4_FF1_Encrypt       //Encrypt one numeral string
+     3. SM4_FF1_Decrypt       //Decrypt one numeral string
+     4. SM4_FF1_EncryptBatch  //Encrypt many numeral strings
+     5. SM4_FF1_DecryptBatch  //Decrypt many numeral strings
+     6. SM4_FF1_SelfCheck     //Self-check
+************************************************************/
+
+#include "SM4_FF1.h"
+
+#include <string.h>
+
+//bytes of NUM(B) and of S for the longest strings of the largest radix
+#define SM4_FF1_MAX_B ((SM4_FF1_MAX_LEN + 1) / 2 * 2)
+#define SM4_FF1_MAX_D (SM4_FF1_MAX_B + 4)
+//limbs of radix^v
+#define SM4_FF1_LIMBS (SM4_FF1_MAX_B / 4 + 1)
+
+//xor a block into the CBC-MAC state
+static void SM4_FF1_Xor(unsigned char X[16], const unsigned char in[16])
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		X[i] ^= in[i];
+}
+
+/************************************************************
+Function:
+         int SM4_FF1_Init(SM4_FF1_CTX *ctx, const SM4_KEY *key, unsigned int radix, unsigned int n,
+                          const unsigned char tweak[], size_t tweaklen);
+Description:
+         Set up a context for strings of n numerals in base radix
+         under one tweak, and precompute the tweak prefix of the PRF
+Calls:
+         SM4_CryptBlocks
+Called By:
+         SM4_FF1_SelfCheck
+Input:
+         key: expanded encryption key, see SM4_SetEncKey
+         radix: base of the numerals, 2..SM4_FF1_MAX_RADIX
+         n: numerals per string, 2..SM4_FF1_MAX_LEN with radix^n>=1000000
+         tweak[]: tweak, may be NULL
+         tweaklen: byte length of tweak[]
+Output:
+         ctx: FF1 context
+Return:
+         1 bad radix, length or tweak length; 0 success
+Others:
+************************************************************/
+int SM4_FF1_Init(SM4_FF1_CTX *ctx, const SM4_KEY *key, unsigned int radix, unsigned int n,
+                 const unsigned char tweak[], size_t tweaklen)
+{
+	unsigned int R[SM4_FF1_LIMBS] = {1}, bits, i, k;
+	unsigned long long t, c, pow = 1;
+	unsigned char P[16];
+
+	if (radix < 2 || radix > SM4_FF1_MAX_RADIX || n < 2 || n > SM4_FF1_MAX_LEN || tweaklen > 0xffffffffUL)
+		return 1;
+	for (i = 0; i < n && pow < 1000000; i++)
+		pow *= radix;
+	if (pow < 1000000)
+		return 1;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->key = *key;
+	ctx->radix = radix;
+	ctx->n = n;
+	ctx->u = n / 2;
+	ctx->v = n - ctx->u;
+
+	//b=ceil(ceil(v*log2(radix))/8), the bit length of radix^v-1
+	for (i = 0; i < ctx->v; i++)
+		for (k = 0, c = 0; k < SM4_FF1_LIMBS; k++)
+		{
+			c += (unsigned long long)R[k] * radix;
+			R[k] = (unsigned int)c;
+			c >>= 32;
+		}
+	for (k = 0; !R[k]--; k++)
+		;
+	for (k = SM4_FF1_LIMBS, bits = 32 * k; k && !R[k - 1]; k--)
+		bits -= 32;
+	for (; bits && !(R[(bits - 1) / 32] >> ((bits - 1) % 32)); bits--)
+		;
+	ctx->b = (bits + 7) / 8;
+	ctx->d = 4 * ((ctx->b + 3) / 4) + 4;
+
+	//P=[1]||[2]||[1]||[radix]^3||[10]||[u mod 256]||[n]^4||[t]^4
+	P[0] = 1;
+	P[1] = 2;
+	P[2] = 1;
+	P[3] = (unsigned char)(radix >> 16);
+	P[4] = (unsigned char)(radix >> 8);
+	P[5] = (unsigned char)radix;
+	P[6] = 10;
+	P[7] = (unsigned char)ctx->u;
+	SM4_PutU32(P + 8, n);
+	SM4_PutU32(P + 12, (unsigned int)tweaklen);
+	SM4_CryptBlocks(key, P, ctx->Y, 1);
+
+	//T||[0]^((-t-b-1) mod 16), all but the last partial block
+	t = tweaklen + ((16 - (tweaklen + ctx->b + 1) % 16) % 16);
+	for (c = 0; c + 16 <= t; c += 16)
+	{
+		for (i = 0; i < 16; i++)
+			P[i] = c + i < tweaklen ? tweak[c + i] : 0;
+		SM4_FF1_Xor(ctx->Y, P);
+		SM4_CryptBlocks(key, ctx->Y, ctx->Y, 1);
+	}
+	ctx->taillen = (unsigned int)(t - c);
+	for (i = 0; i < ctx->taillen; i++)
+		ctx->tail[i] = c + i < tweaklen ? tweak[c + i] : 0;
+	return 0;
+}
+
+/************************************************************
+Function:
+         static void SM4_FF1_Num(const unsigned int X[], unsigned int len, unsigned int radix, unsigned char out[], unsigned int b);
+Description:
+         [NUM_radix(X)]^b, the big-endian bytes of a numeral string
+Calls:
+Called By:
+         SM4_FF1_Rounds
+Input:
+         X[]: numeral string, most significant first
+         len: numerals in X[]
+         radix: base of the numerals
+         b: number of output bytes, large enough for radix^len-1
+Output:
+         out[]: b bytes
+Return:null
+Others:
+************************************************************/
+static void SM4_FF1_Num(const unsigned int X[], unsigned int len, unsigned int radix, unsigned char out[], unsigned int b)
+{
+	unsigned int N[SM4_FF1_LIMBS] = {0}, i, k, limbs = (b + 3) / 4;
+	unsigned long long c;
+
+	for (i = 0; i < len; i++)
+		for (k = 0, c = X[i]; k < limbs; k++)
+		{
+			c += (unsigned long long)N[k] * radix;
+			N[k] = (unsigned int)c;
+			c >>= 32;
+		}
+	for (i = 0; i < b; i++)
+		out[b - 1 - i] = (unsigned char)(N[i / 4] >> (8 * (i % 4)));
+}
+
+/************************************************************
+Function:
+         static void SM4_FF1_Rounds(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count, int enc);
+Description:
+         The ten Feistel rounds for up to SM4_FF1_LANES records
+Calls:
+         SM4_FF1_Num;
+         SM4_CryptBlocks
+Called By:
+         SM4_FF1_Crypt
+Input:
+         ctx: FF1 context
+         X[]: count input strings of ctx->n numerals, checked by the caller
+         count: number of records, 1..SM4_FF1_LANES
+         enc: 1 encrypt, 0 decrypt
+Output:
+         Y[]: count output strings, may be the same as X[]
+Return:null
+Others:
+         Encryption: C=A+y mod radix^m, A=B, B=C, Q made from B.
+         Decryption: C=B-y mod radix^m, B=A, A=C, Q made from A.
+         The halves live in H[0], H[1] and only trade their roles.
+************************************************************/
+static void SM4_FF1_Rounds(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count, int enc)
+{
+	unsigned int H[2][SM4_FF1_LANES][SM4_FF1_MAX_LEN];
+	unsigned char Q[SM4_FF1_LANES][16 + SM4_FF1_MAX_B + 16];
+	unsigned char R[SM4_FF1_LANES * 16], S[SM4_FF1_LANES][SM4_FF1_MAX_D + 16];
+	unsigned char E[SM4_FF1_LANES * SM4_FF1_MAX_D];
+	unsigned int radix = ctx->radix, u = ctx->u, n = ctx->n;
+	unsigned int qlen = ctx->taillen + 1 + ctx->b, extra = (ctx->d - 1) / 16;
+	unsigned int a, m, j, k, *C, *Z, digit, carry;
+	unsigned long long r;
+	size_t l;
+	int i;
+
+	//a indexes the half playing A, of length u before the first round
+	for (l = 0; l < count; l++)
+	{
+		memcpy(H[0][l], X + l * n, u * sizeof(unsigned int));
+		memcpy(H[1][l], X + l * n + u, (n - u) * sizeof(unsigned int));
+	}
+	a = 0;
+
+	for (i = enc ? 0 : 9; enc ? i < 10 : i >= 0; i += enc ? 1 : -1)
+	{
+		m = (i & 1) ? ctx->v : u;
+
+		//R=PRF(P||Q), continuing from the precomputed tweak prefix
+		for (l = 0; l < count; l++)
+		{
+			memcpy(Q[l], ctx->tail, ctx->taillen);
+			Q[l][ctx->taillen] = (unsigned char)i;
+			SM4_FF1_Num(H[enc ? a ^ 1 : a][l], n - m, radix, Q[l] + ctx->taillen + 1, ctx->b);
+			memcpy(R + 16 * l, ctx->Y, 16);
+		}
+		for (j = 0; j < qlen; j += 16)
+		{
+			for (l = 0; l < count; l++)
+				SM4_FF1_Xor(R + 16 * l, Q[l] + j);
+			SM4_CryptBlocks(&ctx->key, R, R, count);
+		}
+
+		//S=R||E(R^[1]^16)||E(R^[2]^16)||...
+		for (l = 0; l < count; l++)
+		{
+			memcpy(S[l], R + 16 * l, 16);
+			for (k = 0; k < extra; k++)
+			{
+				memcpy(E + 16 * (l * extra + k), R + 16 * l, 16);
+				E[16 * (l * extra + k) + 15] ^= (unsigned char)(k + 1);
+			}
+		}
+		if (extra)
+		{
+			SM4_CryptBlocks(&ctx->key, E, E, count * extra);
+			for (l = 0; l < count; l++)
+				memcpy(S[l] + 16, E + 16 * l * extra, 16 * extra);
+		}
+
+		//C=A+-y, one digit of y at a time from the least significant
+		for (l = 0; l < count; l++)
+		{
+			C = enc ? H[a][l] : H[a ^ 1][l];
+			carry = 0;
+			for (j = m; j > 0; j--)
+			{
+				//digit=y mod radix, y=y/radix over the d big-endian bytes
+				for (k = 0, r = 0; k < ctx->d; k += 4)
+				{
+					r = (r << 32) | SM4_GetU32(S[l] + k);
+					SM4_PutU32(S[l] + k, (unsigned int)(r / radix));
+					r %= radix;
+				}
+				digit = (unsigned int)r;
+				Z = &C[j - 1];
+				if (enc)
+				{
+					r = (unsigned long long)*Z + digit + carry;
+					carry = r >= radix;
+					*Z = (unsigned int)(carry ? r - radix : r);
+				}
+				else
+				{
+					r = (unsigned long long)digit + carry;
+					carry = *Z < r;
+					*Z = (unsigned int)(carry ? *Z + radix - r : *Z - r);
+				}
+			}
+		}
+		a ^= 1;
+	}
+
+	//A has length u again after ten rounds
+	for (l = 0; l < count; l++)
+	{
+		memcpy(Y + l * n, H[a][l], u * sizeof(unsigned int));
+		memcpy(Y + l * n + u, H[a ^ 1][l], (n - u) * sizeof(unsigned int));
+	}
+}
+
+/************************************************************
+Function:
+         static int SM4_FF1_Crypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count, int enc);
+Description:
+         Check the numerals and run the rounds SM4_FF1_LANES records
+         at a time
+Calls:
+         SM4_FF1_Rounds
+Called By:
+         SM4_FF1_Encrypt;
+         SM4_FF1_Decrypt;
+         SM4_FF1_EncryptBatch;
+         SM4_FF1_DecryptBatch
+Input:
+         ctx: FF1 context
+         X[]: count strings of ctx->n numerals
+         count: number of records
+         enc: 1 encrypt, 0 decrypt
+Output:
+         Y[]: count strings of ctx->n numerals, may be the same as X[]
+Return:
+         1 a numeral is not less than the radix; 0 success
+Others:
+************************************************************/
+static int SM4_FF1_Crypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count, int enc)
+{
+	size_t i, k;
+
+	for (i = 0; i < count * ctx->n; i++)
+		if (X[i] >= ctx->radix)
+			return 1;
+
+	for (i = 0; i < count; i += k)
+	{
+		k = count - i < SM4_FF1_LANES ? count - i : SM4_FF1_LANES;
+		SM4_FF1_Rounds(ctx, X + i * ctx->n, Y + i * ctx->n, k, enc);
+	}
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_FF1_Encrypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[]);
+Description:
+         FF1 encryption of one numeral string
+Calls:
+         SM4_FF1_Crypt
+Called By:
+         SM4_FF1_SelfCheck
+Input:
+         ctx: FF1 context, see SM4_FF1_Init
+         X[]: ctx->n numerals, most significant first
+Output:
+         Y[]: ctx->n numerals, may be the same as X[]
+Return:
+         1 a numeral is not less than the radix; 0 success
+Others:
+************************************************************/
+int SM4_FF1_Encrypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[])
+{
+	return SM4_FF1_Crypt(ctx, X, Y, 1, 1);
+}
+
+/************************************************************
+Function:
+         int SM4_FF1_Decrypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[]);
+Description:
+         FF1 decryption of one numeral string
+Calls:
+         SM4_FF1_Crypt
+Called By:
+         SM4_FF1_SelfCheck
+Input:
+         ctx: FF1 context, see SM4_FF1_Init
+         X[]: ctx->n numerals, most significant first
+Output:
+         Y[]: ctx->n numerals, may be the same as X[]
+Return:
+         1 a numeral is not less than the radix; 0 success
+Others:
+************************************************************/
+int SM4_FF1_Decrypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[])
+{
+	return SM4_FF1_Crypt(ctx, X, Y, 1, 0);
+}
+
+/************************************************************
+Function:
+         int SM4_FF1_EncryptBatch(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count);
+Description:
+         FF1 encryption of many numeral strings of the same length
+         under the same tweak
+Calls:
+         SM4_FF1_Crypt
+Called By:
+         SM4_FF1_SelfCheck
+Input:
+         ctx: FF1 context, see SM4_FF1_Init
+         X[]: count strings of ctx->n numerals, one after the other
+         count: number of records
+Output:
+         Y[]: count strings of ctx->n numerals, may be the same as X[]
+Return:
+         1 a numeral is not less than the radix, nothing is written; 0 success
+Others:
+************************************************************/
+int SM4_FF1_EncryptBatch(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count)
+{
+	return SM4_FF1_Crypt(ctx, X, Y, count, 1);
+}
+
+/************************************************************
+Function:
+         int SM4_FF1_DecryptBatch(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count);
+Description:
+         FF1 decryption of many numeral strings of the same length
+         under the same tweak
+Calls:
+         SM4_FF1_Crypt
+Called By:
+         SM4_FF1_SelfCheck
+Input:
+         ctx: FF1 context, see SM4_FF1_Init
+         X[]: count strings of ctx->n numerals, one after the other
+         count: number of records
+Output:
+         Y[]: count strings of ctx->n numerals, may be the same as X[]
+Return:
+         1 a numeral is not less than the radix, nothing is written; 0 success
+Others:
+************************************************************/
+int SM4_FF1_DecryptBatch(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count)
+{
+	return SM4_FF1_Crypt(ctx, X, Y, count, 0);
+}
+
+/************************************************************
+Function:
+         int SM4_FF1_SelfCheck()
+Description:
+         Self-check with known answers
+Calls:
+         SM4_SetEncKey;
+         SM4_FF1_Init;
+         SM4_FF1_Encrypt;
+         SM4_FF1_Decrypt;
+         SM4_FF1_EncryptBatch;
+         SM4_FF1_DecryptBatch
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         The inputs and tweaks are those of the NIST FF1 samples 1-3, the
+         answers are the SM4 results. A radix 2^16 string exercises the
+         multi-block Q and S; a batch of 37 records must match the
+         single record functions.
+************************************************************/
+int SM4_FF1_SelfCheck()
+{
+	unsigned char key[16] = {
+			0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10};
+	unsigned char tweak2[10] = {0x39, 0x38, 0x37, 0x36, 0x35, 0x34, 0x33, 0x32, 0x31, 0x30};
+	unsigned char tweak3[11] = {0x37, 0x37, 0x37, 0x37, 0x70, 0x71, 0x72, 0x73, 0x37, 0x37, 0x37};
+	unsigned char tweak4[20];
+	unsigned int X1[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	unsigned int Std_1[10] = {4, 8, 6, 5, 2, 2, 9, 0, 6, 7};
+	unsigned int Std_2[10] = {0, 1, 6, 7, 3, 0, 3, 6, 6, 2};
+	unsigned int Std_3[19] = {4, 26, 6, 12, 22, 1, 9, 25, 11, 25, 33, 15, 27, 34, 4, 0, 27, 14, 19};
+	unsigned int Std_4[40] = {
+			47396, 17627, 48079, 21593, 54734, 48453, 37135, 65308, 39413, 54225,
+			16736, 7977, 1883, 8355, 51567, 50517, 26276, 61010, 65078, 24623,
+			20584, 49636, 18640, 61640, 9881, 19741, 38213, 20814, 43327, 26839,
+			17797, 34885, 58401, 24215, 5469, 26151, 27853, 17889, 12606, 29890};
+	unsigned int X3[19], X4[40], out[40], back[40];
+	unsigned int batch[37 * 16], enc[37 * 16];
+	SM4_FF1_CTX ctx;
+	SM4_KEY ek;
+	unsigned int i;
+
+	SM4_SetEncKey(key, &ek);
+	for (i = 0; i < 19; i++)
+		X3[i] = i;
+	for (i = 0; i < 40; i++)
+		X4[i] = (i * 7919 + 13) % 65536;
+	for (i = 0; i < 20; i++)
+		tweak4[i] = (unsigned char)i;
+
+	if (SM4_FF1_Init(&ctx, &ek, 10, 10, NULL, 0) || SM4_FF1_Encrypt(&ctx, X1, out) || memcmp(out, Std_1, sizeof(Std_1)))
+		return 1;
+	if (SM4_FF1_Decrypt(&ctx, out, back) || memcmp(back, X1, sizeof(X1)))
+		return 1;
+	if (SM4_FF1_Init(&ctx, &ek, 10, 10, tweak2, 10) || SM4_FF1_Encrypt(&ctx, X1, out) || memcmp(out, Std_2, sizeof(Std_2)))
+		return 1;
+	if (SM4_FF1_Init(&ctx, &ek, 36, 19, tweak3, 11) || SM4_FF1_Encrypt(&ctx, X3, out) || memcmp(out, Std_3, sizeof(Std_3)))
+		return 1;
+	if (SM4_FF1_Decrypt(&ctx, out, back) || memcmp(back, X3, sizeof(X3)))
+		return 1;
+	if (SM4_FF1_Init(&ctx, &ek, 65536, 40, tweak4, 20) || SM4_FF1_Encrypt(&ctx, X4, out) || memcmp(out, Std_4, sizeof(Std_4)))
+		return 1;
+	if (SM4_FF1_Decrypt(&ctx, out, back) || memcmp(back, X4, sizeof(X4)))
+		return 1;
+
+	//16 digit card numbers
+	for (i = 0; i < 37 * 16; i++)
+		batch[i] = (i * 7 + i / 16) % 10;
+	if (SM4_FF1_Init(&ctx, &ek, 10, 16, tweak2, 10) || SM4_FF1_EncryptBatch(&ctx, batch, enc, 37))
+		return 1;
+	for (i = 0; i < 37; i++)
+	{
+		SM4_FF1_Encrypt(&ctx, batch + 16 * i, out);
+		if (memcmp(out, enc + 16 * i, 16 * sizeof(unsigned int)))
+			return 1;
+	}
+	if (SM4_FF1_DecryptBatch(&ctx, enc, enc, 37) || memcmp(enc, batch, sizeof(batch)))
+		return 1;
+	X1[3] = 10;
+	if (!SM4_FF1_Encrypt(&ctx, X1, out))
+		return 1;
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+/************************************************************
+FileName:
+     SM4_FF1.h
+Version:
+     SM4_FF1_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the context and function declarations of the
+     SM4 FF1 format-preserving encryption (NIST SP 800-38G).
+Function List:
+     1. SM4_FF1_Init          //Bind key, radix, length and tweak
+     2. SM4_FF1_Encrypt       //Encrypt one numeral string
+     3. SM4_FF1_Decrypt       //Decrypt one numeral string
+     4. SM4_FF1_EncryptBatch  //Encrypt many numeral strings
+     5. SM4_FF1_DecryptBatch  //Decrypt many numeral strings
+     6. SM4_FF1_SelfCheck     //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+#define SM4_FF1_MAX_RADIX 65536
+#define SM4_FF1_MAX_LEN   128 //numerals per string
+
+//records whose Feistel rounds share one kernel call
+#define SM4_FF1_LANES 16
+
+typedef struct
+{
+     SM4_KEY key;
+     unsigned int radix, n;  //alphabet size and numerals per string
+     unsigned int u, v;      //lengths of the two halves
+     unsigned int b, d;      //bytes of NUM(B) in Q and of the output S
+     unsigned char Y[16];    //CBC-MAC of P and the whole tweak blocks of Q
+     unsigned char tail[16]; //tweak and padding bytes in front of the round number
+     unsigned int taillen;
+} SM4_FF1_CTX;
+
+int SM4_FF1_Init(SM4_FF1_CTX *ctx, const SM4_KEY *key, unsigned int radix, unsigned int n,
+                 const unsigned char tweak[], size_t tweaklen);
+int SM4_FF1_Encrypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[]);
+int SM4_FF1_Decrypt(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[]);
+int SM4_FF1_EncryptBatch(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count);
+int SM4_FF1_DecryptBatch(const SM4_FF1_CTX *ctx, const unsigned int X[], unsigned int Y[], size_t count);
+int SM4_FF1_SelfCheck();
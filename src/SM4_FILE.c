@@ -0,0 +1,622 @@
+/************************************************************
+FileName:
+     SM4_FILE.c
+Version:
+     SM4_FILE_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide streaming SM4 CTR, GCM and XTS encryption from
+     one file descriptor into another. The data moves in stages of
+     SM4_FILE_STAGE bytes per thread through two output buffers: while
+     the worker pool encrypts one stage into a buffer, a writer thread
+     writes the previous one. A regular input file is mapped and the
+     kernel is asked to read the next stage ahead, so reading, the
+     cipher and writing all overlap; pipes are read into the free
+     output buffer and encrypted in place. GCM decryption releases no
+     plain text before the tag is verified: the mapped cipher text is
+     hashed in a first pass and only then decrypted, input that cannot
+     be mapped is first copied to a temporary file.
+Function List:
+     1. SM4_FILE_Crypt      //Encrypt/decrypt a file descriptor into another
+     2. SM4_FILE_SelfCheck  //Self-check
+************************************************************/
+
+#include "SM4_FILE.h"
+#include "SM4_CTR.h"
+#include "SM4_GCM.h"
+#include "SM4_XTS.h"
+#include "SM4_MT.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//the output buffers and the thread writing them
+typedef struct
+{
+	int fd;
+	pthread_t tid;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned char *buf[2];
+	size_t len[2];
+	int full[2];   //buffer waits to be written
+	int quit, err; //no more buffers, write failed or abandoned
+} SM4_FILE_WRITER;
+
+//cipher state carried from stage to stage
+typedef struct
+{
+	int mode, enc;
+	SM4_MT_POOL pool;
+	SM4_KEY key;
+	unsigned char ctr[16];
+	SM4_GCM_CTX gcm;
+	SM4_XTS_CTX xts;
+	unsigned long long sector;
+} SM4_FILE_CTX;
+
+typedef struct
+{
+	const SM4_XTS_CTX *ctx;
+	unsigned long long sector;
+	const unsigned char *in;
+	unsigned char *out;
+	size_t sectors, chunk;
+} SM4_FILE_XTS_JOB;
+
+static size_t SM4_FILE_Read(int fd, unsigned char buf[], size_t len, int *err)
+{
+	size_t got = 0;
+	ssize_t r;
+
+	while (got < len)
+	{
+		r = read(fd, buf + got, len - got);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			*err = 1;
+		if (r <= 0)
+			break;
+		got += (size_t)r;
+	}
+	return got;
+}
+
+static int SM4_FILE_Write(int fd, const unsigned char buf[], size_t len)
+{
+	ssize_t r;
+
+	while (len)
+	{
+		r = write(fd, buf, len);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return 1;
+		buf += r;
+		len -= (size_t)r;
+	}
+	return 0;
+}
+
+//the body of the writer thread, buffers are written in turn
+static void *SM4_FILE_Writer(void *p)
+{
+	SM4_FILE_WRITER *w = (SM4_FILE_WRITER *)p;
+	int i = 0, err;
+
+	pthread_mutex_lock(&w->lock);
+	for (;;)
+	{
+		while (!w->full[i] && !w->quit)
+			pthread_cond_wait(&w->cond, &w->lock);
+		if (!w->full[i])
+			break;
+		err = w->err;
+		pthread_mutex_unlock(&w->lock);
+		if (!err)
+			err = SM4_FILE_Write(w->fd, w->buf[i], w->len[i]);
+		pthread_mutex_lock(&w->lock);
+		w->err |= err;
+		w->full[i] = 0;
+		pthread_cond_broadcast(&w->cond);
+		i ^= 1;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return NULL;
+}
+
+//wait until buffer i is written, NULL after a write error
+static unsigned char *SM4_FILE_Slot(SM4_FILE_WRITER *w, int i)
+{
+	unsigned char *buf;
+
+	pthread_mutex_lock(&w->lock);
+	while (w->full[i] && !w->err)
+		pthread_cond_wait(&w->cond, &w->lock);
+	buf = w->err ? NULL : w->buf[i];
+	pthread_mutex_unlock(&w->lock);
+	return buf;
+}
+
+//hand len bytes of buffer i to the writer
+static void SM4_FILE_Put(SM4_FILE_WRITER *w, int i, size_t len)
+{
+	pthread_mutex_lock(&w->lock);
+	w->len[i] = len;
+	w->full[i] = 1;
+	pthread_cond_broadcast(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+}
+
+//copy the rest of in into a temporary file, -1 on failure
+static int SM4_FILE_Spool(int in, unsigned char buf[], size_t len)
+{
+	FILE *fp = tmpfile();
+	size_t n;
+	int fd, err = 0;
+
+	if (!fp)
+		return -1;
+	fd = dup(fileno(fp));
+	fclose(fp);
+	if (fd < 0)
+		return -1;
+	do
+	{
+		n = SM4_FILE_Read(in, buf, len, &err);
+		if (err || SM4_FILE_Write(fd, buf, n))
+		{
+			close(fd);
+			return -1;
+		}
+	} while (n == len);
+	if (lseek(fd, 0, SEEK_SET))
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+//let the writer finish (or drop, after a failure) its buffers and stop it
+static int SM4_FILE_Stop(SM4_FILE_WRITER *w, int fail)
+{
+	pthread_mutex_lock(&w->lock);
+	w->quit = 1;
+	w->err |= fail;
+	pthread_cond_broadcast(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+	pthread_join(w->tid, NULL);
+	pthread_mutex_destroy(&w->lock);
+	pthread_cond_destroy(&w->cond);
+	return w->err;
+}
+
+static void SM4_FILE_XTSTask(void *arg, size_t i)
+{
+	SM4_FILE_XTS_JOB *job = (SM4_FILE_XTS_JOB *)arg;
+	size_t off = i * job->chunk, n = job->sectors - off;
+
+	if (n > job->chunk)
+		n = job->chunk;
+	SM4_XTS_CryptSectors(job->ctx, job->sector + off, SM4_FILE_SECTOR,
+	                     job->in + off * SM4_FILE_SECTOR, job->out + off * SM4_FILE_SECTOR, n);
+}
+
+/************************************************************
+Function:
+         static int SM4_FILE_Process(SM4_FILE_CTX *c, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Encrypt or decrypt one stage on the worker pool
+Calls:
+         SM4_MT_CTR;
+         SM4_CTR_AddCounter;
+         SM4_MT_GCM_EncryptUpdate;
+         SM4_MT_GCM_DecryptUpdate;
+         SM4_MT_Run;
+         SM4_XTS_Crypt
+Called By:
+         SM4_FILE_Crypt
+Input:
+         c: cipher state
+         in[]: input data
+         len: byte length of in[], a multiple of SM4_FILE_SECTOR except
+              for the last stage
+Output:
+         c: state for the next stage
+         out[]: output data, may be the same as in[]
+Return:
+         1 text too long for GCM or last XTS sector shorter than a
+         block; 0 success
+Others:
+************************************************************/
+static int SM4_FILE_Process(SM4_FILE_CTX *c, const unsigned char in[], unsigned char out[], size_t len)
+{
+	SM4_FILE_XTS_JOB job;
+	unsigned char tweak[16];
+	size_t r = len % SM4_FILE_SECTOR, full = len / SM4_FILE_SECTOR;
+	int j;
+
+	switch (c->mode)
+	{
+	case SM4_FILE_CTR:
+		SM4_MT_CTR(&c->pool, &c->key, c->ctr, SM4_CTR_WIDTH128, in, out, len);
+		SM4_CTR_AddCounter(c->ctr, len / 16, SM4_CTR_WIDTH128);
+		return 0;
+	case SM4_FILE_GCM:
+		if (c->enc)
+			return SM4_MT_GCM_EncryptUpdate(&c->pool, &c->gcm, in, out, len);
+		return SM4_MT_GCM_DecryptUpdate(&c->pool, &c->gcm, in, out, len);
+	default:
+		if (r && r < 16)
+			return 1;
+		if (full)
+		{
+			job.ctx = &c->xts;
+			job.sector = c->sector;
+			job.in = in;
+			job.out = out;
+			job.sectors = full;
+			job.chunk = (full + c->pool.threads) / (c->pool.threads + 1);
+			SM4_MT_Run(&c->pool, SM4_FILE_XTSTask, &job, (full + job.chunk - 1) / job.chunk);
+			c->sector += full;
+		}
+		if (r)
+		{
+			memset(tweak, 0, 16);
+			for (j = 0; j < 8; j++)
+				tweak[j] = (unsigned char)(c->sector >> (8 * j));
+			SM4_XTS_Crypt(&c->xts, tweak, in + len - r, out + len - r, r);
+			c->sector++;
+		}
+		return 0;
+	}
+}
+
+/************************************************************
+Function:
+         int SM4_FILE_Crypt(const SM4_FILE_PARAM *param, int in, int out);
+Description:
+         Encrypt or decrypt everything read from in and write the result
+         to out
+Calls:
+         SM4_MT_Init;
+         SM4_MT_Free;
+         SM4_GCM_Init;
+         SM4_GCM_SetIV;
+         SM4_GCM_Tag;
+         SM4_GCM_CheckTag;
+         SM4_MT_GCM_HashUpdate;
+         SM4_XTS_Init;
+         SM4_FILE_Spool;
+         SM4_FILE_Process
+Called By:
+         main;
+         SM4_FILE_SelfCheck
+Input:
+         param: mode, direction, key, IV and number of worker threads
+         in: input file descriptor, mapped when it is a regular file at
+             offset 0 larger than a stage, read otherwise; for GCM
+             decryption mapped whenever it is a regular file at offset
+             0, otherwise copied to a temporary file and mapped from
+             there
+Output:
+         out: output file descriptor
+Return:
+         1 bad parameter (also equal XTS key halves), I/O error, bad
+         input length or GCM tag mismatch; 0 success
+Others:
+         GCM decryption writes nothing unless the tag matches. The tag
+         is checked again after the decryption pass, which catches an
+         input file changed in between. On any failure a regular output
+         file is truncated to zero length.
+************************************************************/
+int SM4_FILE_Crypt(const SM4_FILE_PARAM *param, int in, int out)
+{
+	SM4_FILE_CTX c;
+	SM4_FILE_WRITER w;
+	SM4_GCM_CTX hash;
+	struct stat st;
+	unsigned char *map = NULL, *buf, hold[16], tag[16];
+	size_t stage, size = 0, tail, off, n, got;
+	int slot = 0, fail = 1, err = 0, eof = 0, spool = -1;
+
+	if (param->mode < SM4_FILE_CTR || param->mode > SM4_FILE_XTS)
+		return 1;
+	if (param->mode == SM4_FILE_GCM && !param->ivlen)
+		return 1;
+	c.mode = param->mode;
+	c.enc = param->enc;
+	c.sector = param->sector;
+	memcpy(c.ctr, param->iv, 16);
+	if (c.mode == SM4_FILE_XTS && SM4_XTS_Init(&c.xts, (unsigned char *)param->key, c.enc))
+		return 1;
+	if (c.mode != SM4_FILE_XTS)
+		SM4_SetEncKey((unsigned char *)param->key, &c.key);
+	if (SM4_MT_Init(&c.pool, param->threads))
+		return 1;
+	if (c.mode == SM4_FILE_GCM)
+	{
+		SM4_GCM_Init(&c.gcm, &c.key);
+		SM4_GCM_SetIV(&c.gcm, param->iv, param->ivlen);
+	}
+
+	//the GCM tag at the end of the ciphertext is held back
+	tail = c.mode == SM4_FILE_GCM && !c.enc ? 16 : 0;
+	stage = (size_t)(param->threads + 1) * SM4_FILE_STAGE;
+	memset(&w, 0, sizeof(w));
+	w.fd = out;
+	w.buf[0] = (unsigned char *)malloc(stage + 16);
+	w.buf[1] = (unsigned char *)malloc(stage + 16);
+	pthread_mutex_init(&w.lock, NULL);
+	pthread_cond_init(&w.cond, NULL);
+	if (!w.buf[0] || !w.buf[1] || pthread_create(&w.tid, NULL, SM4_FILE_Writer, &w))
+	{
+		free(w.buf[0]);
+		free(w.buf[1]);
+		pthread_mutex_destroy(&w.lock);
+		pthread_cond_destroy(&w.cond);
+		SM4_MT_Free(&c.pool);
+		return 1;
+	}
+
+	//GCM decryption needs all of the cipher text before the first write
+	if (tail && (fstat(in, &st) || !S_ISREG(st.st_mode) || lseek(in, 0, SEEK_CUR) != 0))
+	{
+		//no plain text is written yet, so the output buffer is free
+		if ((spool = SM4_FILE_Spool(in, w.buf[0], stage)) < 0)
+			goto end;
+		in = spool;
+	}
+	if (!fstat(in, &st) && S_ISREG(st.st_mode) && st.st_size >= (off_t)(tail ? tail : stage) && lseek(in, 0, SEEK_CUR) == 0)
+	{
+		size = (size_t)st.st_size;
+		map = (unsigned char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, in, 0);
+		if (map == MAP_FAILED)
+			map = NULL;
+		else
+			madvise(map, size, MADV_SEQUENTIAL);
+	}
+	if (tail)
+	{
+		if (!map)
+			goto end;
+		hash = c.gcm;
+		if (SM4_MT_GCM_HashUpdate(&c.pool, &hash, map, size - tail) || SM4_GCM_CheckTag(&hash, map + size - tail, tail))
+			goto end;
+		memset(&hash, 0, sizeof(hash));
+	}
+
+	if (map)
+	{
+		//stages start on multiples of SM4_FILE_STAGE, so on page boundaries
+		for (off = 0; off < size - tail; off += n)
+		{
+			n = size - tail - off < stage ? size - tail - off : stage;
+			if (n == stage && off + n < size)
+				madvise(map + off + n, size - off - n < stage ? size - off - n : stage, MADV_WILLNEED);
+			if (!(buf = SM4_FILE_Slot(&w, slot)) || SM4_FILE_Process(&c, map + off, buf, n))
+				goto end;
+			SM4_FILE_Put(&w, slot, n);
+			slot ^= 1;
+		}
+		memcpy(tag, map + size - tail, tail);
+	}
+	else
+	{
+		for (got = 0; !eof;)
+		{
+			if (!(buf = SM4_FILE_Slot(&w, slot)))
+				goto end;
+			memcpy(buf, hold, got);
+			n = got + SM4_FILE_Read(in, buf + got, stage + tail - got, &err);
+			if (err || n < tail)
+				goto end;
+			eof = n < stage + tail;
+			n -= tail;
+			memcpy(hold, buf + n, tail);
+			got = tail;
+			if (SM4_FILE_Process(&c, buf, buf, n))
+				goto end;
+			SM4_FILE_Put(&w, slot, n);
+			slot ^= 1;
+		}
+		memcpy(tag, hold, tail);
+	}
+
+	if (c.mode == SM4_FILE_GCM && c.enc)
+	{
+		if (!(buf = SM4_FILE_Slot(&w, slot)))
+			goto end;
+		SM4_GCM_Tag(&c.gcm, buf);
+		SM4_FILE_Put(&w, slot, 16);
+	}
+	fail = c.mode == SM4_FILE_GCM && !c.enc && SM4_GCM_CheckTag(&c.gcm, tag, 16);
+
+end:
+	fail |= SM4_FILE_Stop(&w, fail);
+	if (fail && !fstat(out, &st) && S_ISREG(st.st_mode))
+		if (ftruncate(out, 0))
+			fail = 1;
+	if (map)
+		munmap(map, size);
+	if (spool >= 0)
+		close(spool);
+	free(w.buf[0]);
+	free(w.buf[1]);
+	SM4_MT_Free(&c.pool);
+	memset(&c.key, 0, sizeof(c.key));
+	memset(&c.xts, 0, sizeof(c.xts));
+	return fail;
+}
+
+//feed a buffer into a pipe, used to test the path without mmap
+typedef struct
+{
+	int fd;
+	const unsigned char *buf;
+	size_t len;
+} SM4_FILE_FEED;
+
+static void *SM4_FILE_Feeder(void *p)
+{
+	SM4_FILE_FEED *f = (SM4_FILE_FEED *)p;
+
+	SM4_FILE_Write(f->fd, f->buf, f->len);
+	close(f->fd);
+	return NULL;
+}
+
+//run SM4_FILE_Crypt from a buffer (a file, or a pipe when piped) into a buffer
+static int SM4_FILE_Run(const SM4_FILE_PARAM *param, const unsigned char in[], size_t len, int piped,
+                        unsigned char out[], size_t *outlen)
+{
+	FILE *fi = NULL, *fo = tmpfile();
+	SM4_FILE_FEED feed;
+	pthread_t tid;
+	int fd[2], ret = 1, err = 0;
+
+	if (!fo)
+		return 1;
+	if (piped)
+	{
+		if (pipe(fd))
+			goto end;
+		feed.fd = fd[1];
+		feed.buf = in;
+		feed.len = len;
+		if (pthread_create(&tid, NULL, SM4_FILE_Feeder, &feed))
+		{
+			close(fd[0]);
+			close(fd[1]);
+			goto end;
+		}
+		ret = SM4_FILE_Crypt(param, fd[0], fileno(fo));
+		close(fd[0]);
+		pthread_join(tid, NULL);
+	}
+	else
+	{
+		if (!(fi = tmpfile()) || SM4_FILE_Write(fileno(fi), in, len) || lseek(fileno(fi), 0, SEEK_SET))
+			goto end;
+		ret = SM4_FILE_Crypt(param, fileno(fi), fileno(fo));
+	}
+	lseek(fileno(fo), 0, SEEK_SET);
+	*outlen = SM4_FILE_Read(fileno(fo), out, len + 17, &err);
+	ret |= err;
+
+end:
+	if (fi)
+		fclose(fi);
+	fclose(fo);
+	return ret;
+}
+
+/************************************************************
+Function:
+         int SM4_FILE_SelfCheck()
+Description:
+         Compare the streamed results with the one-shot functions
+Calls:
+         SM4_FILE_Run;
+         SM4_CTR_Encrypt;
+         SM4_GCM_Encrypt;
+         SM4_XTS_Init;
+         SM4_XTS_CryptSectors;
+         SM4_XTS_Crypt
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         With one worker thread a stage is 512K, the text covers two
+         full stages and a partial XTS sector. Encryption reads a mapped
+         file, decryption a pipe; GCM is also decrypted from a mapped
+         file, and a tampered GCM input must fail from either.
+************************************************************/
+int SM4_FILE_SelfCheck()
+{
+	const size_t len = 2 * 2 * SM4_FILE_STAGE + 3 * SM4_FILE_SECTOR + 100;
+	unsigned char *data, *ref, *out, iv[16], tweak[16];
+	SM4_FILE_PARAM param;
+	SM4_XTS_CTX xts;
+	size_t i, n, outlen;
+	int mode, ret = 1;
+
+	data = (unsigned char *)malloc(len);
+	ref = (unsigned char *)malloc(len + 16);
+	out = (unsigned char *)malloc(len + 17);
+	if (!data || !ref || !out)
+		goto end;
+	for (i = 0; i < len; i++)
+		data[i] = (unsigned char)(i * 7 + (i >> 11));
+
+	memset(&param, 0, sizeof(param));
+	for (i = 0; i < 32; i++)
+		param.key[i] = (unsigned char)(0x11 * i + 1);
+	for (i = 0; i < 16; i++)
+		param.iv[i] = (unsigned char)(0xf0 + i);
+	param.iv[12] = 0xff; //the 32bit word carries into the next one
+	param.ivlen = 12;
+	param.sector = 0xfffffffeULL;
+	param.threads = 1;
+
+	for (mode = SM4_FILE_CTR; mode <= SM4_FILE_XTS; mode++)
+	{
+		param.mode = mode;
+		n = len;
+		if (mode == SM4_FILE_CTR)
+		{
+			memcpy(iv, param.iv, 16);
+			SM4_CTR_Encrypt(param.key, iv, SM4_CTR_WIDTH128, data, ref, len);
+		}
+		else if (mode == SM4_FILE_GCM)
+		{
+			SM4_GCM_Encrypt(param.key, param.iv, 12, NULL, 0, data, len, ref, ref + len, 16);
+			n = len + 16;
+		}
+		else
+		{
+			SM4_XTS_Init(&xts, param.key, 1);
+			SM4_XTS_CryptSectors(&xts, param.sector, SM4_FILE_SECTOR, data, ref, len / SM4_FILE_SECTOR);
+			memset(tweak, 0, 16);
+			for (i = 0; i < 8; i++)
+				tweak[i] = (unsigned char)((param.sector + len / SM4_FILE_SECTOR) >> (8 * i));
+			i = len - len % SM4_FILE_SECTOR;
+			SM4_XTS_Crypt(&xts, tweak, data + i, ref + i, len - i);
+		}
+
+		param.enc = 1;
+		if (SM4_FILE_Run(&param, data, len, 0, out, &outlen) || outlen != n || memcmp(out, ref, n))
+			goto end;
+		param.enc = 0;
+		if (SM4_FILE_Run(&param, ref, n, 1, out, &outlen) || outlen != len || memcmp(out, data, len))
+			goto end;
+	}
+
+	//GCM from a mapped file; a wrong tag leaves an empty output, mapped or piped
+	param.mode = SM4_FILE_GCM;
+	SM4_GCM_Encrypt(param.key, param.iv, 12, NULL, 0, data, len, ref, ref + len, 16);
+	if (SM4_FILE_Run(&param, ref, len + 16, 0, out, &outlen) || outlen != len || memcmp(out, data, len))
+		goto end;
+	ref[len + 15] ^= 1;
+	for (i = 0; i <= 1; i++)
+		if (!SM4_FILE_Run(&param, ref, len + 16, (int)i, out, &outlen) || outlen)
+			goto end;
+	ret = 0;
+
+end:
+	free(data);
+	free(ref);
+	free(out);
+	return ret;
+}
@@ -0,0 +1,42 @@
+/************************************************************
+FileName:
+     SM4_FILE.h
+Version:
+     SM4_FILE_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the parameters and function declarations of
+     the streaming SM4 file encryption used by the SM4 tool.
+Function List:
+     1. SM4_FILE_Crypt      //Encrypt/decrypt a file descriptor into another
+     2. SM4_FILE_SelfCheck  //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+//modes of operation
+#define SM4_FILE_CTR 0 //128bit counter, output as long as the input
+#define SM4_FILE_GCM 1 //ciphertext followed by the 16 byte tag
+#define SM4_FILE_XTS 2 //4096 byte sectors, the last one may be shorter
+
+#define SM4_FILE_SECTOR 4096
+
+//bytes of one pipeline stage for every thread, a multiple of SM4_FILE_SECTOR
+#define SM4_FILE_STAGE (256 * 1024)
+
+typedef struct
+{
+     int mode;                  //SM4_FILE_CTR, SM4_FILE_GCM or SM4_FILE_XTS
+     int enc;                   //1 encrypt, 0 decrypt
+     unsigned char key[32];     //16 bytes, 32 bytes (data key, tweak key) for XTS
+     unsigned char iv[16];      //CTR initial counter block or GCM IV
+     size_t ivlen;              //byte length of the GCM IV
+     unsigned long long sector; //XTS number of the first sector
+     int threads;               //worker threads besides the caller
+} SM4_FILE_PARAM;
+
+int SM4_FILE_Crypt(const SM4_FILE_PARAM *param, int in, int out);
+int SM4_FILE_SelfCheck();
@@ -0,0 +1,1268 @@
+/************************************************************
+FileName:
+     SM4_GCM.c
+Version:
+     SM4_GCM_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 Galois/Counter Mode (GCM) authenticated
+     encryption as specified for TLS in RFC 8998.
+     GHASH is computed with PCLMULQDQ when the CPU has it: up to 8 blocks
+     are multiplied by H^8..H^1 and the products are added before a single
+     reduction. Other CPUs use the 4bit table method. The bulk loop is
+     stitched: 16 blocks are run through the counter kernel and hashed
+     while they are still in the L1 cache.
+     Chains of buffers are processed in place, piece by piece, through
+     the same update function: GHASH and the key stream carry over a
+     block split between two fragments and whole blocks inside a
+     fragment still go through the stitched loop.
+Function List:
+     1. SM4_GCM_Init           //Derive the hash key and its tables from an expanded key
+     2. SM4_GCM_SetIV          //Start a message
+     3. SM4_GCM_AAD            //Authenticate additional data
+     4. SM4_GCM_EncryptUpdate  //Encrypt the next part of the message
+     5. SM4_GCM_DecryptUpdate  //Decrypt the next part of the message
+     6. SM4_GCM_Tag            //Finish the message and output the tag
+     7. SM4_GCM_CheckTag       //Finish the message and compare the tag
+     8. SM4_GCM_Encrypt        //One-shot encryption
+     9. SM4_GCM_Decrypt        //One-shot decryption
+     10.SM4_GCM_Mul            //Multiplication in the GHASH field
+     11.SM4_GCM_PowH           //Power of the hash key
+     12.SM4_GCM_AADIov         //Authenticate additional data, scatter-gather
+     13.SM4_GCM_EncryptIov     //Encrypt the next part of the message, scatter-gather
+     14.SM4_GCM_DecryptIov     //Decrypt the next part of the message, scatter-gather
+     15.SM4_GCM_PolyvalInit    //Prepare the hash tables for POLYVAL
+     16.SM4_GCM_Polyval        //POLYVAL of whole blocks
+     17.SM4_GCM_HashUpdate     //Authenticate the next part of the cipher text only
+     18.SM4_GCM_SelfCheck      //Self-check
+************************************************************/
+
+#include "SM4_GCM.h"
+#include "SM4_CTR.h"
+
+#include <string.h>
+#ifdef SM4_X86
+#include <immintrin.h>
+#endif
+
+//blocks per step of the stitched encrypt/hash loop
+#define SM4_GCM_STRIDE 16
+
+//reduction of the 4 bits shifted out of Z by the table method
+static const unsigned long long SM4_GCM_rem4[16] = {
+	0x0000ULL << 48, 0x1C20ULL << 48, 0x3840ULL << 48, 0x2460ULL << 48,
+	0x7080ULL << 48, 0x6CA0ULL << 48, 0x48C0ULL << 48, 0x54E0ULL << 48,
+	0xE100ULL << 48, 0xFD20ULL << 48, 0xD940ULL << 48, 0xC560ULL << 48,
+	0x9180ULL << 48, 0x8DA0ULL << 48, 0xA9C0ULL << 48, 0xB5E0ULL << 48};
+
+static const unsigned char SM4_GCM_zero[16] = {0};
+
+static unsigned long long SM4_GCM_GetU64(const unsigned char p[])
+{
+	return ((unsigned long long)SM4_GetU32(p) << 32) | SM4_GetU32(p + 4);
+}
+
+static void SM4_GCM_PutU64(unsigned char p[], unsigned long long v)
+{
+	SM4_PutU32(p, (unsigned int)(v >> 32));
+	SM4_PutU32(p + 4, (unsigned int)v);
+}
+
+/************************************************************
+Function:
+         static void SM4_GCM_Table4(SM4_GCM_U128 Htable[], const unsigned char H[]);
+Description:
+         Build the table of i*H, i=0..15, for the 4bit method
+Calls:
+Called By:
+         SM4_GCM_Init
+Input:
+         H[]: hash key
+Output:
+         Htable[]: multiples of H
+Return:null
+Others:
+************************************************************/
+static void SM4_GCM_Table4(SM4_GCM_U128 Htable[], const unsigned char H[])
+{
+	SM4_GCM_U128 V;
+	unsigned long long T;
+	int i, j;
+
+	V.hi = SM4_GCM_GetU64(H);
+	V.lo = SM4_GCM_GetU64(H + 8);
+
+	Htable[0].hi = 0;
+	Htable[0].lo = 0;
+	Htable[8] = V;
+	for (i = 4; i > 0; i >>= 1)
+	{
+		//V=V*x
+		T = 0xE100000000000000ULL & (0 - (V.lo & 1));
+		V.lo = (V.hi << 63) | (V.lo >> 1);
+		V.hi = (V.hi >> 1) ^ T;
+		Htable[i] = V;
+	}
+	for (i = 2; i < 16; i <<= 1)
+		for (j = 1; j < i; j++)
+		{
+			Htable[i + j].hi = Htable[i].hi ^ Htable[j].hi;
+			Htable[i + j].lo = Htable[i].lo ^ Htable[j].lo;
+		}
+}
+
+/************************************************************
+Function:
+         static void SM4_GCM_Hash4(unsigned char Xi[], const SM4_GCM_U128 Htable[], const unsigned char in[], size_t blocks);
+Description:
+         GHASH with the 4bit table method, Xi=(Xi^Ci)*H for every block
+Calls:
+Called By:
+         SM4_GCM_Hash
+Input:
+         Xi[]: GHASH accumulator
+         Htable[]: multiples of H
+         in[]: blocks to hash
+         blocks: the number of blocks
+Output:
+         Xi[]: GHASH accumulator
+Return:null
+Others:
+************************************************************/
+static void SM4_GCM_Hash4(unsigned char Xi[], const SM4_GCM_U128 Htable[], const unsigned char in[], size_t blocks)
+{
+	SM4_GCM_U128 Z;
+	unsigned char X[16];
+	unsigned int rem, nlo, nhi;
+	int i, cnt;
+
+	for (; blocks; blocks--, in += 16)
+	{
+		for (i = 0; i < 16; i++)
+			X[i] = Xi[i] ^ in[i];
+
+		nlo = X[15];
+		nhi = nlo >> 4;
+		nlo &= 0xF;
+		Z = Htable[nlo];
+		for (cnt = 15;;)
+		{
+			rem = (unsigned int)Z.lo & 0xF;
+			Z.lo = (Z.hi << 60) | (Z.lo >> 4);
+			Z.hi = (Z.hi >> 4) ^ SM4_GCM_rem4[rem] ^ Htable[nhi].hi;
+			Z.lo ^= Htable[nhi].lo;
+
+			if (--cnt < 0)
+				break;
+
+			nlo = X[cnt];
+			nhi = nlo >> 4;
+			nlo &= 0xF;
+			rem = (unsigned int)Z.lo & 0xF;
+			Z.lo = (Z.hi << 60) | (Z.lo >> 4);
+			Z.hi = (Z.hi >> 4) ^ SM4_GCM_rem4[rem] ^ Htable[nlo].hi;
+			Z.lo ^= Htable[nlo].lo;
+		}
+
+		SM4_GCM_PutU64(Xi, Z.hi);
+		SM4_GCM_PutU64(Xi + 8, Z.lo);
+	}
+}
+
+#ifdef SM4_X86
+
+/*
+ * Carry-less multiply path. Blocks and powers of H are kept byte reversed
+ * so the 128bit lanes hold the polynomial with the usual bit order within
+ * bytes, see the Intel white paper "Carry-Less Multiplication and Its Usage
+ * for Computing the GCM Mode".
+ */
+
+#define SM4_GCM_HAS_CLMUL() (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+
+__attribute__((target("pclmul,ssse3"))) static inline __m128i SM4_GCM_Reverse(__m128i x)
+{
+	return _mm_shuffle_epi8(x, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+//accumulate the unreduced 256bit product a*b into lo,mid,hi
+__attribute__((target("pclmul,ssse3"))) static inline void SM4_GCM_Clmul(__m128i a, __m128i b, __m128i *lo, __m128i *mid, __m128i *hi)
+{
+	*lo = _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+	*hi = _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+	*mid = _mm_xor_si128(*mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01)));
+}
+
+//reduce a 256bit product modulo x^128+x^7+x^2+x+1
+__attribute__((target("pclmul,ssse3"))) static inline __m128i SM4_GCM_Reduce(__m128i lo, __m128i mid, __m128i hi)
+{
+	__m128i t2, t4, t5, t7, t8, t9;
+
+	lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+	hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+	//shift hi:lo left by one bit, the operands were bit reflected
+	t7 = _mm_srli_epi32(lo, 31);
+	t8 = _mm_srli_epi32(hi, 31);
+	lo = _mm_slli_epi32(lo, 1);
+	hi = _mm_slli_epi32(hi, 1);
+	t9 = _mm_srli_si128(t7, 12);
+	t8 = _mm_slli_si128(t8, 4);
+	t7 = _mm_slli_si128(t7, 4);
+	lo = _mm_or_si128(lo, t7);
+	hi = _mm_or_si128(_mm_or_si128(hi, t8), t9);
+
+	//first phase
+	t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+	t8 = _mm_srli_si128(t7, 4);
+	lo = _mm_xor_si128(lo, _mm_slli_si128(t7, 12));
+
+	//second phase
+	t2 = _mm_srli_epi32(lo, 1);
+	t4 = _mm_srli_epi32(lo, 2);
+	t5 = _mm_srli_epi32(lo, 7);
+	t2 = _mm_xor_si128(_mm_xor_si128(t2, t4), _mm_xor_si128(t5, t8));
+	return _mm_xor_si128(hi, _mm_xor_si128(lo, t2));
+}
+
+/************************************************************
+Function:
+         static void SM4_GCM_PowersClmul(unsigned char Hpow[][16], const unsigned char H[]);
+Description:
+         Compute H^1..H^8 for the aggregated reduction
+Calls:
+         SM4_GCM_Clmul;
+         SM4_GCM_Reduce
+Called By:
+         SM4_GCM_Init
+Input:
+         H[]: hash key
+Output:
+         Hpow[]: byte reversed powers of H
+Return:null
+Others:
+************************************************************/
+__attribute__((target("pclmul,ssse3"))) static void SM4_GCM_PowersClmul(unsigned char Hpow[][16], const unsigned char H[])
+{
+	__m128i h, p, lo, mid, hi;
+	int i;
+
+	h = SM4_GCM_Reverse(_mm_loadu_si128((const __m128i *)H));
+	p = h;
+	_mm_storeu_si128((__m128i *)Hpow[0], p);
+	for (i = 1; i < SM4_GCM_AGGREGATE; i++)
+	{
+		lo = mid = hi = _mm_setzero_si128();
+		SM4_GCM_Clmul(p, h, &lo, &mid, &hi);
+		p = SM4_GCM_Reduce(lo, mid, hi);
+		_mm_storeu_si128((__m128i *)Hpow[i], p);
+	}
+}
+
+/************************************************************
+Function:
+         static void SM4_GCM_HashClmul(unsigned char Xi[], const unsigned char Hpow[][16], const unsigned char in[], size_t blocks);
+Description:
+         GHASH with PCLMULQDQ and aggregated reduction:
+         Xi=(Xi^C1)*H^n^C2*H^(n-1)^...^Cn*H, n<=8, reduced once
+Calls:
+         SM4_GCM_Clmul;
+         SM4_GCM_Reduce
+Called By:
+         SM4_GCM_Hash
+Input:
+         Xi[]: GHASH accumulator
+         Hpow[]: byte reversed powers of H
+         in[]: blocks to hash
+         blocks: the number of blocks
+Output:
+         Xi[]: GHASH accumulator
+Return:null
+Others:
+************************************************************/
+__attribute__((target("pclmul,ssse3"))) static void SM4_GCM_HashClmul(unsigned char Xi[], const unsigned char Hpow[][16], const unsigned char in[], size_t blocks)
+{
+	__m128i X, C, lo, mid, hi;
+	size_t i, n;
+
+	X = SM4_GCM_Reverse(_mm_loadu_si128((const __m128i *)Xi));
+	while (blocks)
+	{
+		n = blocks < SM4_GCM_AGGREGATE ? blocks : SM4_GCM_AGGREGATE;
+		lo = mid = hi = _mm_setzero_si128();
+		for (i = 0; i < n; i++)
+		{
+			C = SM4_GCM_Reverse(_mm_loadu_si128((const __m128i *)(in + 16 * i)));
+			if (i == 0)
+				C = _mm_xor_si128(C, X);
+			SM4_GCM_Clmul(C, _mm_loadu_si128((const __m128i *)Hpow[n - 1 - i]), &lo, &mid, &hi);
+		}
+		X = SM4_GCM_Reduce(lo, mid, hi);
+		in += 16 * n;
+		blocks -= n;
+	}
+	_mm_storeu_si128((__m128i *)Xi, SM4_GCM_Reverse(X));
+}
+
+/************************************************************
+Function:
+         static void SM4_GCM_PolyvalClmul(unsigned char S[], const unsigned char Hpow[][16], const unsigned char in[], size_t blocks);
+Description:
+         POLYVAL with PCLMULQDQ and aggregated reduction
+Calls:
+         SM4_GCM_Clmul;
+         SM4_GCM_Reduce
+Called By:
+         SM4_GCM_Polyval
+Input:
+         S[]: POLYVAL accumulator
+         Hpow[]: powers of mulX_GHASH(ByteReverse(H)), see SM4_GCM_PolyvalInit
+         in[]: blocks to hash
+         blocks: the number of blocks
+Output:
+         S[]: POLYVAL accumulator
+Return:null
+Others:
+         POLYVAL is GHASH of the byte reversed blocks, so this is
+         SM4_GCM_HashClmul without the byte shuffles.
+************************************************************/
+__attribute__((target("pclmul,ssse3"))) static void SM4_GCM_PolyvalClmul(unsigned char S[], const unsigned char Hpow[][16], const unsigned char in[], size_t blocks)
+{
+	__m128i X, C, lo, mid, hi;
+	size_t i, n;
+
+	X = _mm_loadu_si128((const __m128i *)S);
+	while (blocks)
+	{
+		n = blocks < SM4_GCM_AGGREGATE ? blocks : SM4_GCM_AGGREGATE;
+		lo = mid = hi = _mm_setzero_si128();
+		for (i = 0; i < n; i++)
+		{
+			C = _mm_loadu_si128((const __m128i *)(in + 16 * i));
+			if (i == 0)
+				C = _mm_xor_si128(C, X);
+			SM4_GCM_Clmul(C, _mm_loadu_si128((const __m128i *)Hpow[n - 1 - i]), &lo, &mid, &hi);
+		}
+		X = SM4_GCM_Reduce(lo, mid, hi);
+		in += 16 * n;
+		blocks -= n;
+	}
+	_mm_storeu_si128((__m128i *)S, X);
+}
+
+#endif
+
+//GHASH the blocks into ctx->Xi with the best method available
+static void SM4_GCM_Hash(SM4_GCM_CTX *ctx, const unsigned char in[], size_t blocks)
+{
+#ifdef SM4_X86
+	if (ctx->clmul)
+	{
+		SM4_GCM_HashClmul(ctx->Xi, ctx->Hpow, in, blocks);
+		return;
+	}
+#endif
+	SM4_GCM_Hash4(ctx->Xi, ctx->Htable, in, blocks);
+}
+
+/************************************************************
+Function:
+         void SM4_GCM_Mul(unsigned char X[16], const unsigned char Y[16]);
+Description:
+         X=X*Y in the GHASH field, bit by bit
+Calls:
+Called By:
+         SM4_GCM_PowH;
+         SM4_MT_GCM_EncryptUpdate;
+         SM4_MT_GCM_DecryptUpdate
+Input:
+         X[], Y[]: field elements in GCM bit order
+Output:
+         X[]: product
+Return:null
+Others:
+         Meant for the few multiplications that join partial GHASH
+         values, not for bulk data.
+************************************************************/
+void SM4_GCM_Mul(unsigned char X[16], const unsigned char Y[16])
+{
+	SM4_GCM_U128 Z = {0, 0}, V;
+	unsigned long long T, M;
+	int i;
+
+	V.hi = SM4_GCM_GetU64(Y);
+	V.lo = SM4_GCM_GetU64(Y + 8);
+	for (i = 0; i < 128; i++)
+	{
+		//Z=Z^V when bit i of X is set, without a branch on it
+		M = 0 - (unsigned long long)((X[i >> 3] >> (7 - (i & 7))) & 1);
+		Z.hi ^= V.hi & M;
+		Z.lo ^= V.lo & M;
+		//V=V*x
+		T = 0xE100000000000000ULL & (0 - (V.lo & 1));
+		V.lo = (V.hi << 63) | (V.lo >> 1);
+		V.hi = (V.hi >> 1) ^ T;
+	}
+	SM4_GCM_PutU64(X, Z.hi);
+	SM4_GCM_PutU64(X + 8, Z.lo);
+}
+
+/************************************************************
+Function:
+         void SM4_GCM_PowH(const SM4_GCM_CTX *ctx, unsigned long long n, unsigned char P[16]);
+Description:
+         P=H^n by square and multiply
+Calls:
+         SM4_GCM_Mul
+Called By:
+         SM4_MT_GCM_EncryptUpdate;
+         SM4_MT_GCM_DecryptUpdate
+Input:
+         ctx: GCM context, see SM4_GCM_Init
+         n: exponent
+Output:
+         P[]: H^n, H^0 is the unit element
+Return:null
+Others:
+         GHASH of n blocks started from X is X*H^n xored with the GHASH
+         of the same blocks started from zero, so partial results of
+         consecutive pieces are joined with one multiplication each.
+************************************************************/
+void SM4_GCM_PowH(const SM4_GCM_CTX *ctx, unsigned long long n, unsigned char P[16])
+{
+	unsigned char S[16];
+
+	//Htable[8] holds H itself
+	SM4_GCM_PutU64(S, ctx->Htable[8].hi);
+	SM4_GCM_PutU64(S + 8, ctx->Htable[8].lo);
+	memset(P, 0, 16);
+	P[0] = 0x80;
+	for (; n; n >>= 1)
+	{
+		if (n & 1)
+			SM4_GCM_Mul(P, S);
+		SM4_GCM_Mul(S, S);
+	}
+	memset(S, 0, sizeof(S));
+}
+
+/************************************************************
+Function:
+         void SM4_GCM_Init(SM4_GCM_CTX *ctx, const SM4_KEY *key);
+Description:
+         Derive the hash key H=E(K,0^128) and the GHASH tables, the
+         context can then be used for any number of messages
+Calls:
+         SM4_CryptBlocks;
+         SM4_GCM_Table4;
+         SM4_GCM_PowersClmul
+Called By:
+         SM4_GCM_Encrypt;
+         SM4_GCM_Decrypt
+Input:
+         key: expanded encryption key, see SM4_SetEncKey
+Output:
+         ctx: GCM context
+Return:null
+Others:
+************************************************************/
+void SM4_GCM_Init(SM4_GCM_CTX *ctx, const SM4_KEY *key)
+{
+	unsigned char H[16];
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->key = *key;
+	SM4_CryptBlocks(key, SM4_GCM_zero, H, 1);
+	SM4_GCM_Table4(ctx->Htable, H);
+
+#ifdef SM4_X86
+	if (SM4_GCM_HAS_CLMUL())
+	{
+		ctx->clmul = 1;
+		SM4_GCM_PowersClmul(ctx->Hpow, H);
+	}
+#endif
+	memset(H, 0, sizeof(H));
+}
+
+/************************************************************
+Function:
+         void SM4_GCM_PolyvalInit(SM4_GCM_CTX *ctx, const unsigned char H[16]);
+Description:
+         Prepare the hash tables of a context for POLYVAL (RFC 8452)
+         with the key H
+Calls:
+         SM4_GCM_Table4;
+         SM4_GCM_PowersClmul
+Called By:
+         SM4_GCMSIV_Derive
+Input:
+         H[]: POLYVAL key
+Output:
+         ctx: context, only usable with SM4_GCM_Polyval
+Return:null
+Others:
+         POLYVAL(H,X1..Xn)=ByteReverse(GHASH(mulX_GHASH(ByteReverse(H)),
+         ByteReverse(X1)..ByteReverse(Xn))), RFC 8452 appendix A, so the
+         GHASH tables are built for mulX_GHASH(ByteReverse(H)).
+************************************************************/
+void SM4_GCM_PolyvalInit(SM4_GCM_CTX *ctx, const unsigned char H[16])
+{
+	SM4_GCM_U128 V;
+	unsigned char R[16];
+	unsigned long long T;
+	int i;
+
+	memset(ctx, 0, sizeof(*ctx));
+	for (i = 0; i < 16; i++)
+		R[i] = H[15 - i];
+	V.hi = SM4_GCM_GetU64(R);
+	V.lo = SM4_GCM_GetU64(R + 8);
+	T = 0xE100000000000000ULL & (0 - (V.lo & 1));
+	V.lo = (V.hi << 63) | (V.lo >> 1);
+	V.hi = (V.hi >> 1) ^ T;
+	SM4_GCM_PutU64(R, V.hi);
+	SM4_GCM_PutU64(R + 8, V.lo);
+	SM4_GCM_Table4(ctx->Htable, R);
+
+#ifdef SM4_X86
+	if (SM4_GCM_HAS_CLMUL())
+	{
+		ctx->clmul = 1;
+		SM4_GCM_PowersClmul(ctx->Hpow, R);
+	}
+#endif
+	memset(R, 0, sizeof(R));
+}
+
+/************************************************************
+Function:
+         void SM4_GCM_Polyval(const SM4_GCM_CTX *ctx, unsigned char S[16], const unsigned char in[], size_t blocks);
+Description:
+         S=(S^Xi)*H*x^-128 for every block, with the best method available
+Calls:
+         SM4_GCM_PolyvalClmul;
+         SM4_GCM_Hash4
+Called By:
+         SM4_GCMSIV_Seal;
+         SM4_GCMSIV_Open
+Input:
+         ctx: context, see SM4_GCM_PolyvalInit
+         S[]: POLYVAL accumulator, zero at the start
+         in[]: blocks to hash
+         blocks: the number of blocks
+Output:
+         S[]: POLYVAL accumulator
+Return:null
+Others:
+************************************************************/
+void SM4_GCM_Polyval(const SM4_GCM_CTX *ctx, unsigned char S[16], const unsigned char in[], size_t blocks)
+{
+	unsigned char X[16], B[16];
+	int i;
+
+#ifdef SM4_X86
+	if (ctx->clmul)
+	{
+		SM4_GCM_PolyvalClmul(S, ctx->Hpow, in, blocks);
+		return;
+	}
+#endif
+	for (i = 0; i < 16; i++)
+		X[i] = S[15 - i];
+	for (; blocks; blocks--, in += 16)
+	{
+		for (i = 0; i < 16; i++)
+			B[i] = in[15 - i];
+		SM4_GCM_Hash4(X, ctx->Htable, B, 1);
+	}
+	for (i = 0; i < 16; i++)
+		S[i] = X[15 - i];
+}
+
+/************************************************************
+Function:
+         void SM4_GCM_SetIV(SM4_GCM_CTX *ctx, const unsigned char iv[], size_t ivlen);
+Description:
+         Start a new message with the given IV
+Calls:
+         SM4_GCM_Hash
+Called By:
+         SM4_GCM_Encrypt;
+         SM4_GCM_Decrypt
+Input:
+         ctx: GCM context
+         iv[]: initialization vector, 12 bytes recommended
+         ivlen: byte length of iv[], >0
+Output:
+         ctx: GCM context
+Return:null
+Others:
+************************************************************/
+void SM4_GCM_SetIV(SM4_GCM_CTX *ctx, const unsigned char iv[], size_t ivlen)
+{
+	unsigned char len[16] = {0};
+	size_t full = ivlen & ~(size_t)15;
+
+	memset(ctx->Xi, 0, 16);
+	if (ivlen == 12)
+	{
+		memcpy(ctx->J0, iv, 12);
+		ctx->J0[12] = ctx->J0[13] = ctx->J0[14] = 0;
+		ctx->J0[15] = 1;
+	}
+	else
+	{
+		//J0=GHASH(IV||0^s||[len(IV)]64)
+		SM4_GCM_Hash(ctx, iv, full / 16);
+		if (ivlen > full)
+		{
+			memcpy(len, iv + full, ivlen - full);
+			SM4_GCM_Hash(ctx, len, 1);
+			memset(len, 0, 16);
+		}
+		SM4_GCM_PutU64(len + 8, (unsigned long long)ivlen << 3);
+		SM4_GCM_Hash(ctx, len, 1);
+		memcpy(ctx->J0, ctx->Xi, 16);
+		memset(ctx->Xi, 0, 16);
+	}
+
+	memcpy(ctx->ctr, ctx->J0, 16);
+	SM4_CTR_AddCounter(ctx->ctr, 1, SM4_CTR_WIDTH32);
+	ctx->alen = ctx->mlen = 0;
+	ctx->ares = ctx->mres = 0;
+	ctx->text = 0;
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_AAD(SM4_GCM_CTX *ctx, const unsigned char aad[], size_t len);
+Description:
+         Authenticate additional data, may be called several times
+         but only before the text
+Calls:
+         SM4_GCM_Hash
+Called By:
+         SM4_GCM_Encrypt;
+         SM4_GCM_Decrypt
+Input:
+         ctx: GCM context
+         aad[]: additional authenticated data
+         len: byte length of aad[]
+Output:
+         ctx: GCM context
+Return:
+         1 text or tag already started, or AAD too long; 0 success
+Others:
+************************************************************/
+int SM4_GCM_AAD(SM4_GCM_CTX *ctx, const unsigned char aad[], size_t len)
+{
+	size_t full;
+
+	if (ctx->text || len > SM4_GCM_MAX_AAD - ctx->alen)
+		return 1;
+	ctx->alen += len;
+
+	for (; ctx->ares && len; len--)
+	{
+		ctx->Xi[ctx->ares] ^= *aad++;
+		ctx->ares = (ctx->ares + 1) & 15;
+		if (!ctx->ares)
+			SM4_GCM_Hash(ctx, SM4_GCM_zero, 1);
+	}
+
+	full = len & ~(size_t)15;
+	SM4_GCM_Hash(ctx, aad, full / 16);
+	for (aad += full, len -= full; len; len--)
+		ctx->Xi[ctx->ares++] ^= *aad++;
+	return 0;
+}
+
+/************************************************************
+Function:
+         static int SM4_GCM_Update(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len, int enc);
+Description:
+         Encrypt or decrypt the next part of the text and hash the
+         cipher text
+Calls:
+         SM4_Ctr32Blocks;
+         SM4_CryptBlocks;
+         SM4_CTR_AddCounter;
+         SM4_GCM_Hash
+Called By:
+         SM4_GCM_EncryptUpdate;
+         SM4_GCM_DecryptUpdate
+Input:
+         ctx: GCM context
+         in[]: input text
+         len: byte length of in[]
+         enc: 1 encrypt, 0 decrypt
+Output:
+         out[]: output text, may be the same as in[]
+Return:
+         1 text too long; 0 success
+Others:
+************************************************************/
+static int SM4_GCM_Update(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len, int enc)
+{
+	unsigned char c;
+	size_t i, n;
+
+	if (len > SM4_GCM_MAX_TEXT - ctx->mlen)
+		return 1;
+	ctx->mlen += len;
+	ctx->text = 1;
+
+	//close the last partial block of AAD
+	if (ctx->ares)
+	{
+		SM4_GCM_Hash(ctx, SM4_GCM_zero, 1);
+		ctx->ares = 0;
+	}
+
+	for (; ctx->mres && len; len--)
+	{
+		c = *in++;
+		*out = c ^ ctx->ks[ctx->mres];
+		ctx->Xi[ctx->mres] ^= enc ? *out : c;
+		out++;
+		ctx->mres = (ctx->mres + 1) & 15;
+		if (!ctx->mres)
+			SM4_GCM_Hash(ctx, SM4_GCM_zero, 1);
+	}
+
+	//stitched loop: encrypt and hash a stride while it is in cache
+	while (len >= 16)
+	{
+		n = len / 16;
+		if (n > SM4_GCM_STRIDE)
+			n = SM4_GCM_STRIDE;
+		if (!enc)
+			SM4_GCM_Hash(ctx, in, n);
+		SM4_Ctr32Blocks(&ctx->key, in, out, n, ctx->ctr);
+		if (enc)
+			SM4_GCM_Hash(ctx, out, n);
+		SM4_CTR_AddCounter(ctx->ctr, n, SM4_CTR_WIDTH32);
+		in += 16 * n;
+		out += 16 * n;
+		len -= 16 * n;
+	}
+
+	if (len)
+	{
+		SM4_CryptBlocks(&ctx->key, ctx->ctr, ctx->ks, 1);
+		SM4_CTR_AddCounter(ctx->ctr, 1, SM4_CTR_WIDTH32);
+		for (i = 0; i < len; i++)
+		{
+			c = in[i];
+			out[i] = c ^ ctx->ks[i];
+			ctx->Xi[i] ^= enc ? out[i] : c;
+		}
+		ctx->mres = (unsigned int)len;
+	}
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_EncryptUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Encrypt the next part of the message
+Calls:
+         SM4_GCM_Update
+Called By:
+         SM4_GCM_Encrypt
+Input:
+         ctx: GCM context
+         in[]: plain text
+         len: byte length of in[]
+Output:
+         out[]: cipher text, may be the same as in[]
+Return:
+         1 text too long; 0 success
+Others:
+************************************************************/
+int SM4_GCM_EncryptUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len)
+{
+	return SM4_GCM_Update(ctx, in, out, len, 1);
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_DecryptUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Decrypt the next part of the message
+Calls:
+         SM4_GCM_Update
+Called By:
+         SM4_GCM_Decrypt
+Input:
+         ctx: GCM context
+         in[]: cipher text
+         len: byte length of in[]
+Output:
+         out[]: plain text, may be the same as in[]
+Return:
+         1 text too long; 0 success
+Others:
+         The plain text must not be used before SM4_GCM_CheckTag succeeds.
+************************************************************/
+int SM4_GCM_DecryptUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len)
+{
+	return SM4_GCM_Update(ctx, in, out, len, 0);
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_HashUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], size_t len);
+Description:
+         Authenticate the next part of the cipher text without
+         decrypting it
+Calls:
+         SM4_GCM_Hash
+Called By:
+         SM4_MT_GCM_HashUpdate
+Input:
+         ctx: GCM context
+         in[]: cipher text
+         len: byte length of in[]
+Output:
+         ctx: GCM context
+Return:
+         1 text too long; 0 success
+Others:
+         Lets a caller check the tag before any plain text exists. The
+         counter does not move, so the context can only be finished with
+         SM4_GCM_CheckTag; decrypt afterwards from a fresh SM4_GCM_SetIV
+         or from a copy taken before the hash pass.
+************************************************************/
+int SM4_GCM_HashUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], size_t len)
+{
+	size_t i, n;
+
+	if (len > SM4_GCM_MAX_TEXT - ctx->mlen)
+		return 1;
+	ctx->mlen += len;
+	ctx->text = 1;
+
+	//close the last partial block of AAD
+	if (ctx->ares)
+	{
+		SM4_GCM_Hash(ctx, SM4_GCM_zero, 1);
+		ctx->ares = 0;
+	}
+
+	for (; ctx->mres && len; len--)
+	{
+		ctx->Xi[ctx->mres] ^= *in++;
+		ctx->mres = (ctx->mres + 1) & 15;
+		if (!ctx->mres)
+			SM4_GCM_Hash(ctx, SM4_GCM_zero, 1);
+	}
+
+	n = len / 16;
+	if (n)
+		SM4_GCM_Hash(ctx, in, n);
+	in += 16 * n;
+	len -= 16 * n;
+
+	for (i = 0; i < len; i++)
+		ctx->Xi[i] ^= in[i];
+	ctx->mres = (unsigned int)len;
+	return 0;
+}
+
+/************************************************************
+Function:
+         void SM4_GCM_Tag(SM4_GCM_CTX *ctx, unsigned char tag[16]);
+Description:
+         Finish the message and output the full 16 byte tag
+Calls:
+         SM4_GCM_Hash;
+         SM4_CryptBlocks
+Called By:
+         SM4_GCM_CheckTag;
+         SM4_GCM_Encrypt
+Input:
+         ctx: GCM context
+Output:
+         tag[]: authentication tag
+Return:null
+Others:
+************************************************************/
+void SM4_GCM_Tag(SM4_GCM_CTX *ctx, unsigned char tag[16])
+{
+	unsigned char len[16];
+	int i;
+
+	if (ctx->ares || ctx->mres)
+		SM4_GCM_Hash(ctx, SM4_GCM_zero, 1);
+	ctx->ares = ctx->mres = 0;
+	ctx->text = 1;
+
+	SM4_GCM_PutU64(len, ctx->alen << 3);
+	SM4_GCM_PutU64(len + 8, ctx->mlen << 3);
+	SM4_GCM_Hash(ctx, len, 1);
+
+	SM4_CryptBlocks(&ctx->key, ctx->J0, tag, 1);
+	for (i = 0; i < 16; i++)
+		tag[i] ^= ctx->Xi[i];
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_CheckTag(SM4_GCM_CTX *ctx, const unsigned char tag[], size_t taglen);
+Description:
+         Finish the message and compare the received tag in constant time
+Calls:
+         SM4_GCM_Tag
+Called By:
+         SM4_GCM_Decrypt
+Input:
+         ctx: GCM context
+         tag[]: received tag
+         taglen: byte length of tag[], 4..16
+Output:
+Return:
+         1 tag mismatch or bad tag length; 0 success
+Others:
+************************************************************/
+int SM4_GCM_CheckTag(SM4_GCM_CTX *ctx, const unsigned char tag[], size_t taglen)
+{
+	unsigned char T[16], diff = 0;
+	size_t i;
+
+	if (taglen < 4 || taglen > 16)
+		return 1;
+
+	SM4_GCM_Tag(ctx, T);
+	for (i = 0; i < taglen; i++)
+		diff |= T[i] ^ tag[i];
+	return diff != 0;
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_Encrypt(unsigned char MK[], const unsigned char iv[], size_t ivlen, const unsigned char aad[], size_t aadlen,
+                             const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[], size_t taglen);
+Description:
+         One-shot GCM encryption
+Calls:
+         SM4_SetEncKey;
+         SM4_GCM_Init;
+         SM4_GCM_SetIV;
+         SM4_GCM_AAD;
+         SM4_GCM_EncryptUpdate;
+         SM4_GCM_Tag
+Called By:
+         SM4_GCM_SelfCheck
+Input:
+         MK[]: Master key
+         iv[]: initialization vector
+         ivlen: byte length of iv[]
+         aad[]: additional authenticated data
+         aadlen: byte length of aad[]
+         in[]: plain text
+         len: byte length of in[]
+         taglen: byte length of the tag, 4..16
+Output:
+         out[]: cipher text, may be the same as in[]
+         tag[]: authentication tag
+Return:
+         1 bad parameter; 0 success
+Others:
+************************************************************/
+int SM4_GCM_Encrypt(unsigned char MK[], const unsigned char iv[], size_t ivlen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[], size_t taglen)
+{
+	SM4_GCM_CTX ctx;
+	SM4_KEY key;
+	unsigned char T[16];
+
+	if (!ivlen || taglen < 4 || taglen > 16)
+		return 1;
+
+	SM4_SetEncKey(MK, &key);
+	SM4_GCM_Init(&ctx, &key);
+	SM4_GCM_SetIV(&ctx, iv, ivlen);
+	if (SM4_GCM_AAD(&ctx, aad, aadlen) || SM4_GCM_EncryptUpdate(&ctx, in, out, len))
+		return 1;
+	SM4_GCM_Tag(&ctx, T);
+	memcpy(tag, T, taglen);
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_Decrypt(unsigned char MK[], const unsigned char iv[], size_t ivlen, const unsigned char aad[], size_t aadlen,
+                             const unsigned char in[], size_t len, const unsigned char tag[], size_t taglen, unsigned char out[]);
+Description:
+         One-shot GCM decryption and tag verification
+Calls:
+         SM4_SetEncKey;
+         SM4_GCM_Init;
+         SM4_GCM_SetIV;
+         SM4_GCM_AAD;
+         SM4_GCM_DecryptUpdate;
+         SM4_GCM_CheckTag
+Called By:
+         SM4_GCM_SelfCheck
+Input:
+         MK[]: Master key
+         iv[]: initialization vector
+         ivlen: byte length of iv[]
+         aad[]: additional authenticated data
+         aadlen: byte length of aad[]
+         in[]: cipher text
+         len: byte length of in[]
+         tag[]: received tag
+         taglen: byte length of tag[], 4..16
+Output:
+         out[]: plain text, may be the same as in[]; zeroed on failure
+Return:
+         1 authentication failed or bad parameter; 0 success
+Others:
+************************************************************/
+int SM4_GCM_Decrypt(unsigned char MK[], const unsigned char iv[], size_t ivlen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, const unsigned char tag[], size_t taglen, unsigned char out[])
+{
+	SM4_GCM_CTX ctx;
+	SM4_KEY key;
+
+	if (!ivlen || taglen < 4 || taglen > 16)
+		return 1;
+
+	SM4_SetEncKey(MK, &key);
+	SM4_GCM_Init(&ctx, &key);
+	SM4_GCM_SetIV(&ctx, iv, ivlen);
+	if (SM4_GCM_AAD(&ctx, aad, aadlen) || SM4_GCM_DecryptUpdate(&ctx, in, out, len) || SM4_GCM_CheckTag(&ctx, tag, taglen))
+	{
+		memset(out, 0, len);
+		return 1;
+	}
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_AADIov(SM4_GCM_CTX *ctx, const struct iovec aad[], int cnt);
+Description:
+         Authenticate additional data held in a chain of buffers
+Calls:
+         SM4_GCM_AAD
+Called By:
+Input:
+         ctx: GCM context
+         aad[]: buffers of additional authenticated data
+         cnt: number of aad[] entries
+Output:
+         ctx: GCM context
+Return:
+         1 AAD too long or text already started; 0 success
+Others:
+************************************************************/
+int SM4_GCM_AADIov(SM4_GCM_CTX *ctx, const struct iovec aad[], int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		if (SM4_GCM_AAD(ctx, (const unsigned char *)aad[i].iov_base, aad[i].iov_len))
+			return 1;
+	return 0;
+}
+
+static int SM4_GCM_EncryptPiece(void *arg, const unsigned char in[], unsigned char out[], size_t len)
+{
+	return SM4_GCM_Update((SM4_GCM_CTX *)arg, in, out, len, 1);
+}
+
+static int SM4_GCM_DecryptPiece(void *arg, const unsigned char in[], unsigned char out[], size_t len)
+{
+	return SM4_GCM_Update((SM4_GCM_CTX *)arg, in, out, len, 0);
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_EncryptIov(SM4_GCM_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt);
+Description:
+         Encrypt the next part of the message held in a chain of buffers
+Calls:
+         SM4_CTR_ForIov;
+         SM4_GCM_Update
+Called By:
+Input:
+         ctx: GCM context
+         in[]: plain text buffers
+         incnt: number of in[] entries
+         out[]: cipher text buffers, NULL to encrypt in place
+         outcnt: number of out[] entries
+Output:
+         out[]: cipher text
+Return:
+         1 total lengths differ or text too long; 0 success
+Others:
+************************************************************/
+int SM4_GCM_EncryptIov(SM4_GCM_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt)
+{
+	return SM4_CTR_ForIov(in, incnt, out, outcnt, SM4_GCM_EncryptPiece, ctx);
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_DecryptIov(SM4_GCM_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt);
+Description:
+         Decrypt the next part of the message held in a chain of buffers
+Calls:
+         SM4_CTR_ForIov;
+         SM4_GCM_Update
+Called By:
+Input:
+         ctx: GCM context
+         in[]: cipher text buffers
+         incnt: number of in[] entries
+         out[]: plain text buffers, NULL to decrypt in place
+         outcnt: number of out[] entries
+Output:
+         out[]: plain text
+Return:
+         1 total lengths differ or text too long; 0 success
+Others:
+         The plain text must not be used before SM4_GCM_CheckTag succeeds.
+************************************************************/
+int SM4_GCM_DecryptIov(SM4_GCM_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt)
+{
+	return SM4_CTR_ForIov(in, incnt, out, outcnt, SM4_GCM_DecryptPiece, ctx);
+}
+
+/************************************************************
+Function:
+         int SM4_GCM_SelfCheck()
+Description:
+         Self-check with standard data
+Calls:
+         SM4_GCM_Encrypt;
+         SM4_GCM_Decrypt;
+         SM4_GCM_Init;
+         SM4_GCM_SetIV;
+         SM4_GCM_AAD;
+         SM4_GCM_EncryptUpdate;
+         SM4_GCM_Tag;
+         SM4_GCM_AADIov;
+         SM4_GCM_EncryptIov;
+         SM4_GCM_DecryptIov;
+         SM4_GCM_HashUpdate;
+         SM4_GCM_CheckTag
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         Test vector from RFC 8998 appendix A.1. A longer message is then
+         processed in uneven pieces with both GHASH methods, and as a
+         chain of fragments encrypted and decrypted in place. Hashing the
+         cipher text alone must accept the same tag. AAD after an empty
+         text update must be refused.
+************************************************************/
+int SM4_GCM_SelfCheck()
+{
+	unsigned char key[16] = {
+			0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10};
+	unsigned char iv[12] = {0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00, 0xab, 0xcd};
+	unsigned char aad[20] = {
+			0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+			0xab, 0xad, 0xda, 0xd2};
+	unsigned char plain[64] = {
+			0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb,
+			0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd,
+			0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+			0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa};
+	unsigned char cipher[64] = {
+			0x17, 0xf3, 0x99, 0xf0, 0x8c, 0x67, 0xd5, 0xee, 0x19, 0xd0, 0xdc, 0x99, 0x69, 0xc4, 0xbb, 0x7d,
+			0x5f, 0xd4, 0x6f, 0xd3, 0x75, 0x64, 0x89, 0x06, 0x91, 0x57, 0xb2, 0x82, 0xbb, 0x20, 0x07, 0x35,
+			0xd8, 0x27, 0x10, 0xca, 0x5c, 0x22, 0xf0, 0xcc, 0xfa, 0x7c, 0xbf, 0x93, 0xd4, 0x96, 0xac, 0x15,
+			0xa5, 0x68, 0x34, 0xcb, 0xcf, 0x98, 0xc3, 0x97, 0xb4, 0x02, 0x4a, 0x26, 0x91, 0x23, 0x3b, 0x8d};
+	unsigned char Std_tag[16] = {
+			0x83, 0xde, 0x35, 0x41, 0xe4, 0xc2, 0xb5, 0x81, 0x77, 0xe0, 0x65, 0xa9, 0xbf, 0x7b, 0x62, 0xec};
+	unsigned char out[64], tag[16], tag2[16];
+	unsigned char data[1000], ref[1000], buf[1000];
+	size_t chunks[6] = {1, 15, 17, 130, 256, 581};
+	SM4_GCM_CTX ctx;
+	SM4_KEY ek;
+	struct iovec ia[2], iv2[6];
+	size_t i, off;
+	int clmul;
+
+	if (SM4_GCM_Encrypt(key, iv, 12, aad, 20, plain, 64, out, tag, 16))
+		return 1;
+	if (memcmp(out, cipher, 64) || memcmp(tag, Std_tag, 16))
+		return 1;
+	if (SM4_GCM_Decrypt(key, iv, 12, aad, 20, cipher, 64, Std_tag, 16, out) || memcmp(out, plain, 64))
+		return 1;
+	tag[15] ^= 1;
+	if (!SM4_GCM_Decrypt(key, iv, 12, aad, 20, cipher, 64, tag, 16, out))
+		return 1;
+
+	//uneven pieces, 13 byte IV and both GHASH methods give the same result
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (unsigned char)(i * 13 + 5);
+	if (SM4_GCM_Encrypt(key, data, 13, aad, 20, data, sizeof(data), ref, tag, 16))
+		return 1;
+
+	SM4_SetEncKey(key, &ek);
+	SM4_GCM_Init(&ctx, &ek);
+	for (clmul = ctx.clmul; clmul >= 0; clmul--)
+	{
+		ctx.clmul = clmul;
+		SM4_GCM_SetIV(&ctx, data, 13);
+		SM4_GCM_AAD(&ctx, aad, 3);
+		SM4_GCM_AAD(&ctx, aad + 3, 17);
+		for (i = 0, off = 0; i < 6; off += chunks[i], i++)
+			SM4_GCM_EncryptUpdate(&ctx, data + off, buf + off, chunks[i]);
+		SM4_GCM_Tag(&ctx, tag2);
+		if (memcmp(buf, ref, sizeof(ref)) || memcmp(tag, tag2, 16))
+			return 1;
+	}
+
+	//the same message as a chain of fragments, in place
+	SM4_GCM_Init(&ctx, &ek);
+	memcpy(buf, data, sizeof(data));
+	ia[0].iov_base = aad;
+	ia[0].iov_len = 7;
+	ia[1].iov_base = aad + 7;
+	ia[1].iov_len = 13;
+	for (i = 0, off = 0; i < 6; off += chunks[i], i++)
+	{
+		iv2[i].iov_base = buf + off;
+		iv2[i].iov_len = chunks[i];
+	}
+	SM4_GCM_SetIV(&ctx, data, 13);
+	if (SM4_GCM_AADIov(&ctx, ia, 2) || SM4_GCM_EncryptIov(&ctx, iv2, 6, NULL, 0))
+		return 1;
+	SM4_GCM_Tag(&ctx, tag2);
+	if (memcmp(buf, ref, sizeof(ref)) || memcmp(tag, tag2, 16))
+		return 1;
+	SM4_GCM_SetIV(&ctx, data, 13);
+	if (SM4_GCM_AADIov(&ctx, ia, 2) || SM4_GCM_DecryptIov(&ctx, iv2, 6, NULL, 0) || SM4_GCM_CheckTag(&ctx, tag, 16))
+		return 1;
+	if (memcmp(buf, data, sizeof(data)))
+		return 1;
+
+	//hash only, in the same uneven pieces
+	SM4_GCM_SetIV(&ctx, data, 13);
+	if (SM4_GCM_AADIov(&ctx, ia, 2))
+		return 1;
+	for (i = 0, off = 0; i < 6; off += chunks[i], i++)
+		if (SM4_GCM_HashUpdate(&ctx, ref + off, chunks[i]))
+			return 1;
+	if (SM4_GCM_CheckTag(&ctx, tag, 16))
+		return 1;
+
+	//AAD is refused once the text has started, even with an empty update
+	SM4_GCM_SetIV(&ctx, data, 13);
+	if (SM4_GCM_AAD(&ctx, aad, 5) || SM4_GCM_EncryptUpdate(&ctx, data, buf, 0) || !SM4_GCM_AAD(&ctx, aad + 5, 5))
+		return 1;
+
+	return 0;
+}
@@ -0,0 +1,84 @@
+/************************************************************
+FileName:
+     SM4_GCM.h
+Version:
+     SM4_GCM_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the context and function declarations of the
+     SM4 Galois/Counter Mode (GCM) authenticated encryption, RFC 8998.
+Function List:
+     1. SM4_GCM_Init           //Derive the hash key and its tables from an expanded key
+     2. SM4_GCM_SetIV          //Start a message
+     3. SM4_GCM_AAD            //Authenticate additional data
+     4. SM4_GCM_EncryptUpdate  //Encrypt the next part of the message
+     5. SM4_GCM_DecryptUpdate  //Decrypt the next part of the message
+     6. SM4_GCM_Tag            //Finish the message and output the tag
+     7. SM4_GCM_CheckTag       //Finish the message and compare the tag
+     8. SM4_GCM_Encrypt        //One-shot encryption
+     9. SM4_GCM_Decrypt        //One-shot decryption
+     10.SM4_GCM_Mul            //Multiplication in the GHASH field
+     11.SM4_GCM_PowH           //Power of the hash key
+     12.SM4_GCM_AADIov         //Authenticate additional data, scatter-gather
+     13.SM4_GCM_EncryptIov     //Encrypt the next part of the message, scatter-gather
+     14.SM4_GCM_DecryptIov     //Decrypt the next part of the message, scatter-gather
+     15.SM4_GCM_PolyvalInit    //Prepare the hash tables for POLYVAL
+     16.SM4_GCM_Polyval        //POLYVAL of whole blocks
+     17.SM4_GCM_HashUpdate     //Authenticate the next part of the cipher text only
+     18.SM4_GCM_SelfCheck      //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+#include <sys/uio.h>
+
+//maximum number of blocks multiplied before one reduction
+#define SM4_GCM_AGGREGATE 8
+
+//limits of NIST SP 800-38D, 2^39-256 bits of text and 2^64-1 bits of AAD
+#define SM4_GCM_MAX_TEXT ((1ULL << 36) - 32)
+#define SM4_GCM_MAX_AAD  ((1ULL << 61) - 1)
+
+typedef struct
+{
+     unsigned long long hi, lo;
+} SM4_GCM_U128;
+
+typedef struct
+{
+     SM4_KEY key;
+     SM4_GCM_U128 Htable[16];                  //i*H for every 4bit i
+     unsigned char Hpow[SM4_GCM_AGGREGATE][16]; //H^1..H^8 byte reversed, carry-less multiply path
+     int clmul;                                //PCLMULQDQ is used
+     unsigned char J0[16];                     //pre-counter block
+     unsigned char ctr[16];                    //next counter block
+     unsigned char ks[16];                     //key stream of the current block
+     unsigned char Xi[16];                     //GHASH accumulator
+     unsigned long long alen, mlen;            //byte length of AAD and text
+     unsigned int ares, mres;                  //bytes in the current partial block
+     int text;                                 //text or tag started, no more AAD
+} SM4_GCM_CTX;
+
+void SM4_GCM_Init(SM4_GCM_CTX *ctx, const SM4_KEY *key);
+void SM4_GCM_SetIV(SM4_GCM_CTX *ctx, const unsigned char iv[], size_t ivlen);
+int SM4_GCM_AAD(SM4_GCM_CTX *ctx, const unsigned char aad[], size_t len);
+int SM4_GCM_EncryptUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+int SM4_GCM_DecryptUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+void SM4_GCM_Tag(SM4_GCM_CTX *ctx, unsigned char tag[16]);
+int SM4_GCM_CheckTag(SM4_GCM_CTX *ctx, const unsigned char tag[], size_t taglen);
+int SM4_GCM_Encrypt(unsigned char MK[], const unsigned char iv[], size_t ivlen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[], size_t taglen);
+int SM4_GCM_Decrypt(unsigned char MK[], const unsigned char iv[], size_t ivlen, const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, const unsigned char tag[], size_t taglen, unsigned char out[]);
+void SM4_GCM_Mul(unsigned char X[16], const unsigned char Y[16]);
+void SM4_GCM_PowH(const SM4_GCM_CTX *ctx, unsigned long long n, unsigned char P[16]);
+int SM4_GCM_AADIov(SM4_GCM_CTX *ctx, const struct iovec aad[], int cnt);
+int SM4_GCM_EncryptIov(SM4_GCM_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt);
+int SM4_GCM_DecryptIov(SM4_GCM_CTX *ctx, const struct iovec in[], int incnt, const struct iovec out[], int outcnt);
+void SM4_GCM_PolyvalInit(SM4_GCM_CTX *ctx, const unsigned char H[16]);
+void SM4_GCM_Polyval(const SM4_GCM_CTX *ctx, unsigned char S[16], const unsigned char in[], size_t blocks);
+int SM4_GCM_HashUpdate(SM4_GCM_CTX *ctx, const unsigned char in[], size_t len);
+int SM4_GCM_SelfCheck();
@@ -0,0 +1,49 @@
+/************************************************************
+FileName:
+     SM4_GCMSIV.h
+Version:
+     SM4_GCMSIV_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the context and function declarations of the
+     SM4 GCM-SIV nonce misuse-resistant authenticated encryption, built
+     as AES-GCM-SIV in RFC 8452 with SM4 as the block cipher.
+Function List:
+     1. SM4_GCMSIV_Init       //Bind a key-generating key to a context
+     2. SM4_GCMSIV_Seal       //Encrypt a message and compute its tag
+     3. SM4_GCMSIV_Open       //Decrypt a message and check its tag
+     4. SM4_GCMSIV_Encrypt    //One-shot encryption
+     5. SM4_GCMSIV_Decrypt    //One-shot decryption
+     6. SM4_GCMSIV_SelfCheck  //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+#include "SM4_GCM.h"
+
+#define SM4_GCMSIV_NONCE 12
+
+//RFC 8452 limit of the text and of the AAD, 2^36 bytes
+#define SM4_GCMSIV_MAX (1ULL << 36)
+
+typedef struct
+{
+     SM4_KEY key;                              //key-generating key
+     unsigned char nonce[SM4_GCMSIV_NONCE];    //nonce of the derived keys below
+     int cached;                               //the derived keys are valid
+     SM4_KEY enc;                              //message-encryption key
+     SM4_GCM_CTX hash;                         //POLYVAL tables of the message-authentication key
+} SM4_GCMSIV_CTX;
+
+void SM4_GCMSIV_Init(SM4_GCMSIV_CTX *ctx, const SM4_KEY *key);
+int SM4_GCMSIV_Seal(SM4_GCMSIV_CTX *ctx, const unsigned char nonce[12], const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[16]);
+int SM4_GCMSIV_Open(SM4_GCMSIV_CTX *ctx, const unsigned char nonce[12], const unsigned char aad[], size_t aadlen,
+                    const unsigned char in[], size_t len, const unsigned char tag[16], unsigned char out[]);
+int SM4_GCMSIV_Encrypt(unsigned char MK[], const unsigned char nonce[12], const unsigned char aad[], size_t aadlen,
+                       const unsigned char in[], size_t len, unsigned char out[], unsigned char tag[16]);
+int SM4_GCMSIV_Decrypt(unsigned char MK[], const unsigned char nonce[12], const unsigned char aad[], size_t aadlen,
+                       const unsigned char in[], size_t len, const unsigned char tag[16], unsigned char out[]);
+int SM4_GCMSIV_SelfCheck();
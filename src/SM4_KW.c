@@ -0,0 +1,617 @@
+/************************************************************
+FileName:
+     SM4_KW.c
+Version:
+     SM4_KW_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 key wrap (RFC 3394) and key wrap with
+     padding (RFC 5649) on a KEK expanded once by the caller. The six
+     passes over a wrapped key form one chain of 6n dependent blocks, so
+     the batch functions advance up to 16 keys per call of the
+     multi-block kernel, refilling a lane as soon as its key is done,
+     and can share the keys among the threads of a worker pool.
+Function List:
+     1. SM4_KW_Wrap         //Wrap a key, RFC 3394
+     2. SM4_KW_Unwrap       //Unwrap a key, RFC 3394
+     3. SM4_KWP_Wrap        //Wrap a key of any length, RFC 5649
+     4. SM4_KWP_Unwrap      //Unwrap a key of any length, RFC 5649
+     5. SM4_KW_WrapBatch    //Wrap many keys
+     6. SM4_KW_UnwrapBatch  //Unwrap many keys
+     7. SM4_KW_SelfCheck    //Self-check
+************************************************************/
+
+#include "SM4_KW.h"
+
+#include <string.h>
+
+//smallest number of keys given to one thread
+#define SM4_KW_MIN_TASK 64
+
+static const unsigned char SM4_KW_IV[8] = {0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6};
+static const unsigned char SM4_KWP_AIV[4] = {0xA6, 0x59, 0x59, 0xA6};
+
+//a key in progress
+typedef struct
+{
+	SM4_KW_ITEM *item;
+	unsigned char A[8];  //integrity register
+	unsigned char *R;    //the n 64bit registers, inside item->out
+	size_t n, s, left;   //registers, current step, steps to go
+} SM4_KW_LANE;
+
+typedef struct
+{
+	const SM4_KEY *kek;
+	SM4_KW_ITEM *item;
+	size_t count, chunk;
+	int pad, wrap;
+} SM4_KW_JOB;
+
+/************************************************************
+Function:
+         static void SM4_KW_Check(SM4_KW_LANE *L, int pad);
+Description:
+         Verify the integrity register after unwrapping and set the
+         result of the item
+Calls:
+Called By:
+         SM4_KW_Start;
+         SM4_KW_Lanes
+Input:
+         L: finished lane
+         pad: 1 RFC 5649, 0 RFC 3394
+Output:
+         L->item: ret, outlen and out, wiped on failure
+Return:null
+Others:
+         All checks are done before the result is decided.
+************************************************************/
+static void SM4_KW_Check(SM4_KW_LANE *L, int pad)
+{
+	unsigned char diff = 0;
+	size_t mli, i;
+
+	if (!pad)
+	{
+		for (i = 0; i < 8; i++)
+			diff |= L->A[i] ^ SM4_KW_IV[i];
+		mli = 8 * L->n;
+	}
+	else
+	{
+		for (i = 0; i < 4; i++)
+			diff |= L->A[i] ^ SM4_KWP_AIV[i];
+		mli = SM4_GetU32(L->A + 4);
+		if (mli <= 8 * (L->n - 1) || mli > 8 * L->n)
+		{
+			diff = 1;
+			mli = 8 * L->n;
+		}
+		for (i = mli; i < 8 * L->n; i++)
+			diff |= L->R[i];
+	}
+
+	L->item->ret = diff != 0;
+	L->item->outlen = diff ? 0 : mli;
+	if (diff)
+		memset(L->item->out, 0, 8 * L->n);
+}
+
+/************************************************************
+Function:
+         static int SM4_KW_Start(const SM4_KEY *kek, SM4_KW_ITEM *item, SM4_KW_LANE *L, int pad, int wrap);
+Description:
+         Check the length of a key, copy it to its output and set up
+         the registers of a lane
+Calls:
+         SM4_CryptBlocks;
+         SM4_KW_Check
+Called By:
+         SM4_KW_Lanes
+Input:
+         kek: expanded KEK
+         item: key to process
+         pad: 1 RFC 5649, 0 RFC 3394
+         wrap: 1 wrap, 0 unwrap
+Output:
+         L: lane
+         item: ret and outlen when the key is already finished
+Return:
+         1 the key needs the six passes; 0 it is finished (bad length,
+         or a single block of RFC 5649)
+Others:
+************************************************************/
+static int SM4_KW_Start(const SM4_KEY *kek, SM4_KW_ITEM *item, SM4_KW_LANE *L, int pad, int wrap)
+{
+	unsigned char B[16];
+	size_t len = item->len;
+
+	item->ret = 1;
+	item->outlen = 0;
+	L->item = item;
+	if (wrap)
+	{
+		if (pad ? !len || len > 0xffffffffUL : len % 8 || len < 16)
+			return 0;
+		L->n = (len + 7) / 8;
+		memmove(item->out + 8, item->in, len);
+		memset(item->out + 8 + len, 0, 8 * L->n - len);
+		if (pad)
+		{
+			memcpy(L->A, SM4_KWP_AIV, 4);
+			SM4_PutU32(L->A + 4, (unsigned int)len);
+		}
+		else
+			memcpy(L->A, SM4_KW_IV, 8);
+		item->ret = 0;
+		item->outlen = 8 * L->n + 8;
+		if (L->n == 1)
+		{
+			memcpy(item->out, L->A, 8);
+			SM4_CryptBlocks(kek, item->out, item->out, 1);
+			return 0;
+		}
+		L->R = item->out + 8;
+		L->s = 0;
+	}
+	else
+	{
+		if (len % 8 || len < (pad ? 16u : 24u))
+			return 0;
+		L->n = len / 8 - 1;
+		memcpy(L->A, item->in, 8);
+		memmove(item->out, item->in + 8, 8 * L->n);
+		L->R = item->out;
+		if (L->n == 1)
+		{
+			memcpy(B, L->A, 8);
+			memcpy(B + 8, L->R, 8);
+			SM4_CryptBlocks(kek, B, B, 1);
+			memcpy(L->A, B, 8);
+			memcpy(L->R, B + 8, 8);
+			SM4_KW_Check(L, pad);
+			return 0;
+		}
+		L->s = 6 * L->n - 1;
+	}
+	L->left = 6 * L->n;
+	return 1;
+}
+
+/************************************************************
+Function:
+         static void SM4_KW_Lanes(const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad, int wrap);
+Description:
+         Wrap or unwrap keys, advancing up to SM4_KW_LANES of them per
+         kernel call
+Calls:
+         SM4_KW_Start;
+         SM4_CryptBlocks;
+         SM4_KW_Check
+Called By:
+         SM4_KW_Task;
+         SM4_KW_Batch
+Input:
+         kek: KEK expanded for encryption (wrap) or decryption (unwrap)
+         item[]: keys
+         count: number of keys
+         pad: 1 RFC 5649, 0 RFC 3394
+         wrap: 1 wrap, 0 unwrap
+Output:
+         item[]: out, outlen and ret of every key
+Return:null
+Others:
+         Step s of a key with n registers uses register s mod n and
+         t=s+1; wrapping runs s upwards, unwrapping downwards.
+************************************************************/
+static void SM4_KW_Lanes(const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad, int wrap)
+{
+	SM4_KW_LANE L[SM4_KW_LANES];
+	unsigned char buf[16 * SM4_KW_LANES];
+	unsigned long long t;
+	size_t next = 0, active = 0, k;
+	unsigned char *R;
+	int b;
+
+	for (;;)
+	{
+		while (active < SM4_KW_LANES && next < count)
+			if (SM4_KW_Start(kek, &item[next++], &L[active], pad, wrap))
+				active++;
+		if (!active)
+			break;
+
+		//B=E(A|R[i]) or B=D((A^t)|R[i])
+		for (k = 0; k < active; k++)
+		{
+			memcpy(buf + 16 * k, L[k].A, 8);
+			memcpy(buf + 16 * k + 8, L[k].R + 8 * (L[k].s % L[k].n), 8);
+			if (!wrap)
+				for (t = L[k].s + 1, b = 7; b >= 0; b--, t >>= 8)
+					buf[16 * k + b] ^= (unsigned char)t;
+		}
+		SM4_CryptBlocks(kek, buf, buf, active);
+
+		//A=MSB(B)^t or A=MSB(B), R[i]=LSB(B); retire finished keys
+		for (k = 0; k < active;)
+		{
+			R = L[k].R + 8 * (L[k].s % L[k].n);
+			memcpy(L[k].A, buf + 16 * k, 8);
+			memcpy(R, buf + 16 * k + 8, 8);
+			if (wrap)
+				for (t = L[k].s + 1, b = 7; b >= 0; b--, t >>= 8)
+					L[k].A[b] ^= (unsigned char)t;
+			if (--L[k].left)
+			{
+				L[k].s += wrap ? 1 : -1;
+				k++;
+				continue;
+			}
+			if (wrap)
+				memcpy(L[k].item->out, L[k].A, 8);
+			else
+				SM4_KW_Check(&L[k], pad);
+			active--;
+			if (k != active)
+			{
+				L[k] = L[active];
+				memcpy(buf + 16 * k, buf + 16 * active, 16);
+			}
+		}
+	}
+}
+
+static void SM4_KW_Task(void *arg, size_t i)
+{
+	SM4_KW_JOB *job = (SM4_KW_JOB *)arg;
+	size_t off = i * job->chunk, n = job->count - off;
+
+	SM4_KW_Lanes(job->kek, job->item + off, n < job->chunk ? n : job->chunk, job->pad, job->wrap);
+}
+
+/************************************************************
+Function:
+         static int SM4_KW_Batch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad, int wrap);
+Description:
+         Share the keys among the threads of a pool, each thread
+         running the lanes over its own slice
+Calls:
+         SM4_MT_Run;
+         SM4_KW_Lanes
+Called By:
+         SM4_KW_WrapBatch;
+         SM4_KW_UnwrapBatch
+Input:
+         pool: worker pool, NULL to stay on the calling thread
+         kek: expanded KEK
+         item[]: keys
+         count: number of keys
+         pad: 1 RFC 5649, 0 RFC 3394
+         wrap: 1 wrap, 0 unwrap
+Output:
+         item[]: out, outlen and ret of every key
+Return:
+         1 at least one key failed; 0 success
+Others:
+************************************************************/
+static int SM4_KW_Batch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad, int wrap)
+{
+	SM4_KW_JOB job;
+	size_t i;
+	int ret = 0;
+
+	job.kek = kek;
+	job.item = item;
+	job.count = count;
+	job.pad = pad;
+	job.wrap = wrap;
+	job.chunk = pool ? (count + pool->threads) / (pool->threads + 1) : count;
+	if (job.chunk < SM4_KW_MIN_TASK)
+		job.chunk = SM4_KW_MIN_TASK;
+	if (pool && count > job.chunk)
+		SM4_MT_Run(pool, SM4_KW_Task, &job, (count + job.chunk - 1) / job.chunk);
+	else
+		SM4_KW_Lanes(kek, item, count, pad, wrap);
+
+	for (i = 0; i < count; i++)
+		ret |= item[i].ret;
+	return ret;
+}
+
+/************************************************************
+Function:
+         int SM4_KW_Wrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[]);
+Description:
+         Wrap a key, RFC 3394
+Calls:
+         SM4_KW_Lanes
+Called By:
+         SM4_KW_SelfCheck
+Input:
+         kek: KEK expanded for encryption
+         in[]: key data
+         len: byte length of in[], a multiple of 8, at least 16
+Output:
+         out[]: len+8 bytes
+Return:
+         1 bad length; 0 success
+Others:
+************************************************************/
+int SM4_KW_Wrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[])
+{
+	SM4_KW_ITEM it;
+
+	it.in = in;
+	it.len = len;
+	it.out = out;
+	SM4_KW_Lanes(kek, &it, 1, 0, 1);
+	return it.ret;
+}
+
+/************************************************************
+Function:
+         int SM4_KW_Unwrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[]);
+Description:
+         Unwrap a key, RFC 3394
+Calls:
+         SM4_KW_Lanes
+Called By:
+         SM4_KW_SelfCheck
+Input:
+         kek: KEK expanded for decryption
+         in[]: wrapped key
+         len: byte length of in[], a multiple of 8, at least 24
+Output:
+         out[]: len-8 bytes, zeroed on failure
+Return:
+         1 bad length or integrity check failed; 0 success
+Others:
+************************************************************/
+int SM4_KW_Unwrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[])
+{
+	SM4_KW_ITEM it;
+
+	it.in = in;
+	it.len = len;
+	it.out = out;
+	SM4_KW_Lanes(kek, &it, 1, 0, 0);
+	return it.ret;
+}
+
+/************************************************************
+Function:
+         int SM4_KWP_Wrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[], size_t *outlen);
+Description:
+         Wrap a key of any length, RFC 5649
+Calls:
+         SM4_KW_Lanes
+Called By:
+         SM4_KW_SelfCheck
+Input:
+         kek: KEK expanded for encryption
+         in[]: key data
+         len: byte length of in[], 1..2^32-1
+Output:
+         out[]: wrapped key, len rounded up to 8 plus 8 bytes
+         outlen: byte length of out[]
+Return:
+         1 bad length; 0 success
+Others:
+************************************************************/
+int SM4_KWP_Wrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[], size_t *outlen)
+{
+	SM4_KW_ITEM it;
+
+	it.in = in;
+	it.len = len;
+	it.out = out;
+	SM4_KW_Lanes(kek, &it, 1, 1, 1);
+	*outlen = it.outlen;
+	return it.ret;
+}
+
+/************************************************************
+Function:
+         int SM4_KWP_Unwrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[], size_t *outlen);
+Description:
+         Unwrap a key of any length, RFC 5649
+Calls:
+         SM4_KW_Lanes
+Called By:
+         SM4_KW_SelfCheck
+Input:
+         kek: KEK expanded for decryption
+         in[]: wrapped key
+         len: byte length of in[], a multiple of 8, at least 16
+Output:
+         out[]: key data, room for len-8 bytes; zeroed on failure
+         outlen: byte length of the key data
+Return:
+         1 bad length or integrity check failed; 0 success
+Others:
+************************************************************/
+int SM4_KWP_Unwrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[], size_t *outlen)
+{
+	SM4_KW_ITEM it;
+
+	it.in = in;
+	it.len = len;
+	it.out = out;
+	SM4_KW_Lanes(kek, &it, 1, 1, 0);
+	*outlen = it.outlen;
+	return it.ret;
+}
+
+/************************************************************
+Function:
+         int SM4_KW_WrapBatch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad);
+Description:
+         Wrap many keys under one KEK
+Calls:
+         SM4_KW_Batch
+Called By:
+         SM4_KW_SelfCheck
+Input:
+         pool: worker pool, NULL to stay on the calling thread
+         kek: KEK expanded for encryption
+         item[]: in and len of every key
+         count: number of keys
+         pad: 1 RFC 5649, 0 RFC 3394
+Output:
+         item[]: out, outlen and ret of every key
+Return:
+         1 at least one key has a bad length; 0 success
+Others:
+************************************************************/
+int SM4_KW_WrapBatch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad)
+{
+	return SM4_KW_Batch(pool, kek, item, count, pad, 1);
+}
+
+/************************************************************
+Function:
+         int SM4_KW_UnwrapBatch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad);
+Description:
+         Unwrap many keys under one KEK
+Calls:
+         SM4_KW_Batch
+Called By:
+         SM4_KW_SelfCheck
+Input:
+         pool: worker pool, NULL to stay on the calling thread
+         kek: KEK expanded for decryption
+         item[]: in and len of every wrapped key
+         count: number of keys
+         pad: 1 RFC 5649, 0 RFC 3394
+Output:
+         item[]: out, outlen and ret of every key
+Return:
+         1 at least one key failed; 0 success
+Others:
+************************************************************/
+int SM4_KW_UnwrapBatch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad)
+{
+	return SM4_KW_Batch(pool, kek, item, count, pad, 0);
+}
+
+/************************************************************
+Function:
+         int SM4_KW_SelfCheck()
+Description:
+         Self-check with known answers
+Calls:
+         SM4_KW_Wrap;
+         SM4_KW_Unwrap;
+         SM4_KWP_Wrap;
+         SM4_KWP_Unwrap;
+         SM4_KW_WrapBatch;
+         SM4_KW_UnwrapBatch
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         KEK and key data are those of RFC 3394 4.1 and RFC 5649 6, the
+         answers are the SM4 results. A batch of 150 keys of mixed length
+         on a pool of two threads must match the single key functions.
+************************************************************/
+int SM4_KW_SelfCheck()
+{
+	unsigned char kek[16] = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+	unsigned char key[32] = {
+			0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+	unsigned char key20[20] = {
+			0xc3, 0x7b, 0x7e, 0x64, 0x92, 0x58, 0x43, 0x40, 0xbe, 0xd1, 0x22, 0x07, 0x80, 0x89, 0x41, 0x15,
+			0x50, 0x68, 0xf7, 0x38};
+	unsigned char key7[7] = {0x46, 0x6f, 0x72, 0x50, 0x61, 0x73, 0x69};
+	unsigned char Std_16[24] = {
+			0xc7, 0x2e, 0x8d, 0xbf, 0xef, 0xe8, 0x56, 0x25, 0x9f, 0xff, 0x77, 0xde, 0x20, 0x23, 0xb3, 0x80,
+			0xa9, 0xe2, 0xd0, 0xb8, 0xac, 0xb9, 0xb6, 0xf6};
+	unsigned char Std_32[40] = {
+			0x0e, 0xc3, 0x14, 0xe1, 0xcf, 0xa8, 0xfe, 0xcf, 0x50, 0xcf, 0x02, 0x86, 0xce, 0xf6, 0x58, 0xb9,
+			0x43, 0x2a, 0xec, 0xc5, 0xab, 0x78, 0xeb, 0x2d, 0x26, 0x3b, 0x3b, 0x0a, 0xb5, 0xde, 0xb0, 0x87,
+			0x81, 0x7e, 0x99, 0x5b, 0x00, 0x72, 0x5c, 0xf7};
+	unsigned char Std_20[32] = {
+			0xac, 0xd2, 0x5d, 0x03, 0x62, 0x93, 0x3a, 0xfe, 0xb9, 0x16, 0x34, 0xfe, 0x2a, 0xd2, 0xed, 0x1a,
+			0xc1, 0x70, 0xeb, 0xb3, 0x1d, 0x1b, 0x25, 0x85, 0xc6, 0x81, 0x12, 0x85, 0x1e, 0xb7, 0x2e, 0xab};
+	unsigned char Std_7[16] = {
+			0xb9, 0xb4, 0x75, 0x8a, 0x08, 0x18, 0xb2, 0xfa, 0xeb, 0x3e, 0xba, 0x37, 0xa3, 0x58, 0x83, 0xc2};
+	unsigned char out[48], back[48], data[150 * 40], wrapped[150 * 48], plain[150 * 40];
+	SM4_KW_ITEM item[150], item2[150];
+	SM4_KEY ek, dk;
+	SM4_MT_POOL pool;
+	size_t len, i;
+	int pad, ret = 1;
+
+	SM4_SetEncKey(kek, &ek);
+	SM4_SetDecKey(kek, &dk);
+
+	if (SM4_KW_Wrap(&ek, key, 16, out) || memcmp(out, Std_16, 24))
+		return 1;
+	if (SM4_KW_Unwrap(&dk, out, 24, back) || memcmp(back, key, 16))
+		return 1;
+	if (SM4_KW_Wrap(&ek, key, 32, out) || memcmp(out, Std_32, 40))
+		return 1;
+	if (SM4_KW_Unwrap(&dk, out, 40, back) || memcmp(back, key, 32))
+		return 1;
+	out[39] ^= 1;
+	if (!SM4_KW_Unwrap(&dk, out, 40, back))
+		return 1;
+
+	if (SM4_KWP_Wrap(&ek, key20, 20, out, &len) || len != 32 || memcmp(out, Std_20, 32))
+		return 1;
+	if (SM4_KWP_Unwrap(&dk, out, 32, back, &len) || len != 20 || memcmp(back, key20, 20))
+		return 1;
+	if (SM4_KWP_Wrap(&ek, key7, 7, out, &len) || len != 16 || memcmp(out, Std_7, 16))
+		return 1;
+	if (SM4_KWP_Unwrap(&dk, out, 16, back, &len) || len != 7 || memcmp(back, key7, 7))
+		return 1;
+	out[0] ^= 1;
+	if (!SM4_KWP_Unwrap(&dk, out, 16, back, &len))
+		return 1;
+
+	//batches of mixed length on two threads
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (unsigned char)(i * 11 + 7);
+	if (SM4_MT_Init(&pool, 2))
+		return 1;
+	for (pad = 0; pad <= 1; pad++)
+	{
+		for (i = 0; i < 150; i++)
+		{
+			item[i].in = data + 40 * i;
+			item[i].len = pad ? 1 + i % 40 : 16 + 8 * (i % 4);
+			item[i].out = wrapped + 48 * i;
+		}
+		if (SM4_KW_WrapBatch(&pool, &ek, item, 150, pad))
+			goto end;
+		for (i = 0; i < 150; i++)
+		{
+			if (pad)
+				SM4_KWP_Wrap(&ek, item[i].in, item[i].len, out, &len);
+			else
+				SM4_KW_Wrap(&ek, item[i].in, item[i].len, out);
+			len = pad ? len : item[i].len + 8;
+			if (item[i].outlen != len || memcmp(out, item[i].out, len))
+				goto end;
+			item2[i].in = item[i].out;
+			item2[i].len = item[i].outlen;
+			item2[i].out = plain + 40 * i;
+		}
+		if (SM4_KW_UnwrapBatch(&pool, &dk, item2, 150, pad))
+			goto end;
+		for (i = 0; i < 150; i++)
+			if (item2[i].outlen != item[i].len || memcmp(item2[i].out, item[i].in, item[i].len))
+				goto end;
+	}
+	ret = 0;
+
+end:
+	SM4_MT_Free(&pool);
+	return ret;
+}
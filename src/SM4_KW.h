@@ -0,0 +1,45 @@
+/************************************************************
+FileName:
+     SM4_KW.h
+Version:
+     SM4_KW_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the data type and function declarations of
+     the SM4 key wrap (RFC 3394) and key wrap with padding (RFC 5649).
+Function List:
+     1. SM4_KW_Wrap         //Wrap a key, RFC 3394
+     2. SM4_KW_Unwrap       //Unwrap a key, RFC 3394
+     3. SM4_KWP_Wrap        //Wrap a key of any length, RFC 5649
+     4. SM4_KWP_Unwrap      //Unwrap a key of any length, RFC 5649
+     5. SM4_KW_WrapBatch    //Wrap many keys
+     6. SM4_KW_UnwrapBatch  //Unwrap many keys
+     7. SM4_KW_SelfCheck    //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+#include "SM4_MT.h"
+
+//records advanced per kernel call of the batch functions
+#define SM4_KW_LANES 16
+
+//one key of a batch
+typedef struct
+{
+     const unsigned char *in;
+     size_t len;           //byte length of in
+     unsigned char *out;   //room for len+15 bytes (wrap) or len-8 bytes (unwrap)
+     size_t outlen;        //set by the batch function
+     int ret;              //set by the batch function, 1 bad length or integrity check failed
+} SM4_KW_ITEM;
+
+int SM4_KW_Wrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[]);
+int SM4_KW_Unwrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[]);
+int SM4_KWP_Wrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[], size_t *outlen);
+int SM4_KWP_Unwrap(const SM4_KEY *kek, const unsigned char in[], size_t len, unsigned char out[], size_t *outlen);
+int SM4_KW_WrapBatch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad);
+int SM4_KW_UnwrapBatch(SM4_MT_POOL *pool, const SM4_KEY *kek, SM4_KW_ITEM item[], size_t count, int pad);
+int SM4_KW_SelfCheck();
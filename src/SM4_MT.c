@@ -0,0 +1,550 @@
+/************************************************************
+FileName:
+     SM4_MT.c
+Version:
+     SM4_MT_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide multi-threaded SM4 CTR and GCM for very large
+     buffers. The text is cut into one piece per thread at block
+     boundaries; every piece starts at its own computed counter block.
+     For GCM every piece is also hashed from zero, and the partial
+     results are joined in order with X=X*H^n^Y, H^n computed once per
+     piece length, so the output and tag equal those of the single
+     threaded functions.
+Function List:
+     1. SM4_MT_Init               //Start a worker pool
+     2. SM4_MT_Free               //Stop a worker pool
+     3. SM4_MT_Run                //Run tasks on the pool and the caller
+     4. SM4_MT_CTR                //Parallel CTR encryption/decryption
+     5. SM4_MT_GCM_EncryptUpdate  //Parallel GCM encryption
+     6. SM4_MT_GCM_DecryptUpdate  //Parallel GCM decryption
+     7. SM4_MT_GCM_HashUpdate     //Parallel GHASH of the cipher text only
+     8. SM4_MT_SelfCheck          //Self-check
+************************************************************/
+
+#include "SM4_MT.h"
+#include "SM4_CTR.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	const SM4_KEY *key;
+	unsigned char *iv;
+	int width;
+	const unsigned char *in;
+	unsigned char *out;
+	size_t len, chunk;
+} SM4_MT_CTR_JOB;
+
+typedef struct
+{
+	SM4_GCM_CTX *part;
+	const unsigned char *in;
+	unsigned char *out;
+	size_t len, chunk;
+	int enc;
+} SM4_MT_GCM_JOB;
+
+//enc value of a GCM pass that only hashes the cipher text
+#define SM4_MT_GCM_HASH 2
+
+//the body of every worker thread
+static void *SM4_MT_Worker(void *p)
+{
+	SM4_MT_POOL *pool = (SM4_MT_POOL *)p;
+	size_t i;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;)
+	{
+		while (!pool->quit && pool->next >= pool->count)
+			pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->quit)
+			break;
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		pool->fn(pool->arg, i);
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->pending == 0)
+			pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/************************************************************
+Function:
+         int SM4_MT_Init(SM4_MT_POOL *pool, int threads);
+Description:
+         Start a pool of worker threads
+Calls:
+Called By:
+         SM4_MT_SelfCheck
+Input:
+         threads: number of worker threads, 0..SM4_MT_MAX_THREADS;
+                  the calling thread always works as well
+Output:
+         pool: worker pool
+Return:
+         1 bad thread count or a thread could not be created; 0 success
+Others:
+************************************************************/
+int SM4_MT_Init(SM4_MT_POOL *pool, int threads)
+{
+	int i;
+
+	if (threads < 0 || threads > SM4_MT_MAX_THREADS)
+		return 1;
+
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	for (i = 0; i < threads; i++)
+	{
+		if (pthread_create(&pool->tid[i], NULL, SM4_MT_Worker, pool))
+		{
+			pool->threads = i;
+			SM4_MT_Free(pool);
+			return 1;
+		}
+	}
+	pool->threads = threads;
+	return 0;
+}
+
+/************************************************************
+Function:
+         void SM4_MT_Free(SM4_MT_POOL *pool);
+Description:
+         Stop the worker threads and release the pool
+Calls:
+Called By:
+         SM4_MT_Init;
+         SM4_MT_SelfCheck
+Input:
+         pool: worker pool, no job may be running
+Output:
+Return:null
+Others:
+************************************************************/
+void SM4_MT_Free(SM4_MT_POOL *pool)
+{
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->threads; i++)
+		pthread_join(pool->tid[i], NULL);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	pthread_mutex_destroy(&pool->lock);
+	pool->threads = 0;
+}
+
+/************************************************************
+Function:
+         void SM4_MT_Run(SM4_MT_POOL *pool, void (*fn)(void *arg, size_t i), void *arg, size_t count);
+Description:
+         Run fn(arg,i) for i=0..count-1 on the workers and the calling
+         thread, and wait until all tasks are finished
+Calls:
+Called By:
+         SM4_MT_CTR;
+         SM4_MT_GCM_Update
+Input:
+         pool: worker pool
+         fn: task function
+         arg: argument passed to every task
+         count: number of tasks
+Output:
+Return:null
+Others:
+         One job at a time: a pool must not be shared by threads that
+         call SM4_MT_Run concurrently.
+************************************************************/
+void SM4_MT_Run(SM4_MT_POOL *pool, void (*fn)(void *arg, size_t i), void *arg, size_t count)
+{
+	size_t i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->next = 0;
+	pool->count = count;
+	pool->pending = count;
+	pthread_cond_broadcast(&pool->start);
+	while (pool->next < pool->count)
+	{
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		fn(arg, i);
+		pthread_mutex_lock(&pool->lock);
+		pool->pending--;
+	}
+	while (pool->pending)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+//blocks per piece when len bytes are shared by the pool
+static size_t SM4_MT_Chunk(const SM4_MT_POOL *pool, size_t len)
+{
+	size_t blocks = (len + 15) / 16, per;
+
+	per = (blocks + pool->threads) / (pool->threads + 1);
+	if (per < SM4_MT_MIN_CHUNK / 16)
+		per = SM4_MT_MIN_CHUNK / 16;
+	return per;
+}
+
+static void SM4_MT_CTRTask(void *arg, size_t i)
+{
+	SM4_MT_CTR_JOB *job = (SM4_MT_CTR_JOB *)arg;
+	SM4_CTR_CTX ctx;
+	size_t off = i * job->chunk, n = job->len - off;
+
+	if (n > job->chunk)
+		n = job->chunk;
+	SM4_CTR_Init(&ctx, job->key, job->iv, job->width);
+	SM4_CTR_Seek(&ctx, off);
+	SM4_CTR_Update(&ctx, job->in + off, job->out + off, n);
+}
+
+/************************************************************
+Function:
+         int SM4_MT_CTR(SM4_MT_POOL *pool, const SM4_KEY *key, unsigned char iv[], int width,
+                        const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         CTR encryption or decryption of a large buffer on a worker pool
+Calls:
+         SM4_MT_Chunk;
+         SM4_MT_Run;
+         SM4_CTR_Init;
+         SM4_CTR_Seek;
+         SM4_CTR_Update
+Called By:
+         SM4_MT_SelfCheck
+Input:
+         pool: worker pool
+         key: expanded encryption key, see SM4_SetEncKey
+         iv[]: initial counter block, 16 bytes
+         width: SM4_CTR_WIDTH32 or SM4_CTR_WIDTH128
+         in[]: input data
+         len: byte length of in[]
+Output:
+         out[]: output data, may be the same as in[]
+Return:
+         1 unsupported width; 0 success
+Others:
+         The result equals that of SM4_CTR_Encrypt with the same key.
+************************************************************/
+int SM4_MT_CTR(SM4_MT_POOL *pool, const SM4_KEY *key, unsigned char iv[], int width,
+               const unsigned char in[], unsigned char out[], size_t len)
+{
+	SM4_MT_CTR_JOB job;
+
+	if (width != SM4_CTR_WIDTH32 && width != SM4_CTR_WIDTH128)
+		return 1;
+	if (!len)
+		return 0;
+
+	job.key = key;
+	job.iv = iv;
+	job.width = width;
+	job.in = in;
+	job.out = out;
+	job.len = len;
+	job.chunk = 16 * SM4_MT_Chunk(pool, len);
+	SM4_MT_Run(pool, SM4_MT_CTRTask, &job, (len + job.chunk - 1) / job.chunk);
+	return 0;
+}
+
+//one serial GCM step: 1 encrypt, 0 decrypt, SM4_MT_GCM_HASH hash only (out unused)
+static int SM4_MT_GCM_Step(SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len, int enc)
+{
+	if (enc == SM4_MT_GCM_HASH)
+		return SM4_GCM_HashUpdate(ctx, in, len);
+	return enc ? SM4_GCM_EncryptUpdate(ctx, in, out, len) : SM4_GCM_DecryptUpdate(ctx, in, out, len);
+}
+
+static void SM4_MT_GCMTask(void *arg, size_t i)
+{
+	SM4_MT_GCM_JOB *job = (SM4_MT_GCM_JOB *)arg;
+	size_t off = i * job->chunk, n = job->len - off;
+
+	if (n > job->chunk)
+		n = job->chunk;
+	SM4_MT_GCM_Step(&job->part[i], job->in + off, job->out ? job->out + off : NULL, n, job->enc);
+}
+
+/************************************************************
+Function:
+         static int SM4_MT_GCM_Update(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len, int enc);
+Description:
+         Encrypt or decrypt the next part of a GCM message on a worker
+         pool and hash the cipher text
+Calls:
+         SM4_MT_GCM_Step;
+         SM4_CTR_AddCounter;
+         SM4_GCM_PowH;
+         SM4_GCM_Mul;
+         SM4_MT_Chunk;
+         SM4_MT_Run
+Called By:
+         SM4_MT_GCM_EncryptUpdate;
+         SM4_MT_GCM_DecryptUpdate;
+         SM4_MT_GCM_HashUpdate
+Input:
+         pool: worker pool
+         ctx: GCM context
+         in[]: input text
+         len: byte length of in[]
+         enc: 1 encrypt, 0 decrypt, SM4_MT_GCM_HASH hash the cipher
+              text only
+Output:
+         out[]: output text, may be the same as in[]; NULL when hashing
+Return:
+         1 text too long; 0 success
+Others:
+         Every piece runs on a copy of the context with a zero GHASH
+         accumulator and its own counter. Only the last piece may end in
+         a partial block, whose pending bytes are carried over into ctx.
+************************************************************/
+static int SM4_MT_GCM_Update(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len, int enc)
+{
+	SM4_GCM_CTX part[SM4_MT_MAX_THREADS + 1];
+	SM4_MT_GCM_JOB job;
+	unsigned char P[16], Plast[16];
+	size_t chunk, tasks, head, i;
+	int j;
+
+	if (len > SM4_GCM_MAX_TEXT - ctx->mlen)
+		return 1;
+
+	//close the AAD and finish a partial block of the text serially
+	head = ctx->mres ? 16 - ctx->mres : 0;
+	if (head > len)
+		head = len;
+	if (SM4_MT_GCM_Step(ctx, in, out, head, enc))
+		return 1;
+	in += head;
+	if (out)
+		out += head;
+	len -= head;
+
+	chunk = SM4_MT_Chunk(pool, len);
+	tasks = (len + 16 * chunk - 1) / (16 * chunk);
+	if (tasks <= 1)
+		return SM4_MT_GCM_Step(ctx, in, out, len, enc);
+
+	for (i = 0; i < tasks; i++)
+	{
+		part[i] = *ctx;
+		memset(part[i].Xi, 0, 16);
+		part[i].mlen = 0;
+		SM4_CTR_AddCounter(part[i].ctr, i * chunk, SM4_CTR_WIDTH32);
+	}
+	job.part = part;
+	job.in = in;
+	job.out = out;
+	job.len = len;
+	job.chunk = 16 * chunk;
+	job.enc = enc;
+	SM4_MT_Run(pool, SM4_MT_GCMTask, &job, tasks);
+
+	//join the partial hashes in order
+	SM4_GCM_PowH(ctx, chunk, P);
+	SM4_GCM_PowH(ctx, (len - (tasks - 1) * 16 * chunk) / 16, Plast);
+	for (i = 0; i < tasks; i++)
+	{
+		SM4_GCM_Mul(ctx->Xi, i + 1 < tasks ? P : Plast);
+		for (j = 0; j < 16; j++)
+			ctx->Xi[j] ^= part[i].Xi[j];
+	}
+	memcpy(ctx->ctr, part[tasks - 1].ctr, 16);
+	memcpy(ctx->ks, part[tasks - 1].ks, 16);
+	ctx->mres = part[tasks - 1].mres;
+	ctx->mlen += len;
+
+	memset(part, 0, tasks * sizeof(part[0]));
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_MT_GCM_EncryptUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Encrypt the next part of a GCM message on a worker pool
+Calls:
+         SM4_MT_GCM_Update
+Called By:
+         SM4_MT_SelfCheck
+Input:
+         pool: worker pool
+         ctx: GCM context after SM4_GCM_SetIV and SM4_GCM_AAD
+         in[]: plain text
+         len: byte length of in[]
+Output:
+         out[]: cipher text, may be the same as in[]
+Return:
+         1 text too long; 0 success
+Others:
+         May be mixed with SM4_GCM_EncryptUpdate, finish with SM4_GCM_Tag.
+************************************************************/
+int SM4_MT_GCM_EncryptUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len)
+{
+	return SM4_MT_GCM_Update(pool, ctx, in, out, len, 1);
+}
+
+/************************************************************
+Function:
+         int SM4_MT_GCM_DecryptUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Decrypt the next part of a GCM message on a worker pool
+Calls:
+         SM4_MT_GCM_Update
+Called By:
+         SM4_MT_SelfCheck
+Input:
+         pool: worker pool
+         ctx: GCM context after SM4_GCM_SetIV and SM4_GCM_AAD
+         in[]: cipher text
+         len: byte length of in[]
+Output:
+         out[]: plain text, may be the same as in[]
+Return:
+         1 text too long; 0 success
+Others:
+         The plain text must not be used before SM4_GCM_CheckTag succeeds.
+************************************************************/
+int SM4_MT_GCM_DecryptUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len)
+{
+	return SM4_MT_GCM_Update(pool, ctx, in, out, len, 0);
+}
+
+/************************************************************
+Function:
+         int SM4_MT_GCM_HashUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], size_t len);
+Description:
+         Authenticate the next part of the cipher text on a worker pool
+         without decrypting it
+Calls:
+         SM4_MT_GCM_Update
+Called By:
+         SM4_FILE_Crypt;
+         SM4_MT_SelfCheck
+Input:
+         pool: worker pool
+         ctx: GCM context after SM4_GCM_SetIV and SM4_GCM_AAD
+         in[]: cipher text
+         len: byte length of in[]
+Output:
+         ctx: GCM context
+Return:
+         1 text too long; 0 success
+Others:
+         Same restrictions as SM4_GCM_HashUpdate: finish with
+         SM4_GCM_CheckTag and decrypt from a copy of the context.
+************************************************************/
+int SM4_MT_GCM_HashUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], size_t len)
+{
+	return SM4_MT_GCM_Update(pool, ctx, in, NULL, len, SM4_MT_GCM_HASH);
+}
+
+/************************************************************
+Function:
+         int SM4_MT_SelfCheck()
+Description:
+         Compare the parallel functions with the single threaded ones
+Calls:
+         SM4_MT_Init;
+         SM4_MT_CTR;
+         SM4_MT_GCM_EncryptUpdate;
+         SM4_MT_GCM_DecryptUpdate;
+         SM4_MT_GCM_HashUpdate;
+         SM4_MT_Free
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         The text is cut into four pieces, the last one ending in a
+         partial block; the CTR counter wraps its last word inside the
+         first piece.
+************************************************************/
+int SM4_MT_SelfCheck()
+{
+	unsigned char key[16] = {
+			0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10};
+	unsigned char iv[16] = {
+			0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xff, 0xff, 0xff, 0x00};
+	unsigned char aad[13] = {0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xab, 0xad, 0xda, 0xd2, 0x01};
+	size_t len = 4 * SM4_MT_MIN_CHUNK - 11, i;
+	unsigned char *data, *ref, *buf, tag[16], tag2[16];
+	SM4_MT_POOL pool;
+	SM4_GCM_CTX ctx;
+	SM4_KEY ek;
+	int width, ret = 1;
+
+	data = (unsigned char *)malloc(3 * len);
+	if (!data)
+		return 1;
+	ref = data + len;
+	buf = ref + len;
+	if (SM4_MT_Init(&pool, 3))
+	{
+		free(data);
+		return 1;
+	}
+	for (i = 0; i < len; i++)
+		data[i] = (unsigned char)(i * 13 + 5);
+	SM4_SetEncKey(key, &ek);
+
+	for (width = SM4_CTR_WIDTH32; width <= SM4_CTR_WIDTH128; width += SM4_CTR_WIDTH128 - SM4_CTR_WIDTH32)
+	{
+		SM4_CTR_Encrypt(key, iv, width, data, ref, len);
+		SM4_MT_CTR(&pool, &ek, iv, width, data, buf, len);
+		if (memcmp(ref, buf, len))
+			goto end;
+	}
+
+	SM4_GCM_Init(&ctx, &ek);
+	SM4_GCM_SetIV(&ctx, iv, 12);
+	SM4_GCM_AAD(&ctx, aad, 13);
+	SM4_GCM_EncryptUpdate(&ctx, data, ref, len);
+	SM4_GCM_Tag(&ctx, tag);
+
+	SM4_GCM_SetIV(&ctx, iv, 12);
+	SM4_GCM_AAD(&ctx, aad, 13);
+	SM4_MT_GCM_EncryptUpdate(&pool, &ctx, data, buf, 5);
+	SM4_MT_GCM_EncryptUpdate(&pool, &ctx, data + 5, buf + 5, len - 5);
+	SM4_GCM_Tag(&ctx, tag2);
+	if (memcmp(ref, buf, len) || memcmp(tag, tag2, 16))
+		goto end;
+
+	SM4_GCM_SetIV(&ctx, iv, 12);
+	SM4_GCM_AAD(&ctx, aad, 13);
+	SM4_MT_GCM_DecryptUpdate(&pool, &ctx, buf, buf, len);
+	if (SM4_GCM_CheckTag(&ctx, tag, 16) || memcmp(buf, data, len))
+		goto end;
+
+	SM4_GCM_SetIV(&ctx, iv, 12);
+	SM4_GCM_AAD(&ctx, aad, 13);
+	if (SM4_MT_GCM_HashUpdate(&pool, &ctx, ref, 5) || SM4_MT_GCM_HashUpdate(&pool, &ctx, ref + 5, len - 5) ||
+		SM4_GCM_CheckTag(&ctx, tag, 16))
+		goto end;
+	ret = 0;
+
+end:
+	SM4_MT_Free(&pool);
+	free(data);
+	return ret;
+}
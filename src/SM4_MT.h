@@ -0,0 +1,54 @@
+/************************************************************
+FileName:
+     SM4_MT.h
+Version:
+     SM4_MT_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the worker pool and function declarations of
+     the multi-threaded SM4 CTR and GCM bulk operations.
+Function List:
+     1. SM4_MT_Init               //Start a worker pool
+     2. SM4_MT_Free               //Stop a worker pool
+     3. SM4_MT_Run                //Run tasks on the pool and the caller
+     4. SM4_MT_CTR                //Parallel CTR encryption/decryption
+     5. SM4_MT_GCM_EncryptUpdate  //Parallel GCM encryption
+     6. SM4_MT_GCM_DecryptUpdate  //Parallel GCM decryption
+     7. SM4_MT_GCM_HashUpdate     //Parallel GHASH of the cipher text only
+     8. SM4_MT_SelfCheck          //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+#include "SM4_GCM.h"
+
+#include <pthread.h>
+
+#define SM4_MT_MAX_THREADS 64
+
+//smallest piece of text given to one thread, a multiple of 16
+#define SM4_MT_MIN_CHUNK (64 * 1024)
+
+typedef struct
+{
+     int threads;                          //worker threads, the caller works too
+     pthread_t tid[SM4_MT_MAX_THREADS];
+     pthread_mutex_t lock;
+     pthread_cond_t start, done;
+     void (*fn)(void *arg, size_t i);      //task function of the current job
+     void *arg;
+     size_t next, count, pending;          //next task, tasks of the job, tasks not finished
+     int quit;
+} SM4_MT_POOL;
+
+int SM4_MT_Init(SM4_MT_POOL *pool, int threads);
+void SM4_MT_Free(SM4_MT_POOL *pool);
+void SM4_MT_Run(SM4_MT_POOL *pool, void (*fn)(void *arg, size_t i), void *arg, size_t count);
+int SM4_MT_CTR(SM4_MT_POOL *pool, const SM4_KEY *key, unsigned char iv[], int width,
+               const unsigned char in[], unsigned char out[], size_t len);
+int SM4_MT_GCM_EncryptUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+int SM4_MT_GCM_DecryptUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+int SM4_MT_GCM_HashUpdate(SM4_MT_POOL *pool, SM4_GCM_CTX *ctx, const unsigned char in[], size_t len);
+int SM4_MT_SelfCheck();
@@ -0,0 +1,341 @@
+/************************************************************
+FileName:
+     SM4_REKEY.c
+Version:
+     SM4_REKEY_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide single-pass re-encryption of SM4-CBC or SM4-CTR
+     data from an old key into a new one. The data is walked in tiles of
+     SM4_REKEY_TILE bytes: a tile is decrypted into a buffer on the stack
+     with the multi-block CBC or CTR kernel and at once encrypted from
+     there into the output, so the plain text never leaves the L1 cache
+     and the data is read and written once. Input positions are
+     independent under CTR and CBC decryption, so the parallel call cuts
+     the data into chunks for a worker pool whenever the new encryption
+     is CTR; CBC encryption is serial by construction.
+Function List:
+     1. SM4_REKEY_Init       //Set up the old and the new cipher
+     2. SM4_REKEY_Update     //Re-encrypt the next part of the data
+     3. SM4_REKEY_MT         //Re-encrypt the next part on a worker pool
+     4. SM4_REKEY_SelfCheck  //Self-check
+************************************************************/
+
+#include "SM4_REKEY.h"
+#include "SM4_CBC.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	const SM4_REKEY_CTX *ctx;
+	unsigned char (*iv)[16]; //CBC chaining value of every chunk
+	const unsigned char *in;
+	unsigned char *out;
+	size_t len, chunk;
+} SM4_REKEY_JOB;
+
+static int SM4_REKEY_SetSide(SM4_REKEY_SIDE *side, int mode, const SM4_KEY *key, const unsigned char iv[16])
+{
+	if (mode != SM4_REKEY_CBC && mode != SM4_REKEY_CTR32 && mode != SM4_REKEY_CTR128)
+		return 1;
+
+	side->mode = mode;
+	side->key = *key;
+	memcpy(side->iv, iv, 16);
+	if (mode != SM4_REKEY_CBC)
+		SM4_CTR_Init(&side->ctr, key, (unsigned char *)iv, mode == SM4_REKEY_CTR32 ? SM4_CTR_WIDTH32 : SM4_CTR_WIDTH128);
+	return 0;
+}
+
+/************************************************************
+Function:
+         static void SM4_REKEY_Tiles(SM4_REKEY_SIDE *from, SM4_REKEY_SIDE *to, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Decrypt and re-encrypt tile by tile
+Calls:
+         SM4_CBC_Decrypt;
+         SM4_CBC_Encrypt;
+         SM4_CTR_Update
+Called By:
+         SM4_REKEY_Update;
+         SM4_REKEY_Task
+Input:
+         from: old cipher
+         to: new cipher
+         in[]: data under the old key
+         len: byte length of in[], a multiple of 16 if a side is CBC
+Output:
+         from, to: state after the data
+         out[]: data under the new key, may be the same as in[]
+Return:null
+Others:
+************************************************************/
+static void SM4_REKEY_Tiles(SM4_REKEY_SIDE *from, SM4_REKEY_SIDE *to, const unsigned char in[], unsigned char out[], size_t len)
+{
+	unsigned char tile[SM4_REKEY_TILE];
+	size_t n;
+
+	for (; len; len -= n, in += n, out += n)
+	{
+		n = len < SM4_REKEY_TILE ? len : SM4_REKEY_TILE;
+		if (from->mode == SM4_REKEY_CBC)
+			SM4_CBC_Decrypt(&from->key, from->iv, in, tile, n);
+		else
+			SM4_CTR_Update(&from->ctr, in, tile, n);
+		if (to->mode == SM4_REKEY_CBC)
+			SM4_CBC_Encrypt(&to->key, to->iv, tile, out, n);
+		else
+			SM4_CTR_Update(&to->ctr, tile, out, n);
+	}
+	memset(tile, 0, sizeof(tile));
+}
+
+/************************************************************
+Function:
+         int SM4_REKEY_Init(SM4_REKEY_CTX *ctx, int oldmode, const SM4_KEY *oldkey, const unsigned char oldiv[16],
+                            int newmode, const SM4_KEY *newkey, const unsigned char newiv[16]);
+Description:
+         Set up the re-encryption from the old into the new cipher
+Calls:
+         SM4_CTR_Init
+Called By:
+         SM4_REKEY_SelfCheck
+Input:
+         oldmode, newmode: SM4_REKEY_CBC, SM4_REKEY_CTR32 or SM4_REKEY_CTR128
+         oldkey: old key, expanded for decryption (SM4_SetDecKey) under
+                 CBC and for encryption (SM4_SetEncKey) under CTR
+         oldiv[]: old CBC IV or initial counter block
+         newkey: new key expanded for encryption, see SM4_SetEncKey
+         newiv[]: new CBC IV or initial counter block
+Output:
+         ctx: re-encryption context
+Return:
+         1 unsupported mode; 0 success
+Others:
+************************************************************/
+int SM4_REKEY_Init(SM4_REKEY_CTX *ctx, int oldmode, const SM4_KEY *oldkey, const unsigned char oldiv[16],
+                   int newmode, const SM4_KEY *newkey, const unsigned char newiv[16])
+{
+	memset(ctx, 0, sizeof(*ctx));
+	return SM4_REKEY_SetSide(&ctx->from, oldmode, oldkey, oldiv) || SM4_REKEY_SetSide(&ctx->to, newmode, newkey, newiv);
+}
+
+/************************************************************
+Function:
+         int SM4_REKEY_Update(SM4_REKEY_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Re-encrypt the next part of the data on the calling thread
+Calls:
+         SM4_REKEY_Tiles
+Called By:
+         SM4_REKEY_MT;
+         SM4_REKEY_SelfCheck
+Input:
+         ctx: re-encryption context
+         in[]: data under the old key
+         len: byte length of in[], a multiple of 16 if a side is CBC
+Output:
+         ctx: re-encryption context
+         out[]: data under the new key, may be the same as in[]
+Return:
+         1 bad length; 0 success
+Others:
+************************************************************/
+int SM4_REKEY_Update(SM4_REKEY_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len)
+{
+	if (len % 16 && (ctx->from.mode == SM4_REKEY_CBC || ctx->to.mode == SM4_REKEY_CBC))
+		return 1;
+
+	SM4_REKEY_Tiles(&ctx->from, &ctx->to, in, out, len);
+	return 0;
+}
+
+static void SM4_REKEY_Task(void *arg, size_t i)
+{
+	SM4_REKEY_JOB *job = (SM4_REKEY_JOB *)arg;
+	SM4_REKEY_SIDE from = job->ctx->from, to = job->ctx->to;
+	size_t off = i * job->chunk, n = job->len - off;
+
+	if (n > job->chunk)
+		n = job->chunk;
+	if (from.mode == SM4_REKEY_CBC)
+		memcpy(from.iv, job->iv[i], 16);
+	else
+		SM4_CTR_AddCounter(from.ctr.ctr, off / 16, from.ctr.width);
+	SM4_CTR_AddCounter(to.ctr.ctr, off / 16, to.ctr.width);
+	SM4_REKEY_Tiles(&from, &to, job->in + off, job->out + off, n);
+	memset(&from, 0, sizeof(from));
+	memset(&to, 0, sizeof(to));
+}
+
+/************************************************************
+Function:
+         int SM4_REKEY_MT(SM4_MT_POOL *pool, SM4_REKEY_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Re-encrypt the next part of the data on a worker pool
+Calls:
+         SM4_REKEY_Update;
+         SM4_REKEY_Task;
+         SM4_MT_Run;
+         SM4_CTR_AddCounter
+Called By:
+         SM4_REKEY_SelfCheck
+Input:
+         pool: worker pool
+         ctx: re-encryption context
+         in[]: data under the old key
+         len: byte length of in[], a multiple of 16 if a side is CBC
+Output:
+         ctx: re-encryption context
+         out[]: data under the new key, may be the same as in[]
+Return:
+         1 bad length; 0 success
+Others:
+         The result equals that of SM4_REKEY_Update. A new CBC cipher
+         runs on the calling thread only. The old CBC chaining values of
+         the chunks are saved before the pool starts, so in place
+         operation is safe. A partial CTR block at either end is done
+         serially.
+************************************************************/
+int SM4_REKEY_MT(SM4_MT_POOL *pool, SM4_REKEY_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len)
+{
+	unsigned char iv[SM4_MT_MAX_THREADS + 1][16];
+	SM4_REKEY_JOB job;
+	size_t head, blocks, tasks, i;
+
+	if (len % 16 && (ctx->from.mode == SM4_REKEY_CBC || ctx->to.mode == SM4_REKEY_CBC))
+		return 1;
+	if (ctx->to.mode == SM4_REKEY_CBC || len < 2 * SM4_MT_MIN_CHUNK)
+		return SM4_REKEY_Update(ctx, in, out, len);
+
+	//both sides are at the same offset within a block
+	head = (16 - ctx->to.ctr.num) & 15;
+	if (head > len)
+		head = len;
+	SM4_REKEY_Update(ctx, in, out, head);
+	in += head;
+	out += head;
+	len -= head;
+
+	blocks = len / 16;
+	job.chunk = (blocks + pool->threads) / (pool->threads + 1);
+	if (job.chunk < SM4_MT_MIN_CHUNK / 16)
+		job.chunk = SM4_MT_MIN_CHUNK / 16;
+	job.chunk *= 16;
+	tasks = (16 * blocks + job.chunk - 1) / job.chunk;
+	if (ctx->from.mode == SM4_REKEY_CBC)
+	{
+		memcpy(iv[0], ctx->from.iv, 16);
+		for (i = 1; i < tasks; i++)
+			memcpy(iv[i], in + i * job.chunk - 16, 16);
+		if (blocks)
+			memcpy(ctx->from.iv, in + 16 * blocks - 16, 16);
+	}
+	job.ctx = ctx;
+	job.iv = iv;
+	job.in = in;
+	job.out = out;
+	job.len = 16 * blocks;
+	SM4_MT_Run(pool, SM4_REKEY_Task, &job, tasks);
+
+	if (ctx->from.mode != SM4_REKEY_CBC)
+		SM4_CTR_AddCounter(ctx->from.ctr.ctr, blocks, ctx->from.ctr.width);
+	SM4_CTR_AddCounter(ctx->to.ctr.ctr, blocks, ctx->to.ctr.width);
+	return SM4_REKEY_Update(ctx, in + 16 * blocks, out + 16 * blocks, len - 16 * blocks);
+}
+
+/************************************************************
+Function:
+         int SM4_REKEY_SelfCheck()
+Description:
+         Compare re-encryption with decryption followed by encryption
+Calls:
+         SM4_CBC_Encrypt;
+         SM4_CTR_Encrypt;
+         SM4_REKEY_Init;
+         SM4_REKEY_Update;
+         SM4_REKEY_MT
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         CBC to CTR and CTR to CTR run in place on a pool of three
+         workers, the CTR text ends in a partial block and starts with a
+         short serial call. CTR to CBC runs in uneven pieces.
+************************************************************/
+int SM4_REKEY_SelfCheck()
+{
+	unsigned char key1[16] = {
+			0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10};
+	unsigned char key2[16] = {
+			0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0xef, 0xcd, 0xab, 0x89, 0x67, 0x45, 0x23, 0x01};
+	unsigned char iv1[16] = {
+			0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xff, 0xff, 0xff, 0x00};
+	unsigned char iv2[16] = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xf0};
+	size_t len = 4 * SM4_MT_MIN_CHUNK + 16 * 7, i;
+	unsigned char *data, *ref, *buf, iv[16];
+	SM4_REKEY_CTX ctx;
+	SM4_MT_POOL pool;
+	SM4_KEY ek1, dk1, ek2;
+	int ret = 1;
+
+	data = (unsigned char *)malloc(3 * (len + 16));
+	if (!data)
+		return 1;
+	ref = data + len + 16;
+	buf = ref + len + 16;
+	if (SM4_MT_Init(&pool, 3))
+	{
+		free(data);
+		return 1;
+	}
+	for (i = 0; i < len + 16; i++)
+		data[i] = (unsigned char)(i * 13 + 5);
+	SM4_SetEncKey(key1, &ek1);
+	SM4_SetDecKey(key1, &dk1);
+	SM4_SetEncKey(key2, &ek2);
+
+	//CBC to CTR128, in place on the pool
+	memcpy(iv, iv1, 16);
+	SM4_CBC_Encrypt(&ek1, iv, data, buf, len);
+	SM4_CTR_Encrypt(key2, iv2, SM4_CTR_WIDTH128, data, ref, len);
+	if (SM4_REKEY_Init(&ctx, SM4_REKEY_CBC, &dk1, iv1, SM4_REKEY_CTR128, &ek2, iv2))
+		goto end;
+	if (SM4_REKEY_MT(&pool, &ctx, buf, buf, 48) || SM4_REKEY_MT(&pool, &ctx, buf + 48, buf + 48, len - 48))
+		goto end;
+	if (memcmp(buf, ref, len) || !SM4_REKEY_MT(&pool, &ctx, buf, buf, 5))
+		goto end;
+
+	//CTR32 to CTR128, 5 bytes first and a partial block at the end
+	SM4_CTR_Encrypt(key1, iv1, SM4_CTR_WIDTH32, data, buf, len + 9);
+	SM4_CTR_Encrypt(key2, iv2, SM4_CTR_WIDTH128, data, ref, len + 9);
+	if (SM4_REKEY_Init(&ctx, SM4_REKEY_CTR32, &ek1, iv1, SM4_REKEY_CTR128, &ek2, iv2))
+		goto end;
+	if (SM4_REKEY_MT(&pool, &ctx, buf, buf, 5) || SM4_REKEY_MT(&pool, &ctx, buf + 5, buf + 5, len + 4))
+		goto end;
+	if (memcmp(buf, ref, len + 9))
+		goto end;
+
+	//CTR128 to CBC, serially in two pieces
+	SM4_CTR_Encrypt(key1, iv2, SM4_CTR_WIDTH128, data, buf, len);
+	memcpy(iv, iv1, 16);
+	SM4_CBC_Encrypt(&ek2, iv, data, ref, len);
+	if (SM4_REKEY_Init(&ctx, SM4_REKEY_CTR128, &ek1, iv2, SM4_REKEY_CBC, &ek2, iv1))
+		goto end;
+	if (SM4_REKEY_MT(&pool, &ctx, buf, buf, 4096 + 32) || SM4_REKEY_Update(&ctx, buf + 4128, buf + 4128, len - 4128))
+		goto end;
+	if (memcmp(buf, ref, len) || memcmp(ctx.to.iv, iv, 16))
+		goto end;
+	ret = 0;
+
+end:
+	SM4_MT_Free(&pool);
+	free(data);
+	return ret;
+}
@@ -0,0 +1,50 @@
+/************************************************************
+FileName:
+     SM4_REKEY.h
+Version:
+     SM4_REKEY_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the context and function declarations of the
+     single-pass SM4 re-encryption of stored CBC or CTR data under a
+     new key.
+Function List:
+     1. SM4_REKEY_Init       //Set up the old and the new cipher
+     2. SM4_REKEY_Update     //Re-encrypt the next part of the data
+     3. SM4_REKEY_MT         //Re-encrypt the next part on a worker pool
+     4. SM4_REKEY_SelfCheck  //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+#include "SM4_CTR.h"
+#include "SM4_MT.h"
+
+//modes of the old and the new encryption
+#define SM4_REKEY_CBC    0
+#define SM4_REKEY_CTR32  1 //SM4_CTR_WIDTH32 counter
+#define SM4_REKEY_CTR128 2 //SM4_CTR_WIDTH128 counter
+
+//bytes of plain text held at a time, small enough to stay in the L1 cache
+#define SM4_REKEY_TILE 4096
+
+typedef struct
+{
+     int mode;
+     SM4_KEY key;           //CBC key, for decryption on the old side
+     unsigned char iv[16];  //CBC chaining value
+     SM4_CTR_CTX ctr;       //CTR state
+} SM4_REKEY_SIDE;
+
+typedef struct
+{
+     SM4_REKEY_SIDE from, to; //old and new encryption
+} SM4_REKEY_CTX;
+
+int SM4_REKEY_Init(SM4_REKEY_CTX *ctx, int oldmode, const SM4_KEY *oldkey, const unsigned char oldiv[16],
+                   int newmode, const SM4_KEY *newkey, const unsigned char newiv[16]);
+int SM4_REKEY_Update(SM4_REKEY_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+int SM4_REKEY_MT(SM4_MT_POOL *pool, SM4_REKEY_CTX *ctx, const unsigned char in[], unsigned char out[], size_t len);
+int SM4_REKEY_SelfCheck();
@@ -0,0 +1,364 @@
+/************************************************************
+FileName:
+     SM4_XTS.c
+Version:
+     SM4_XTS_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This code provide the SM4 XTS mode (IEEE P1619 construction) for
+     sector based storage encryption. The tweak of a data unit is
+     encrypted once, the following tweaks are obtained by multiplying by
+     alpha (doubling in GF(2^128)) with SSE2 where available. Up to 16
+     blocks are whitened with their tweaks and run through the multi-block
+     kernel at once, a trailing partial block is handled by ciphertext
+     stealing.
+Function List:
+     1. SM4_XTS_Init          //Expand the data and tweak keys
+     2. SM4_XTS_Crypt         //Encrypt/decrypt one data unit
+     3. SM4_XTS_CryptSectors  //Encrypt/decrypt consecutive sectors
+     4. SM4_XTS_SelfCheck     //Self-check
+************************************************************/
+
+#include "SM4_XTS.h"
+
+#include <string.h>
+#if defined(SM4_X86) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//blocks (and sector tweaks) handed to the kernel at once
+#define SM4_XTS_STRIDE 16
+
+/************************************************************
+Function:
+         static void SM4_XTS_Tweaks(unsigned char T[], unsigned char tw[], size_t n);
+Description:
+         Write the tweaks T, T*alpha, ..., T*alpha^(n-1) of the next n blocks
+Calls:
+Called By:
+         SM4_XTS_Unit
+Input:
+         T[]: tweak of the next block, 128bit little-endian
+         n: the number of blocks
+Output:
+         T[]: tweak of the block after them
+         tw[]: n tweaks
+Return:null
+Others:
+************************************************************/
+#if defined(SM4_X86) && defined(__SSE2__)
+static void SM4_XTS_Tweaks(unsigned char T[], unsigned char tw[], size_t n)
+{
+	//x^128=x^7+x^2+x+1, carry out of the low qword goes to bit 64
+	const __m128i poly = _mm_set_epi32(0, 1, 0, 0x87);
+	__m128i t = _mm_loadu_si128((const __m128i *)T), m;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		_mm_storeu_si128((__m128i *)(tw + 16 * i), t);
+		m = _mm_and_si128(_mm_shuffle_epi32(_mm_srai_epi32(t, 31), 0x13), poly);
+		t = _mm_xor_si128(_mm_slli_epi64(t, 1), m);
+	}
+	_mm_storeu_si128((__m128i *)T, t);
+}
+#else
+static void SM4_XTS_Tweaks(unsigned char T[], unsigned char tw[], size_t n)
+{
+	unsigned long long lo = 0, hi = 0, c;
+	size_t i;
+	int j;
+
+	for (j = 7; j >= 0; j--)
+	{
+		lo = (lo << 8) | T[j];
+		hi = (hi << 8) | T[8 + j];
+	}
+	for (i = 0; i < n; i++, tw += 16)
+	{
+		for (j = 0; j < 8; j++)
+		{
+			tw[j] = (unsigned char)(lo >> (8 * j));
+			tw[8 + j] = (unsigned char)(hi >> (8 * j));
+		}
+		c = 0x87 & (0 - (hi >> 63));
+		hi = (hi << 1) | (lo >> 63);
+		lo = (lo << 1) ^ c;
+	}
+	for (j = 0; j < 8; j++)
+	{
+		T[j] = (unsigned char)(lo >> (8 * j));
+		T[8 + j] = (unsigned char)(hi >> (8 * j));
+	}
+}
+#endif
+
+/************************************************************
+Function:
+         static void SM4_XTS_Unit(const SM4_XTS_CTX *ctx, unsigned char T[], const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Encrypt or decrypt one data unit whose tweak is already encrypted
+Calls:
+         SM4_XTS_Tweaks;
+         SM4_CryptBlocks
+Called By:
+         SM4_XTS_Crypt;
+         SM4_XTS_CryptSectors
+Input:
+         ctx: XTS context
+         T[]: encrypted tweak E(K2,i)
+         in[]: input data
+         len: byte length of in[], >=16
+Output:
+         out[]: output data, may be the same as in[]
+Return:null
+Others:
+************************************************************/
+static void SM4_XTS_Unit(const SM4_XTS_CTX *ctx, unsigned char T[], const unsigned char in[], unsigned char out[], size_t len)
+{
+	unsigned char tw[16 * SM4_XTS_STRIDE], buf[16 * SM4_XTS_STRIDE], tail[16];
+	size_t blocks = len / 16, r = len % 16, n, i;
+	int first, second;
+
+	//with a partial block the last full block is processed with it
+	if (r)
+		blocks--;
+
+	for (; blocks; blocks -= n, in += 16 * n, out += 16 * n)
+	{
+		n = blocks < SM4_XTS_STRIDE ? blocks : SM4_XTS_STRIDE;
+		SM4_XTS_Tweaks(T, tw, n);
+		for (i = 0; i < 16 * n; i++)
+			buf[i] = in[i] ^ tw[i];
+		SM4_CryptBlocks(&ctx->key1, buf, buf, n);
+		for (i = 0; i < 16 * n; i++)
+			out[i] = buf[i] ^ tw[i];
+	}
+
+	if (!r)
+		return;
+
+	//ciphertext stealing, decryption uses the two tweaks in reverse order
+	SM4_XTS_Tweaks(T, tw, 2);
+	first = ctx->enc ? 0 : 1;
+	second = 1 - first;
+
+	memcpy(tail, in + 16, r);
+	for (i = 0; i < 16; i++)
+		buf[i] = in[i] ^ tw[16 * first + i];
+	SM4_CryptBlocks(&ctx->key1, buf, buf, 1);
+	for (i = 0; i < 16; i++)
+		buf[i] ^= tw[16 * first + i];
+
+	memcpy(out + 16, buf, r);
+	memcpy(buf, tail, r);
+	for (i = 0; i < 16; i++)
+		buf[i] ^= tw[16 * second + i];
+	SM4_CryptBlocks(&ctx->key1, buf, buf, 1);
+	for (i = 0; i < 16; i++)
+		out[i] = buf[i] ^ tw[16 * second + i];
+}
+
+/************************************************************
+Function:
+         int SM4_XTS_Init(SM4_XTS_CTX *ctx, unsigned char key[32], int enc);
+Description:
+         Expand the data key K1 and the tweak key K2 once
+Calls:
+         SM4_SetEncKey;
+         SM4_SetDecKey
+Called By:
+         SM4_XTS_SelfCheck
+Input:
+         key[]: K1||K2, 32 bytes
+         enc: 1 encrypt, 0 decrypt
+Output:
+         ctx: XTS context
+Return:
+         1 K1 equals K2; 0 success
+Others:
+************************************************************/
+int SM4_XTS_Init(SM4_XTS_CTX *ctx, unsigned char key[32], int enc)
+{
+	if (!memcmp(key, key + 16, 16))
+		return 1;
+
+	if (enc)
+		SM4_SetEncKey(key, &ctx->key1);
+	else
+		SM4_SetDecKey(key, &ctx->key1);
+	SM4_SetEncKey(key + 16, &ctx->key2);
+	ctx->enc = enc ? 1 : 0;
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_XTS_Crypt(const SM4_XTS_CTX *ctx, const unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len);
+Description:
+         Encrypt or decrypt one data unit
+Calls:
+         SM4_CryptBlocks;
+         SM4_XTS_Unit
+Called By:
+         SM4_XTS_SelfCheck
+Input:
+         ctx: XTS context
+         iv[]: tweak value of the data unit
+         in[]: input data
+         len: byte length of in[], >=16
+Output:
+         out[]: output data, may be the same as in[]
+Return:
+         1 data unit shorter than a block; 0 success
+Others:
+************************************************************/
+int SM4_XTS_Crypt(const SM4_XTS_CTX *ctx, const unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len)
+{
+	unsigned char T[16];
+
+	if (len < 16)
+		return 1;
+
+	SM4_CryptBlocks(&ctx->key2, iv, T, 1);
+	SM4_XTS_Unit(ctx, T, in, out, len);
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_XTS_CryptSectors(const SM4_XTS_CTX *ctx, unsigned long long sector, size_t sectorsize,
+                                  const unsigned char in[], unsigned char out[], size_t sectors);
+Description:
+         Encrypt or decrypt consecutive sectors, the tweak value of a
+         sector is its number as a 128bit little-endian integer. The
+         tweaks of up to 16 sectors are encrypted in one kernel call.
+Calls:
+         SM4_CryptBlocks;
+         SM4_XTS_Unit
+Called By:
+         SM4_XTS_SelfCheck
+Input:
+         ctx: XTS context
+         sector: number of the first sector
+         sectorsize: byte length of a sector (e.g. 512 or 4096), >=16
+         in[]: input sectors
+         sectors: the number of sectors
+Output:
+         out[]: output sectors, may be the same as in[]
+Return:
+         1 sector shorter than a block; 0 success
+Others:
+************************************************************/
+int SM4_XTS_CryptSectors(const SM4_XTS_CTX *ctx, unsigned long long sector, size_t sectorsize,
+                         const unsigned char in[], unsigned char out[], size_t sectors)
+{
+	unsigned char T[16 * SM4_XTS_STRIDE];
+	unsigned long long s;
+	size_t i, n;
+	int j;
+
+	if (sectorsize < 16)
+		return 1;
+
+	for (; sectors; sectors -= n)
+	{
+		n = sectors < SM4_XTS_STRIDE ? sectors : SM4_XTS_STRIDE;
+		memset(T, 0, 16 * n);
+		for (i = 0; i < n; i++)
+		{
+			s = sector + i;
+			for (j = 0; j < 8; j++)
+				T[16 * i + j] = (unsigned char)(s >> (8 * j));
+			T[16 * i + 8] = s < sector;
+		}
+		SM4_CryptBlocks(&ctx->key2, T, T, n);
+
+		for (i = 0; i < n; i++, in += sectorsize, out += sectorsize)
+			SM4_XTS_Unit(ctx, T + 16 * i, in, out, sectorsize);
+		sector += n;
+	}
+	return 0;
+}
+
+/************************************************************
+Function:
+         int SM4_XTS_SelfCheck()
+Description:
+         Self-check with standard data
+Calls:
+         SM4_XTS_Init;
+         SM4_XTS_Crypt;
+         SM4_XTS_CryptSectors
+Called By:
+Input:
+Output:
+Return:
+         1 fail; 0 success
+Others:
+         A 48 byte unit and a 56 byte unit (ciphertext stealing), then
+         sectors around the 2^64 boundary checked against single units.
+************************************************************/
+int SM4_XTS_SelfCheck()
+{
+	unsigned char key[32] = {
+			0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+	unsigned char iv[16] = {
+			0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+	unsigned char plain[56] = {
+			0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+			0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+			0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+			0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17};
+	unsigned char cipher48[48] = {
+			0xe9, 0x53, 0x82, 0x51, 0xc7, 0x1d, 0x7b, 0x80, 0xbb, 0xe4, 0x48, 0x3f, 0xef, 0x49, 0x7b, 0xd1,
+			0xb3, 0xdb, 0x1a, 0x3e, 0x60, 0x40, 0x8c, 0x57, 0x5d, 0x63, 0xff, 0x7d, 0xb3, 0x9f, 0x83, 0x26,
+			0x27, 0xd1, 0x6c, 0x0d, 0xb6, 0xd2, 0xcf, 0xc7, 0x41, 0x31, 0x46, 0x42, 0xed, 0x88, 0x07, 0x9d};
+	unsigned char cipher56[56] = {
+			0xe9, 0x53, 0x82, 0x51, 0xc7, 0x1d, 0x7b, 0x80, 0xbb, 0xe4, 0x48, 0x3f, 0xef, 0x49, 0x7b, 0xd1,
+			0xb3, 0xdb, 0x1a, 0x3e, 0x60, 0x40, 0x8c, 0x57, 0x5d, 0x63, 0xff, 0x7d, 0xb3, 0x9f, 0x83, 0x26,
+			0x08, 0x69, 0xf9, 0xe2, 0x58, 0x5f, 0xec, 0x9f, 0x0b, 0x86, 0x3b, 0xf8, 0xfd, 0x78, 0x4b, 0x86,
+			0x27, 0xd1, 0x6c, 0x0d, 0xb6, 0xd2, 0xcf, 0xc7};
+	static unsigned char data[3 * 520], buf[3 * 520], unit[520];
+	unsigned char out[56], tweak[16];
+	unsigned long long first = 0xFFFFFFFFFFFFFFFEULL, s;
+	SM4_XTS_CTX enc, dec;
+	size_t i;
+	int j;
+
+	if (SM4_XTS_Init(&enc, key, 1) || SM4_XTS_Init(&dec, key, 0))
+		return 1;
+
+	SM4_XTS_Crypt(&enc, iv, plain, out, 48);
+	if (memcmp(out, cipher48, 48))
+		return 1;
+	SM4_XTS_Crypt(&enc, iv, plain, out, 56);
+	if (memcmp(out, cipher56, 56))
+		return 1;
+	SM4_XTS_Crypt(&dec, iv, out, out, 56);
+	if (memcmp(out, plain, 56))
+		return 1;
+
+	//520 byte sectors need ciphertext stealing as well
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (unsigned char)(i * 11 + 7);
+	SM4_XTS_CryptSectors(&enc, first, 520, data, buf, 3);
+	for (i = 0; i < 3; i++)
+	{
+		s = first + i;
+		memset(tweak, 0, 16);
+		for (j = 0; j < 8; j++)
+			tweak[j] = (unsigned char)(s >> (8 * j));
+		tweak[8] = s < first;
+		SM4_XTS_Crypt(&enc, tweak, data + 520 * i, unit, 520);
+		if (memcmp(unit, buf + 520 * i, 520))
+			return 1;
+	}
+	SM4_XTS_CryptSectors(&dec, first, 520, buf, buf, 3);
+	if (memcmp(buf, data, sizeof(data)))
+		return 1;
+
+	return 0;
+}
@@ -0,0 +1,33 @@
+/************************************************************
+FileName:
+     SM4_XTS.h
+Version:
+     SM4_XTS_V1.0
+Date:
+     Oct 16,2026
+Description:
+     This headfile provide the context and function declarations of the
+     SM4 XTS mode (IEEE P1619 construction) for sector based storage.
+Function List:
+     1. SM4_XTS_Init          //Expand the data and tweak keys
+     2. SM4_XTS_Crypt         //Encrypt/decrypt one data unit
+     3. SM4_XTS_CryptSectors  //Encrypt/decrypt consecutive sectors
+     4. SM4_XTS_SelfCheck     //Self-check
+************************************************************/
+
+#pragma once
+
+#include "SM4.h"
+
+typedef struct
+{
+     SM4_KEY key1; //data key, expanded for the direction of the context
+     SM4_KEY key2; //tweak key, always expanded for encryption
+     int enc;      //1 encrypt, 0 decrypt
+} SM4_XTS_CTX;
+
+int SM4_XTS_Init(SM4_XTS_CTX *ctx, unsigned char key[32], int enc);
+int SM4_XTS_Crypt(const SM4_XTS_CTX *ctx, const unsigned char iv[16], const unsigned char in[], unsigned char out[], size_t len);
+int SM4_XTS_CryptSectors(const SM4_XTS_CTX *ctx, unsigned long long sector, size_t sectorsize,
+                         const unsigned char in[], unsigned char out[], size_t sectors);
+int SM4_XTS_SelfCheck();
@@ -0,0 +1,138 @@
+/************************************************************
+FileName:
+     SM4_m.c
+Version:
+     SM4_m_V1.0
+Date:
+     Oct 16,2026
+Description:
+     The SM4 tool. Without arguments it runs the self-checks, otherwise
+     it encrypts or decrypts a file (or stdin) into a file (or stdout):
+         SM4 [-d] -m ctr|gcm|xts -k key [-i iv] [-s sector] [-t threads] [in [out]]
+     key and iv are hexadecimal. CTR takes a 16 byte initial counter
+     block, GCM an IV of 1..16 bytes and writes the tag after the
+     ciphertext, XTS a 32 byte key and the number of the first 4096
+     byte sector (default 0).
+************************************************************/
+
+#include "SM4.h"
+#include "SM4_CTR.h"
+#include "SM4_GCM.h"
+#include "SM4_CCM.h"
+#include "SM4_XTS.h"
+#include "SM4_CBC.h"
+#include "SM4_CMAC.h"
+#include "SM4_MT.h"
+#include "SM4_DRBG.h"
+#include "SM4_FF1.h"
+#include "SM4_KW.h"
+#include "SM4_FILE.h"
+#include "SM4_GCMSIV.h"
+#include "SM4_REKEY.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//value of a hexadecimal digit
+static int SM4_m_Nibble(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	return (c | 0x20) - 'a' + 10;
+}
+
+//decode a hexadecimal string of at most max bytes, -1 on error
+static int SM4_m_Hex(const char *s, unsigned char out[], size_t max)
+{
+	size_t n = strlen(s), i;
+	int hi, lo;
+
+	if (n % 2 || n / 2 > max)
+		return -1;
+	for (i = 0; i < n / 2; i++)
+	{
+		if (!isxdigit((unsigned char)s[2 * i]) || !isxdigit((unsigned char)s[2 * i + 1]))
+			return -1;
+		hi = SM4_m_Nibble(s[2 * i]);
+		lo = SM4_m_Nibble(s[2 * i + 1]);
+		out[i] = (unsigned char)(hi << 4 | lo);
+	}
+	return (int)(n / 2);
+}
+
+static int SM4_m_Usage(void)
+{
+	fprintf(stderr, "usage: SM4 [-d] -m ctr|gcm|xts -k key [-i iv] [-s sector] [-t threads] [in [out]]\n");
+	return 2;
+}
+
+int main(int argc, char *argv[])
+{
+	SM4_FILE_PARAM param;
+	int c, in = 0, out = 1, keylen = -1, ivlen = -1, ret;
+
+	if (argc == 1)
+		return SM4_SelfCheck() | SM4_CTR_SelfCheck() | SM4_GCM_SelfCheck() | SM4_CCM_SelfCheck() | SM4_XTS_SelfCheck() | SM4_CBC_SelfCheck() | SM4_CMAC_SelfCheck() | SM4_MT_SelfCheck() | SM4_DRBG_SelfCheck() | SM4_FF1_SelfCheck() | SM4_KW_SelfCheck() | SM4_FILE_SelfCheck() | SM4_GCMSIV_SelfCheck() | SM4_REKEY_SelfCheck();
+
+	memset(&param, 0, sizeof(param));
+	param.mode = -1;
+	param.enc = 1;
+	param.threads = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	while ((c = getopt(argc, argv, "dm:k:i:s:t:")) != -1)
+	{
+		switch (c)
+		{
+		case 'd':
+			param.enc = 0;
+			break;
+		case 'm':
+			param.mode = !strcmp(optarg, "ctr") ? SM4_FILE_CTR : !strcmp(optarg, "gcm") ? SM4_FILE_GCM : !strcmp(optarg, "xts") ? SM4_FILE_XTS : -1;
+			break;
+		case 'k':
+			keylen = SM4_m_Hex(optarg, param.key, 32);
+			break;
+		case 'i':
+			ivlen = SM4_m_Hex(optarg, param.iv, 16);
+			break;
+		case 's':
+			param.sector = strtoull(optarg, NULL, 0);
+			break;
+		case 't':
+			param.threads = atoi(optarg);
+			break;
+		default:
+			return SM4_m_Usage();
+		}
+	}
+	if (param.threads < 0)
+		param.threads = 0;
+	if (param.threads > SM4_MT_MAX_THREADS)
+		param.threads = SM4_MT_MAX_THREADS;
+	if (param.mode < 0 || argc - optind > 2 || keylen != (param.mode == SM4_FILE_XTS ? 32 : 16))
+		return SM4_m_Usage();
+	if ((param.mode == SM4_FILE_CTR && ivlen != 16) || (param.mode == SM4_FILE_GCM && ivlen < 1))
+		return SM4_m_Usage();
+	param.ivlen = ivlen > 0 ? (size_t)ivlen : 0;
+
+	if (optind < argc && strcmp(argv[optind], "-") && (in = open(argv[optind], O_RDONLY)) < 0)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	optind++;
+	if (optind < argc && strcmp(argv[optind], "-") && (out = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+
+	ret = SM4_FILE_Crypt(&param, in, out);
+	if (ret)
+		fprintf(stderr, "SM4: %s failed\n", param.enc ? "encryption" : "decryption");
+	memset(&param, 0, sizeof(param));
+	return ret;
+}
@@ -21,6 +21,35 @@ Function List:
 13.ZUC_GenKeyStream       // generate key stream
 14.ZUC_Confidentiality    // the ZUC-based confidentiality algorithm
 15.ZUC_Integrity          // the ZUC-based integrity algorithm
+16.ZUC_CtxInit            // initialise a ZUC context
+17.ZUC_CtxGenerate        // generate the next words of key stream
+18.ZUC_CtxXor             // xor the next key stream words into a buffer
+19.ZUC_SetTrace           // install the trace callback, ZUC_TRACE only
+20.ZUC_TracePrint         // trace callback printing the state, ZUC_TRACE only
+21.ZUC_EIA3Bit            // the tag of EIA3, one message bit at a time
+22.ZUC_EIA3Word           // the tag of EIA3, one message word at a time
+23.ZUC_EIA3               // the tag of EIA3, PCLMULQDQ when available
+24.ZUC_CtxLoad            // key loading into a context
+25.ZUC_GenKeyStreams      // key streams of many key/iv pairs side by side
+26.ZUC_CtxStart           // initialisation stage of a loaded context
+27.ZUC256_CtxLoad         // ZUC-256 key loading into a context
+28.ZUC256_CtxInit         // initialise a ZUC-256 context
+29.ZUC256_GenKeyStream    // generate ZUC-256 key stream
+30.ZUC256_GenKeyStreams   // ZUC-256 key streams side by side
+31.ZUC256_Confidentiality // the ZUC-256 encryption
+32.ZUC256_Integrity       // the ZUC-256 MAC of 32, 64 or 128 bits
+33.ZUC_CtxXorBytes        // xor the key stream into a bit range of bytes
+34.ZUC_EIA3Bytes          // the tag of EIA3 over a bit range of bytes
+35.ZUC_EEA3IV             // the iv of the confidentiality algorithm
+36.ZUC_EIA3IV             // the iv of the integrity algorithm
+37.ZUC_ConfidentialityBytes // the confidentiality algorithm over bytes
+38.ZUC_IntegrityBytes     // the integrity algorithm over bytes
+39.ZUC_PoolInit           // start a pool of worker threads
+40.ZUC_PoolFree           // stop a pool of worker threads
+41.ZUC_PoolRun            // run tasks on the pool and the caller
+42.ZUC_PDCP_Batch         // EEA3 and/or EIA3 of a batch of PDCP packets
+43.ZUC_EEA3EIA3Bytes      // EEA3 and EIA3 of a context pair in one pass
+44.ZUC_ConfidentialityIntegrityBytes // both algorithms over bytes in one pass
 **************************************************************************/
 
 #include "ZUC.h"
@@ -28,6 +57,75 @@ Function List:
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef ZUC_X86
+#include <immintrin.h>
+#endif
+
+//S-boxes, listed once for the byte tables and the 32bit tables of the SIMD gathers
+#define ZUC_S0_VALUES \
+	0x3e, 0x72, 0x5b, 0x47, 0xca, 0xe0, 0x00, 0x33, 0x04, 0xd1, 0x54, 0x98, 0x09, 0xb9, 0x6d, 0xcb, \
+	0x7b, 0x1b, 0xf9, 0x32, 0xaf, 0x9d, 0x6a, 0xa5, 0xb8, 0x2d, 0xfc, 0x1d, 0x08, 0x53, 0x03, 0x90, \
+	0x4d, 0x4e, 0x84, 0x99, 0xe4, 0xce, 0xd9, 0x91, 0xdd, 0xb6, 0x85, 0x48, 0x8b, 0x29, 0x6e, 0xac, \
+	0xcd, 0xc1, 0xf8, 0x1e, 0x73, 0x43, 0x69, 0xc6, 0xb5, 0xbd, 0xfd, 0x39, 0x63, 0x20, 0xd4, 0x38, \
+	0x76, 0x7d, 0xb2, 0xa7, 0xcf, 0xed, 0x57, 0xc5, 0xf3, 0x2c, 0xbb, 0x14, 0x21, 0x06, 0x55, 0x9b, \
+	0xe3, 0xef, 0x5e, 0x31, 0x4f, 0x7f, 0x5a, 0xa4, 0x0d, 0x82, 0x51, 0x49, 0x5f, 0xba, 0x58, 0x1c, \
+	0x4a, 0x16, 0xd5, 0x17, 0xa8, 0x92, 0x24, 0x1f, 0x8c, 0xff, 0xd8, 0xae, 0x2e, 0x01, 0xd3, 0xad, \
+	0x3b, 0x4b, 0xda, 0x46, 0xeb, 0xc9, 0xde, 0x9a, 0x8f, 0x87, 0xd7, 0x3a, 0x80, 0x6f, 0x2f, 0xc8, \
+	0xb1, 0xb4, 0x37, 0xf7, 0x0a, 0x22, 0x13, 0x28, 0x7c, 0xcc, 0x3c, 0x89, 0xc7, 0xc3, 0x96, 0x56, \
+	0x07, 0xbf, 0x7e, 0xf0, 0x0b, 0x2b, 0x97, 0x52, 0x35, 0x41, 0x79, 0x61, 0xa6, 0x4c, 0x10, 0xfe, \
+	0xbc, 0x26, 0x95, 0x88, 0x8a, 0xb0, 0xa3, 0xfb, 0xc0, 0x18, 0x94, 0xf2, 0xe1, 0xe5, 0xe9, 0x5d, \
+	0xd0, 0xdc, 0x11, 0x66, 0x64, 0x5c, 0xec, 0x59, 0x42, 0x75, 0x12, 0xf5, 0x74, 0x9c, 0xaa, 0x23, \
+	0x0e, 0x86, 0xab, 0xbe, 0x2a, 0x02, 0xe7, 0x67, 0xe6, 0x44, 0xa2, 0x6c, 0xc2, 0x93, 0x9f, 0xf1, \
+	0xf6, 0xfa, 0x36, 0xd2, 0x50, 0x68, 0x9e, 0x62, 0x71, 0x15, 0x3d, 0xd6, 0x40, 0xc4, 0xe2, 0x0f, \
+	0x8e, 0x83, 0x77, 0x6b, 0x25, 0x05, 0x3f, 0x0c, 0x30, 0xea, 0x70, 0xb7, 0xa1, 0xe8, 0xa9, 0x65, \
+	0x8d, 0x27, 0x1a, 0xdb, 0x81, 0xb3, 0xa0, 0xf4, 0x45, 0x7a, 0x19, 0xdf, 0xee, 0x78, 0x34, 0x60
+
+#define ZUC_S1_VALUES \
+	0x55, 0xc2, 0x63, 0x71, 0x3b, 0xc8, 0x47, 0x86, 0x9f, 0x3c, 0xda, 0x5b, 0x29, 0xaa, 0xfd, 0x77, \
+	0x8c, 0xc5, 0x94, 0x0c, 0xa6, 0x1a, 0x13, 0x00, 0xe3, 0xa8, 0x16, 0x72, 0x40, 0xf9, 0xf8, 0x42, \
+	0x44, 0x26, 0x68, 0x96, 0x81, 0xd9, 0x45, 0x3e, 0x10, 0x76, 0xc6, 0xa7, 0x8b, 0x39, 0x43, 0xe1, \
+	0x3a, 0xb5, 0x56, 0x2a, 0xc0, 0x6d, 0xb3, 0x05, 0x22, 0x66, 0xbf, 0xdc, 0x0b, 0xfa, 0x62, 0x48, \
+	0xdd, 0x20, 0x11, 0x06, 0x36, 0xc9, 0xc1, 0xcf, 0xf6, 0x27, 0x52, 0xbb, 0x69, 0xf5, 0xd4, 0x87, \
+	0x7f, 0x84, 0x4c, 0xd2, 0x9c, 0x57, 0xa4, 0xbc, 0x4f, 0x9a, 0xdf, 0xfe, 0xd6, 0x8d, 0x7a, 0xeb, \
+	0x2b, 0x53, 0xd8, 0x5c, 0xa1, 0x14, 0x17, 0xfb, 0x23, 0xd5, 0x7d, 0x30, 0x67, 0x73, 0x08, 0x09, \
+	0xee, 0xb7, 0x70, 0x3f, 0x61, 0xb2, 0x19, 0x8e, 0x4e, 0xe5, 0x4b, 0x93, 0x8f, 0x5d, 0xdb, 0xa9, \
+	0xad, 0xf1, 0xae, 0x2e, 0xcb, 0x0d, 0xfc, 0xf4, 0x2d, 0x46, 0x6e, 0x1d, 0x97, 0xe8, 0xd1, 0xe9, \
+	0x4d, 0x37, 0xa5, 0x75, 0x5e, 0x83, 0x9e, 0xab, 0x82, 0x9d, 0xb9, 0x1c, 0xe0, 0xcd, 0x49, 0x89, \
+	0x01, 0xb6, 0xbd, 0x58, 0x24, 0xa2, 0x5f, 0x38, 0x78, 0x99, 0x15, 0x90, 0x50, 0xb8, 0x95, 0xe4, \
+	0xd0, 0x91, 0xc7, 0xce, 0xed, 0x0f, 0xb4, 0x6f, 0xa0, 0xcc, 0xf0, 0x02, 0x4a, 0x79, 0xc3, 0xde, \
+	0xa3, 0xef, 0xea, 0x51, 0xe6, 0x6b, 0x18, 0xec, 0x1b, 0x2c, 0x80, 0xf7, 0x74, 0xe7, 0xff, 0x21, \
+	0x5a, 0x6a, 0x54, 0x1e, 0x41, 0x31, 0x92, 0x35, 0xc4, 0x33, 0x07, 0x0a, 0xba, 0x7e, 0x0e, 0x34, \
+	0x88, 0xb1, 0x98, 0x7c, 0xf3, 0x3d, 0x60, 0x6c, 0x7b, 0xca, 0xd3, 0x1f, 0x32, 0x65, 0x04, 0x28, \
+	0x64, 0xbe, 0x85, 0x9b, 0x2f, 0x59, 0x8a, 0xd7, 0xb0, 0x25, 0xac, 0xaf, 0x12, 0x03, 0xe2, 0xf2
+
+unsigned char ZUC_S0[256] = {ZUC_S0_VALUES};
+unsigned char ZUC_S1[256] = {ZUC_S1_VALUES};
+
+#if defined(ZUC_X86) && !defined(ZUC_TRACE)
+//multi-buffer kernels, a tracing build runs every key stream through the reference path
+#define ZUC_LANES_X86
+static const unsigned int ZUC_S0_32[256] = {ZUC_S0_VALUES};
+static const unsigned int ZUC_S1_32[256] = {ZUC_S1_VALUES};
+#endif
+
+//D value in key loading
+unsigned int ZUC_d[16] = {
+		0x44D7, 0x26BC, 0x626B, 0x135E, 0x5789, 0x35E2, 0x7135, 0x09AF,
+		0x4D78, 0x2F13, 0x6BC4, 0x1AF1, 0x5E26, 0x3C4D, 0x789A, 0x47AC};
+
+#ifdef ZUC_TRACE
+static ZUC_TRACE_FUNC ZUC_TraceFn;
+static void *ZUC_TraceArg;
+#define ZUC_TRACE_EVENT(event, LFSR_S, F_R, W) \
+	do \
+	{ \
+		if (ZUC_TraceFn) \
+			ZUC_TraceFn(ZUC_TraceArg, event, LFSR_S, F_R, W); \
+	} while (0)
+#else
+//without ZUC_TRACE the hook points compile to nothing
+#define ZUC_TRACE_EVENT(event, LFSR_S, F_R, W) ((void)0)
+#endif
 
 /************************************************************
 Function:        AddMod
@@ -96,7 +194,7 @@ unsigned int L2(unsigned int X)
 Function:       BitValue
 Description:    test if the value of M at the position i equals 0
 Calls:
-Called By:      ZUC_Integrity
+Called By:      ZUC_EIA3Bit
 Input:          M: message
                 i: the position i
 Output:
@@ -119,7 +217,7 @@ Function:       GetWord
 Description:    get a 32bit word ki from bit strings k[i],k[i+1]...,namely
                 ki=k[i]||k[i+1]||...||k[i+31]
 Calls:
-Called By:      ZUC_Integrity
+Called By:      ZUC_EIA3Bit
 Input:          k[]:
                  i: the position i
 Output:
@@ -241,7 +339,7 @@ unsigned int F(unsigned int BR_X[], unsigned int F_R[])
 Function:      ZUC_Init
 Description:   Initialisation process of ZUC
 Calls:         ZUC_LinkToS,BR,F,LFSRWithInitMode
-Called By:     ZUC_GenKeyStream
+Called By:     ZUC_CtxInit,ZUC_SelfCheck
 Input:         k:initial key
                iv:initial vector
 Output:        LFSR_S[]:the state of LFSR after initialisation:s0,s1,s2,..s15
@@ -256,15 +354,12 @@ void ZUC_Init(unsigned char k[], unsigned char iv[], unsigned int LFSR_S[], unsi
 	int i;
 
 	//loading key to the LFSR s0,s1,s2....s15
-	printf("\ninitial state of LFSR: S[0]-S[15]\n");
 	for (i = 0; i < 16; i++)
-	{
 		LFSR_S[i] = ZUC_LinkToS(k[i], ZUC_d[i], iv[i]);
-		printf("%08x     ", LFSR_S[i]);
-	}
 
 	F_R[0] = 0x00; //R1
 	F_R[1] = 0x00; //R2
+	ZUC_TRACE_EVENT(ZUC_TRACE_LOAD, LFSR_S, F_R, 0);
 
 	while (count) //32 times
 	{
@@ -272,15 +367,17 @@ void ZUC_Init(unsigned char k[], unsigned char iv[], unsigned int LFSR_S[], unsi
 		BR(LFSR_S, BR_X); //BitReconstruction
 		W = F(BR_X, F_R); //nonlinear function
 		LFSRWithInitMode(LFSR_S, W >> 1);
+		ZUC_TRACE_EVENT(ZUC_TRACE_INIT, LFSR_S, F_R, W);
 		count--;
 	}
+	ZUC_TRACE_EVENT(ZUC_TRACE_FINAL, LFSR_S, F_R, 0);
 }
 
 /************************************************************
 Function:      ZUC_work
 Description:   working stage of ZUC
 Calls:           BR,F,LFSRWithWorkMode
-Called By:       ZUC_GenKeyStream
+Called By:       ZUC_SelfCheck
 Input:           LFSR_S[]:the state of LFSR after initialisation:s0,s1,s2,..s15
                  BR_X[] : X0,X1,X2,X3
                  F_R[]:R1,R2
@@ -301,14 +398,122 @@ void ZUC_Work(unsigned int LFSR_S[], unsigned int BR_X[], unsigned int F_R[], un
 		BR(LFSR_S, BR_X);
 		pKeyStream[i] = F(BR_X, F_R) ^ BR_X[3];
 		LFSRWithWorkMode(LFSR_S);
+		ZUC_TRACE_EVENT(ZUC_TRACE_WORK, LFSR_S, F_R, pKeyStream[i]);
 		i++;
 	}
 }
 
+/*
+ * Fast core. The LFSR is kept as a ring of 16 words: after t clocks s[i]
+ * is S[(t+i)&15] and the new s[15] overwrites the old s[0] in place, so
+ * 16 clocks bring the ring back to s0..s15. Each group of 16 clocks is
+ * written out with a constant t, all ring indices are then constants and
+ * no word is moved. The feedback is summed in 64 bits, every x*2^k as a
+ * plain shift, and reduced mod 2^31-1 only once at the end: the sum is
+ * positive and below 2^55, two folds bring it into 1..2^31-1.
+ */
+
+//L1,L2 and the S-box layer of F as macros, so they are always inlined
+#define ZUC_L1(X) ((X) ^ ZUC_rotl32(X, 2) ^ ZUC_rotl32(X, 10) ^ ZUC_rotl32(X, 18) ^ ZUC_rotl32(X, 24))
+#define ZUC_L2(X) ((X) ^ ZUC_rotl32(X, 8) ^ ZUC_rotl32(X, 14) ^ ZUC_rotl32(X, 22) ^ ZUC_rotl32(X, 30))
+#define ZUC_SBOX(X) (((unsigned int)ZUC_S0[(X) >> 24] << 24) | ((unsigned int)ZUC_S1[((X) >> 16) & 0xFF] << 16) | \
+                     ((unsigned int)ZUC_S0[((X) >> 8) & 0xFF] << 8) | (unsigned int)ZUC_S1[(X) & 0xFF])
+
+//s[i] after t clocks
+#define ZUC_RS(S, t, i) (S)[((t) + (i)) & 15]
+
+//BR and F of the clock at offset t, W is the output of F and X3 the last word of BR
+#define ZUC_FSM(S, t, R1, R2, W, X3)                                                   \
+	do                                                                                 \
+	{                                                                                  \
+		unsigned int X0_, X1_, X2_, W1_, W2_, U_, V_;                                  \
+		X0_ = ((ZUC_RS(S, t, 15) & 0x7fff8000) << 1) | (ZUC_RS(S, t, 14) & 0x0000ffff); \
+		X1_ = (ZUC_RS(S, t, 11) << 16) | (ZUC_RS(S, t, 9) >> 15);                       \
+		X2_ = (ZUC_RS(S, t, 7) << 16) | (ZUC_RS(S, t, 5) >> 15);                        \
+		X3 = (ZUC_RS(S, t, 2) << 16) | (ZUC_RS(S, t, 0) >> 15);                         \
+		W = (X0_ ^ R1) + R2;                                                           \
+		W1_ = R1 + X1_;                                                                \
+		W2_ = R2 ^ X2_;                                                                \
+		U_ = (W1_ << 16) | (W2_ >> 16);                                                \
+		V_ = (W2_ << 16) | (W1_ >> 16);                                                \
+		U_ = ZUC_L1(U_);                                                               \
+		V_ = ZUC_L2(V_);                                                               \
+		R1 = ZUC_SBOX(U_);                                                             \
+		R2 = ZUC_SBOX(V_);                                                             \
+	} while (0)
+
+//LFSR feedback of the clock at offset t plus u, reduced once
+#define ZUC_FEEDBACK(S, t, u)                                                   \
+	do                                                                          \
+	{                                                                           \
+		unsigned long long f_ = (unsigned long long)ZUC_RS(S, t, 0) +            \
+		                        ((unsigned long long)ZUC_RS(S, t, 0) << 8) +     \
+		                        ((unsigned long long)ZUC_RS(S, t, 4) << 20) +    \
+		                        ((unsigned long long)ZUC_RS(S, t, 10) << 21) +   \
+		                        ((unsigned long long)ZUC_RS(S, t, 13) << 17) +   \
+		                        ((unsigned long long)ZUC_RS(S, t, 15) << 15) + (u); \
+		f_ = (f_ & 0x7fffffff) + (f_ >> 31);                                    \
+		f_ = (f_ & 0x7fffffff) + (f_ >> 31);                                    \
+		ZUC_RS(S, t, 0) = (unsigned int)f_;                                     \
+	} while (0)
+
+#define ZUC_INIT_CLOCK(t)             \
+	ZUC_FSM(S, t, R1, R2, W, X3);     \
+	ZUC_FEEDBACK(S, t, W >> 1);
+
+#define ZUC_WORK_CLOCK(t)             \
+	ZUC_FSM(S, t, R1, R2, W, X3);     \
+	z[t] = W ^ X3;                    \
+	ZUC_FEEDBACK(S, t, 0);
+
+#define ZUC_UNROLL16(CLOCK)                                                 \
+	CLOCK(0) CLOCK(1) CLOCK(2) CLOCK(3) CLOCK(4) CLOCK(5) CLOCK(6) CLOCK(7) \
+	CLOCK(8) CLOCK(9) CLOCK(10) CLOCK(11) CLOCK(12) CLOCK(13) CLOCK(14) CLOCK(15)
+
+#ifndef ZUC_TRACE
+//16 clocks of the initialisation stage
+static void ZUC_Init16(unsigned int S[16], unsigned int F_R[2])
+{
+	unsigned int R1 = F_R[0], R2 = F_R[1], W, X3;
+
+	ZUC_UNROLL16(ZUC_INIT_CLOCK)
+	(void)X3;
+	F_R[0] = R1;
+	F_R[1] = R2;
+}
+
+//16 clocks of the working stage, 16 words of key stream
+static void ZUC_Work16(unsigned int S[16], unsigned int F_R[2], unsigned int z[16])
+{
+	unsigned int R1 = F_R[0], R2 = F_R[1], W, X3;
+
+	ZUC_UNROLL16(ZUC_WORK_CLOCK)
+	F_R[0] = R1;
+	F_R[1] = R2;
+}
+
+//n<16 clocks of the working stage, the ring is then turned back to s0..s15
+static void ZUC_WorkTail(unsigned int S[16], unsigned int F_R[2], unsigned int z[], int n)
+{
+	unsigned int R1 = F_R[0], R2 = F_R[1], W, X3, T[16];
+	int t;
+
+	for (t = 0; t < n; t++)
+	{
+		ZUC_WORK_CLOCK(t)
+	}
+	for (t = 0; t < 16; t++)
+		T[t] = ZUC_RS(S, n, t);
+	memcpy(S, T, sizeof(T));
+	F_R[0] = R1;
+	F_R[1] = R2;
+}
+#endif
+
 /****************************************************************
 Function:          ZUC_GenKeyStream
 Description:       generate key stream
-Calls:             ZUC_Init,ZUC_Work
+Calls:             ZUC_CtxInit,ZUC_CtxGenerate
 Called By:         ZUC_SelfCheck
 Input:             k[]             //initial key,128bit
                    iv[]             //initial iv,128bit
@@ -319,46 +524,581 @@ Others:
 ****************************************************************/
 void ZUC_GenKeyStream(unsigned char k[], unsigned char iv[], unsigned int KeyStream[], int KeyStreamLen)
 {
+	ZUC_CTX ctx;
+
+	ZUC_CtxInit(&ctx, k, iv);
+	ZUC_CtxGenerate(&ctx, KeyStream, KeyStreamLen);
+	memset(&ctx, 0, sizeof(ctx));
+}
 
-	unsigned int LFSR_S[16]; //LFSR state s0,s1,s2,...s15
-	unsigned int BR_X[4];		 //Bit Reconstruction X0,X1,X2,X3
-	unsigned int F_R[2];		 //R1,R2,variables of nonlinear function F
+/****************************************************************
+Function:          ZUC_CtxLoad
+Description:       key loading into a context
+Calls:
+Called By:         ZUC_CtxInit,ZUC_GenKeyStreams,ZUC_RunJobs,ZUC_PDCP_Run
+Input:             k[]             //initial key,128bit
+                   iv[]            //initial iv,128bit
+Output:            ctx             //LFSR s0..s15 loaded, R1=R2=0
+Return:            null
+Others:
+****************************************************************/
+void ZUC_CtxLoad(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[])
+{
 	int i;
 
-	//Initialisation
-	ZUC_Init(k, iv, LFSR_S, BR_X, F_R);
-	printf("\nstate of LFSR after executing initialization: S[0]-S[15]\n");
 	for (i = 0; i < 16; i++)
-		printf("%08x     ", LFSR_S[i]);
-	printf("\ninternal state of Finite State Machine:\n");
-	printf("R1=%08x\n", F_R[0]);
-	printf("R2=%08x\n", F_R[1]);
+		ctx->LFSR_S[i] = ZUC_LinkToS(k[i], ZUC_d[i], iv[i]);
+	ctx->F_R[0] = 0x00;
+	ctx->F_R[1] = 0x00;
+}
+
+/****************************************************************
+Function:          ZUC_CtxStart
+Description:       run the initialisation stage of a loaded context
+Calls:             ZUC_Init16,ZUC_WorkTail
+Called By:         ZUC_CtxInit,ZUC256_CtxInit,ZUC_RunJobs,
+                   ZUC_CtxStartMany
+Input:             ctx             //context just after key loading
+Output:            ctx             //ZUC context
+Return:            null
+Others:            the first output of the working stage, which is
+                   discarded, is already done here; with ZUC_TRACE the
+                   reference BR,F,LFSRWithInitMode are run instead of
+                   the ring and every clock is traced as in ZUC_Init
+****************************************************************/
+void ZUC_CtxStart(ZUC_CTX *ctx)
+{
+#ifdef ZUC_TRACE
+	unsigned int BR_X[4], W;
+	int i;
+
+	ZUC_TRACE_EVENT(ZUC_TRACE_LOAD, ctx->LFSR_S, ctx->F_R, 0);
+	for (i = 0; i < 32; i++)
+	{
+		BR(ctx->LFSR_S, BR_X);
+		W = F(BR_X, ctx->F_R);
+		LFSRWithInitMode(ctx->LFSR_S, W >> 1);
+		ZUC_TRACE_EVENT(ZUC_TRACE_INIT, ctx->LFSR_S, ctx->F_R, W);
+	}
+	ZUC_TRACE_EVENT(ZUC_TRACE_FINAL, ctx->LFSR_S, ctx->F_R, 0);
+	BR(ctx->LFSR_S, BR_X);
+	F(BR_X, ctx->F_R);
+	LFSRWithWorkMode(ctx->LFSR_S);
+#else
+	unsigned int z;
 
-	//Working
-	ZUC_Work(LFSR_S, BR_X, F_R, KeyStream, KeyStreamLen);
+	ZUC_Init16(ctx->LFSR_S, ctx->F_R);
+	ZUC_Init16(ctx->LFSR_S, ctx->F_R);
+	ZUC_WorkTail(ctx->LFSR_S, ctx->F_R, &z, 1);
+#endif
 }
 
 /****************************************************************
-Function:         ZUC_Confidentiality
-Description:      the ZUC-based confidentiality algorithm
-Calls:            ZUC_GenKeyStream
-Called By:        ZUC_SelfCheck
-Input:            CK[]             //initial key,128bit,used to gain the key of ZUC KeyStream generation algorithm
-                  COUNT            //128bit
-                  BEARER           //5bit,bearing layer identification,
+Function:          ZUC_CtxInit
+Description:       initialise a ZUC context, the context then produces
+                   the key stream word by word
+Calls:             ZUC_CtxLoad,ZUC_CtxStart
+Called By:         ZUC_Confidentiality,ZUC_Integrity,ZUC_GenKeyStream,
+                   ZUC_SelfCheck
+Input:             k[]             //initial key,128bit
+                   iv[]            //initial iv,128bit
+Output:            ctx             //ZUC context
+Return:            null
+Others:
+****************************************************************/
+void ZUC_CtxInit(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[])
+{
+	ZUC_CtxLoad(ctx, k, iv);
+	ZUC_CtxStart(ctx);
+}
+
+/****************************************************************
+Function:          ZUC_CtxGenerate
+Description:       generate the next words of key stream
+Calls:             ZUC_Work16,ZUC_WorkTail
+Called By:         ZUC_CtxXor,ZUC_EIA3Bit,ZUC_EIA3Word,ZUC_EIA3Clmul,
+                   ZUC_GenKeyStream,ZUC_GenKeyStreams,ZUC_SelfCheck
+Input:             ctx             //ZUC context
+                   KeyStreamLen    //the number of 32bit words to generate
+Output:            ctx             //ZUC context
+                   KeyStream[]     //key stream
+Return:            null
+Others:            consecutive calls continue the same key stream; with
+                   ZUC_TRACE the reference BR,F,LFSRWithWorkMode are run
+                   so that every clock reaches the trace hook
+****************************************************************/
+void ZUC_CtxGenerate(ZUC_CTX *ctx, unsigned int KeyStream[], int KeyStreamLen)
+{
+#ifdef ZUC_TRACE
+	unsigned int BR_X[4];
+	int i;
+
+	for (i = 0; i < KeyStreamLen; i++)
+	{
+		BR(ctx->LFSR_S, BR_X);
+		KeyStream[i] = F(BR_X, ctx->F_R) ^ BR_X[3];
+		LFSRWithWorkMode(ctx->LFSR_S);
+		ZUC_TRACE_EVENT(ZUC_TRACE_WORK, ctx->LFSR_S, ctx->F_R, KeyStream[i]);
+	}
+#else
+	for (; KeyStreamLen >= 16; KeyStreamLen -= 16, KeyStream += 16)
+		ZUC_Work16(ctx->LFSR_S, ctx->F_R, KeyStream);
+	if (KeyStreamLen > 0)
+		ZUC_WorkTail(ctx->LFSR_S, ctx->F_R, KeyStream, KeyStreamLen);
+#endif
+}
+
+/****************************************************************
+Function:          ZUC_CtxXor
+Description:       OBS=IBS^key stream for the next len words
+Calls:             ZUC_CtxGenerate
+Called By:         ZUC_Confidentiality
+Input:             ctx             //ZUC context
+                   IBS[]           //input words
+                   len             //the number of 32bit words
+Output:            ctx             //ZUC context
+                   OBS[]           //output words, may be the same as IBS
+Return:            null
+Others:            the key stream is made ZUC_CHUNK words at a time on
+                   the stack
+****************************************************************/
+void ZUC_CtxXor(ZUC_CTX *ctx, const unsigned int IBS[], unsigned int OBS[], int len)
+{
+	unsigned int k[ZUC_CHUNK];
+	int i, n;
+
+	for (; len > 0; len -= n, IBS += n, OBS += n)
+	{
+		n = len < ZUC_CHUNK ? len : ZUC_CHUNK;
+		ZUC_CtxGenerate(ctx, k, n);
+		for (i = 0; i < n; i++)
+			OBS[i] = IBS[i] ^ k[i];
+	}
+	memset(k, 0, sizeof(k));
+}
+
+/****************************************************************
+Function:          ZUC_CtxXorBytes
+Description:       xor the key stream into a bit range of a byte buffer
+Calls:             ZUC_CtxGenerate
+Called By:         ZUC_ConfidentialityBytes,ZUC_PDCP_Run
+Input:             ctx             //ZUC context
+                   in[]            //input bytes, bit 0 is the most significant bit of in[0]
+                   offset          //the bit where the range starts
+                   LENGTH          //the bit length of the range
+Output:            ctx             //ZUC context
+                   out[]           //output bytes, may be the same as in
+Return:            null
+Others:            bit offset+j takes key stream bit j; (LENGTH+31)/32
+                   words of key stream are used. Bits outside the range
+                   in the first and last byte are copied from in, so in
+                   place they are left as they were.
+****************************************************************/
+void ZUC_CtxXorBytes(ZUC_CTX *ctx, const unsigned char in[], unsigned char out[], int offset, int LENGTH)
+{
+	unsigned int k[ZUC_CHUNK], cur, prev = 0, x;
+	int s = offset & 7, L = (LENGTH + 31) / 32, bits = s + LENGTH;
+	int nb = (bits + 7) / 8, g, c, m, i;
+
+	in += offset >> 3;
+	out += offset >> 3;
+	//group g of 4 bytes takes the key stream shifted right by s bits
+	for (g = 0; 4 * g < nb; g++, in += 4, out += 4)
+	{
+		if (g % ZUC_CHUNK == 0 && g < L)
+		{
+			c = L - g < ZUC_CHUNK ? L - g : ZUC_CHUNK;
+			ZUC_CtxGenerate(ctx, k, c);
+		}
+		cur = g < L ? k[g % ZUC_CHUNK] : 0;
+		x = s ? (prev << (32 - s)) | (cur >> s) : cur;
+		prev = cur;
+		if (bits - 32 * g < 32)
+			x &= 0xffffffff << (32 - (bits - 32 * g));
+
+		m = nb - 4 * g;
+		if (m >= 4)
+		{
+			x ^= ((unsigned int)in[0] << 24) | ((unsigned int)in[1] << 16) | ((unsigned int)in[2] << 8) | in[3];
+			out[0] = (unsigned char)(x >> 24);
+			out[1] = (unsigned char)(x >> 16);
+			out[2] = (unsigned char)(x >> 8);
+			out[3] = (unsigned char)x;
+		}
+		else
+			for (i = 0; i < m; i++)
+				out[i] = in[i] ^ (unsigned char)(x >> (24 - 8 * i));
+	}
+	memset(k, 0, sizeof(k));
+	prev = cur = x = 0;
+}
+
+#ifdef ZUC_LANES_X86
+
+/*
+ * Multi-buffer kernels: lane j of every vector belongs to key stream j.
+ * The LFSR is a ring of 16 vectors as in the scalar core, the S-boxes are
+ * gathered from 32bit copies of the tables and the feedback is reduced
+ * after each addition, there is no 64bit lane to defer it.
+ */
+
+#define ZUC_ROTL_AVX2(x, k) _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - (k)))
+//x*2^k mod 2^31-1
+#define ZUC_POWM_AVX2(x, k) _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 31 - (k))), p)
+//a+b mod 2^31-1
+#define ZUC_ADDM_AVX2(a, b) (c = _mm256_add_epi32(a, b), _mm256_add_epi32(_mm256_and_si256(c, p), _mm256_srli_epi32(c, 31)))
+
+__attribute__((target("avx2"))) static inline __m256i ZUC_Sbox_AVX2(__m256i x)
+{
+	const __m256i ff = _mm256_set1_epi32(0xff);
+	__m256i b3, b2, b1, b0;
+
+	b3 = _mm256_i32gather_epi32((const int *)ZUC_S0_32, _mm256_srli_epi32(x, 24), 4);
+	b2 = _mm256_i32gather_epi32((const int *)ZUC_S1_32, _mm256_and_si256(_mm256_srli_epi32(x, 16), ff), 4);
+	b1 = _mm256_i32gather_epi32((const int *)ZUC_S0_32, _mm256_and_si256(_mm256_srli_epi32(x, 8), ff), 4);
+	b0 = _mm256_i32gather_epi32((const int *)ZUC_S1_32, _mm256_and_si256(x, ff), 4);
+	return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(b3, 24), _mm256_slli_epi32(b2, 16)),
+	                       _mm256_or_si256(_mm256_slli_epi32(b1, 8), b0));
+}
+
+//one clock at ring offset t, returns the key stream word; init adds W>>1 to the feedback
+__attribute__((target("avx2"))) static inline __m256i ZUC_Clock_AVX2(__m256i S[], int t, __m256i *R1, __m256i *R2, int init)
+{
+	const __m256i p = _mm256_set1_epi32(0x7fffffff);
+	__m256i X0, X1, X2, X3, W, W1, W2, U, V, f, c;
+
+	X0 = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(ZUC_RS(S, t, 15), _mm256_set1_epi32(0x7fff8000)), 1),
+	                     _mm256_and_si256(ZUC_RS(S, t, 14), _mm256_set1_epi32(0xffff)));
+	X1 = _mm256_or_si256(_mm256_slli_epi32(ZUC_RS(S, t, 11), 16), _mm256_srli_epi32(ZUC_RS(S, t, 9), 15));
+	X2 = _mm256_or_si256(_mm256_slli_epi32(ZUC_RS(S, t, 7), 16), _mm256_srli_epi32(ZUC_RS(S, t, 5), 15));
+	X3 = _mm256_or_si256(_mm256_slli_epi32(ZUC_RS(S, t, 2), 16), _mm256_srli_epi32(ZUC_RS(S, t, 0), 15));
+	W = _mm256_add_epi32(_mm256_xor_si256(X0, *R1), *R2);
+	W1 = _mm256_add_epi32(*R1, X1);
+	W2 = _mm256_xor_si256(*R2, X2);
+	U = _mm256_or_si256(_mm256_slli_epi32(W1, 16), _mm256_srli_epi32(W2, 16));
+	V = _mm256_or_si256(_mm256_slli_epi32(W2, 16), _mm256_srli_epi32(W1, 16));
+	U = _mm256_xor_si256(_mm256_xor_si256(U, ZUC_ROTL_AVX2(U, 2)), _mm256_xor_si256(ZUC_ROTL_AVX2(U, 10), _mm256_xor_si256(ZUC_ROTL_AVX2(U, 18), ZUC_ROTL_AVX2(U, 24))));
+	V = _mm256_xor_si256(_mm256_xor_si256(V, ZUC_ROTL_AVX2(V, 8)), _mm256_xor_si256(ZUC_ROTL_AVX2(V, 14), _mm256_xor_si256(ZUC_ROTL_AVX2(V, 22), ZUC_ROTL_AVX2(V, 30))));
+	*R1 = ZUC_Sbox_AVX2(U);
+	*R2 = ZUC_Sbox_AVX2(V);
+
+	f = ZUC_ADDM_AVX2(ZUC_RS(S, t, 0), ZUC_POWM_AVX2(ZUC_RS(S, t, 0), 8));
+	f = ZUC_ADDM_AVX2(f, ZUC_POWM_AVX2(ZUC_RS(S, t, 4), 20));
+	f = ZUC_ADDM_AVX2(f, ZUC_POWM_AVX2(ZUC_RS(S, t, 10), 21));
+	f = ZUC_ADDM_AVX2(f, ZUC_POWM_AVX2(ZUC_RS(S, t, 13), 17));
+	f = ZUC_ADDM_AVX2(f, ZUC_POWM_AVX2(ZUC_RS(S, t, 15), 15));
+	if (init)
+		f = ZUC_ADDM_AVX2(f, _mm256_srli_epi32(W, 1));
+	ZUC_RS(S, t, 0) = f;
+	return _mm256_xor_si256(W, X3);
+}
+
+/****************************************************************
+Function:          ZUC_Lanes8_AVX2
+Description:       initialise 8 loaded contexts and generate the same
+                   number of key stream words for each of them
+Calls:             ZUC_Clock_AVX2
+Called By:         ZUC_RunJobs,ZUC_CtxStartMany
+Input:             ctx[]           //8 contexts just after key loading
+                   z[]             //where the key stream of each context goes
+                   words           //the number of 32bit words per context
+Output:            ctx[]           //contexts ready for ZUC_CtxGenerate
+                   z[]             //key streams
+Return:            null
+Others:            the key stream leaves the vectors 16 words at a time
+****************************************************************/
+__attribute__((target("avx2"))) static void ZUC_Lanes8_AVX2(ZUC_CTX ctx[], unsigned int *const z[], int words)
+{
+	unsigned int buf[16][8];
+	__m256i S[16], R1, R2;
+	int i, j, n, t, w;
+
+	for (i = 0; i < 16; i++)
+	{
+		for (j = 0; j < 8; j++)
+			buf[i][j] = ctx[j].LFSR_S[i];
+		S[i] = _mm256_loadu_si256((const __m256i *)buf[i]);
+	}
+	R1 = R2 = _mm256_setzero_si256();
+
+	//32 clocks of the initialisation stage and the discarded first word
+	for (t = 0; t < 32; t++)
+		ZUC_Clock_AVX2(S, t, &R1, &R2, 1);
+	ZUC_Clock_AVX2(S, 0, &R1, &R2, 0);
+	t = 1;
+
+	for (w = 0; w < words; w += n)
+	{
+		n = words - w < 16 ? words - w : 16;
+		for (i = 0; i < n; i++, t++)
+			_mm256_storeu_si256((__m256i *)buf[i], ZUC_Clock_AVX2(S, t, &R1, &R2, 0));
+		for (j = 0; j < 8; j++)
+			for (i = 0; i < n; i++)
+				z[j][w + i] = buf[i][j];
+	}
+
+	//the ring back to s0..s15 of every context
+	for (i = 0; i < 16; i++)
+	{
+		_mm256_storeu_si256((__m256i *)buf[i], ZUC_RS(S, t, i));
+		for (j = 0; j < 8; j++)
+			ctx[j].LFSR_S[i] = buf[i][j];
+	}
+	_mm256_storeu_si256((__m256i *)buf[0], R1);
+	_mm256_storeu_si256((__m256i *)buf[1], R2);
+	for (j = 0; j < 8; j++)
+	{
+		ctx[j].F_R[0] = buf[0][j];
+		ctx[j].F_R[1] = buf[1][j];
+	}
+	memset(buf, 0, sizeof(buf));
+}
+
+#define ZUC_POWM_AVX512(x, k) _mm512_and_si512(_mm512_or_si512(_mm512_slli_epi32(x, k), _mm512_srli_epi32(x, 31 - (k))), p)
+#define ZUC_ADDM_AVX512(a, b) (c = _mm512_add_epi32(a, b), _mm512_add_epi32(_mm512_and_si512(c, p), _mm512_srli_epi32(c, 31)))
+
+__attribute__((target("avx512f"))) static inline __m512i ZUC_Sbox_AVX512(__m512i x)
+{
+	const __m512i ff = _mm512_set1_epi32(0xff);
+	__m512i b3, b2, b1, b0;
+
+	b3 = _mm512_i32gather_epi32(_mm512_srli_epi32(x, 24), ZUC_S0_32, 4);
+	b2 = _mm512_i32gather_epi32(_mm512_and_si512(_mm512_srli_epi32(x, 16), ff), ZUC_S1_32, 4);
+	b1 = _mm512_i32gather_epi32(_mm512_and_si512(_mm512_srli_epi32(x, 8), ff), ZUC_S0_32, 4);
+	b0 = _mm512_i32gather_epi32(_mm512_and_si512(x, ff), ZUC_S1_32, 4);
+	return _mm512_or_si512(_mm512_or_si512(_mm512_slli_epi32(b3, 24), _mm512_slli_epi32(b2, 16)),
+	                       _mm512_or_si512(_mm512_slli_epi32(b1, 8), b0));
+}
+
+__attribute__((target("avx512f"))) static inline __m512i ZUC_Clock_AVX512(__m512i S[], int t, __m512i *R1, __m512i *R2, int init)
+{
+	const __m512i p = _mm512_set1_epi32(0x7fffffff);
+	__m512i X0, X1, X2, X3, W, W1, W2, U, V, f, c;
+
+	X0 = _mm512_or_si512(_mm512_slli_epi32(_mm512_and_si512(ZUC_RS(S, t, 15), _mm512_set1_epi32(0x7fff8000)), 1),
+	                     _mm512_and_si512(ZUC_RS(S, t, 14), _mm512_set1_epi32(0xffff)));
+	X1 = _mm512_or_si512(_mm512_slli_epi32(ZUC_RS(S, t, 11), 16), _mm512_srli_epi32(ZUC_RS(S, t, 9), 15));
+	X2 = _mm512_or_si512(_mm512_slli_epi32(ZUC_RS(S, t, 7), 16), _mm512_srli_epi32(ZUC_RS(S, t, 5), 15));
+	X3 = _mm512_or_si512(_mm512_slli_epi32(ZUC_RS(S, t, 2), 16), _mm512_srli_epi32(ZUC_RS(S, t, 0), 15));
+	W = _mm512_add_epi32(_mm512_xor_si512(X0, *R1), *R2);
+	W1 = _mm512_add_epi32(*R1, X1);
+	W2 = _mm512_xor_si512(*R2, X2);
+	U = _mm512_or_si512(_mm512_slli_epi32(W1, 16), _mm512_srli_epi32(W2, 16));
+	V = _mm512_or_si512(_mm512_slli_epi32(W2, 16), _mm512_srli_epi32(W1, 16));
+	U = _mm512_ternarylogic_epi32(_mm512_ternarylogic_epi32(U, _mm512_rol_epi32(U, 2), _mm512_rol_epi32(U, 10), 0x96),
+	                              _mm512_rol_epi32(U, 18), _mm512_rol_epi32(U, 24), 0x96);
+	V = _mm512_ternarylogic_epi32(_mm512_ternarylogic_epi32(V, _mm512_rol_epi32(V, 8), _mm512_rol_epi32(V, 14), 0x96),
+	                              _mm512_rol_epi32(V, 22), _mm512_rol_epi32(V, 30), 0x96);
+	*R1 = ZUC_Sbox_AVX512(U);
+	*R2 = ZUC_Sbox_AVX512(V);
+
+	f = ZUC_ADDM_AVX512(ZUC_RS(S, t, 0), ZUC_POWM_AVX512(ZUC_RS(S, t, 0), 8));
+	f = ZUC_ADDM_AVX512(f, ZUC_POWM_AVX512(ZUC_RS(S, t, 4), 20));
+	f = ZUC_ADDM_AVX512(f, ZUC_POWM_AVX512(ZUC_RS(S, t, 10), 21));
+	f = ZUC_ADDM_AVX512(f, ZUC_POWM_AVX512(ZUC_RS(S, t, 13), 17));
+	f = ZUC_ADDM_AVX512(f, ZUC_POWM_AVX512(ZUC_RS(S, t, 15), 15));
+	if (init)
+		f = ZUC_ADDM_AVX512(f, _mm512_srli_epi32(W, 1));
+	ZUC_RS(S, t, 0) = f;
+	return _mm512_xor_si512(W, X3);
+}
+
+//as ZUC_Lanes8_AVX2 with 16 contexts
+__attribute__((target("avx512f"))) static void ZUC_Lanes16_AVX512(ZUC_CTX ctx[], unsigned int *const z[], int words)
+{
+	unsigned int buf[16][16];
+	__m512i S[16], R1, R2;
+	int i, j, n, t, w;
+
+	for (i = 0; i < 16; i++)
+	{
+		for (j = 0; j < 16; j++)
+			buf[i][j] = ctx[j].LFSR_S[i];
+		S[i] = _mm512_loadu_si512(buf[i]);
+	}
+	R1 = R2 = _mm512_setzero_si512();
+
+	for (t = 0; t < 32; t++)
+		ZUC_Clock_AVX512(S, t, &R1, &R2, 1);
+	ZUC_Clock_AVX512(S, 0, &R1, &R2, 0);
+	t = 1;
+
+	for (w = 0; w < words; w += n)
+	{
+		n = words - w < 16 ? words - w : 16;
+		for (i = 0; i < n; i++, t++)
+			_mm512_storeu_si512(buf[i], ZUC_Clock_AVX512(S, t, &R1, &R2, 0));
+		for (j = 0; j < 16; j++)
+			for (i = 0; i < n; i++)
+				z[j][w + i] = buf[i][j];
+	}
+
+	for (i = 0; i < 16; i++)
+	{
+		_mm512_storeu_si512(buf[i], ZUC_RS(S, t, i));
+		for (j = 0; j < 16; j++)
+			ctx[j].LFSR_S[i] = buf[i][j];
+	}
+	_mm512_storeu_si512(buf[0], R1);
+	_mm512_storeu_si512(buf[1], R2);
+	for (j = 0; j < 16; j++)
+	{
+		ctx[j].F_R[0] = buf[0][j];
+		ctx[j].F_R[1] = buf[1][j];
+	}
+	memset(buf, 0, sizeof(buf));
+}
+
+#define ZUC_HAS_AVX2() __builtin_cpu_supports("avx2")
+#define ZUC_HAS_AVX512() __builtin_cpu_supports("avx512f")
+
+#endif
+
+/****************************************************************
+Function:          ZUC_RunJobs
+Description:       generate the key streams of many key/iv pairs, 16
+                   (AVX-512) or 8 (AVX2) of them side by side
+Calls:             ZUC_Lanes16_AVX512,ZUC_Lanes8_AVX2,ZUC_CtxStart,
+                   ZUC_CtxGenerate
+Called By:         ZUC_GenKeyStreams,ZUC256_GenKeyStreams
+Input:             job[]           //key, iv, output and length of every key stream
+                   count           //the number of jobs
+                   load            //key loading of the variant
+Output:            job[].KeyStream //key streams
+Return:            null
+Others:            a group of jobs runs in the lanes for as many words as
+                   its shortest job, longer jobs go on from the saved
+                   context on the scalar core. A last group of at least
+                   half the lanes is padded with copies of its first job,
+                   smaller ones are done one by one.
+****************************************************************/
+static void ZUC_RunJobs(const ZUC_JOB job[], int count, void (*load)(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[]))
+{
+	ZUC_CTX ctx[16];
+	int lanes = 0, n, i;
+#ifdef ZUC_LANES_X86
+	unsigned int *z[16];
+	int m, j;
+
+	if (ZUC_HAS_AVX512())
+		lanes = 16;
+	else if (ZUC_HAS_AVX2())
+		lanes = 8;
+#endif
+
+	for (i = 0; i < count; i += n)
+	{
+		n = count - i < lanes ? count - i : lanes;
+#ifdef ZUC_LANES_X86
+		if (lanes && n >= lanes / 2)
+		{
+			m = job[i].KeyStreamLen;
+			for (j = 0; j < lanes; j++)
+			{
+				const ZUC_JOB *jb = &job[i + (j < n ? j : 0)];
+
+				load(&ctx[j], jb->k, jb->iv);
+				z[j] = jb->KeyStream;
+				if (jb->KeyStreamLen < m)
+					m = jb->KeyStreamLen;
+			}
+			if (lanes == 16)
+				ZUC_Lanes16_AVX512(ctx, z, m);
+			else
+				ZUC_Lanes8_AVX2(ctx, z, m);
+			for (j = 0; j < n; j++)
+				if (job[i + j].KeyStreamLen > m)
+					ZUC_CtxGenerate(&ctx[j], z[j] + m, job[i + j].KeyStreamLen - m);
+			continue;
+		}
+#endif
+		load(ctx, job[i].k, job[i].iv);
+		ZUC_CtxStart(ctx);
+		ZUC_CtxGenerate(ctx, job[i].KeyStream, job[i].KeyStreamLen);
+		n = 1;
+	}
+	memset(ctx, 0, sizeof(ctx));
+}
+
+/****************************************************************
+Function:          ZUC_GenKeyStreams
+Description:       generate the key streams of many key/iv pairs, 16
+                   (AVX-512) or 8 (AVX2) of them side by side
+Calls:             ZUC_RunJobs
+Called By:         ZUC_SelfCheck
+Input:             job[]           //key, iv, output and length of every key stream
+                   count           //the number of jobs
+Output:            job[].KeyStream //key streams
+Return:            null
+Others:
+****************************************************************/
+void ZUC_GenKeyStreams(const ZUC_JOB job[], int count)
+{
+	ZUC_RunJobs(job, count, ZUC_CtxLoad);
+}
+
+/****************************************************************
+Function:          ZUC_CtxStartMany
+Description:       run the initialisation stage of many loaded contexts,
+                   16 (AVX-512) or 8 (AVX2) of them side by side
+Calls:             ZUC_Lanes16_AVX512,ZUC_Lanes8_AVX2,ZUC_CtxStart
+Called By:         ZUC_PDCP_Run
+Input:             ctx[]           //contexts just after key loading
+                   count           //the number of contexts
+Output:            ctx[]           //contexts ready for ZUC_CtxGenerate
+Return:            null
+Others:            groups are formed as in ZUC_RunJobs
+****************************************************************/
+static void ZUC_CtxStartMany(ZUC_CTX ctx[], int count)
+{
+	int lanes = 0, n, i;
+#ifdef ZUC_LANES_X86
+	ZUC_CTX lane[16];
+	int j;
+
+	if (ZUC_HAS_AVX512())
+		lanes = 16;
+	else if (ZUC_HAS_AVX2())
+		lanes = 8;
+#endif
+
+	for (i = 0; i < count; i += n)
+	{
+		n = count - i < lanes ? count - i : lanes;
+#ifdef ZUC_LANES_X86
+		if (lanes && n >= lanes / 2)
+		{
+			for (j = 0; j < lanes; j++)
+				lane[j] = ctx[i + (j < n ? j : 0)];
+			if (lanes == 16)
+				ZUC_Lanes16_AVX512(lane, NULL, 0);
+			else
+				ZUC_Lanes8_AVX2(lane, NULL, 0);
+			memcpy(ctx + i, lane, n * sizeof(ZUC_CTX));
+			memset(lane, 0, sizeof(lane));
+			continue;
+		}
+#endif
+		ZUC_CtxStart(ctx + i);
+		n = 1;
+	}
+}
+
+/****************************************************************
+Function:         ZUC_EEA3IV
+Description:      the iv of the confidentiality algorithm
+Calls:
+Called By:        ZUC_Confidentiality,ZUC_ConfidentialityBytes,ZUC_PDCP_Run,
+                  ZUC_ConfidentialityIntegrityBytes
+Input:            COUNT            //32bit counter
+                  BEARER           //5bit,bearing layer identification
                   DIRECTION        //1bit
-                  IBS[]            //input bit stream,
-                  LENGTH           //the bit length of IBS
-Output:           OBS[]            //output bit stream,
+Output:           iv[]             //initial iv,128bit
 Return:           null
 Others:
 ****************************************************************/
-void ZUC_Confidentiality(unsigned char CK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned int IBS[], int LENGTH, unsigned int OBS[])
-
+void ZUC_EEA3IV(unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned char iv[])
 {
-	unsigned int *k;
-	int L, i, t;
-	unsigned char iv[16];
 	//generate vector iv1,iv2,...iv15
 	iv[0] = (unsigned char)(COUNT >> 24);
 	iv[1] = (unsigned char)((COUNT >> 16) & 0xff);
@@ -376,45 +1116,23 @@ void ZUC_Confidentiality(unsigned char CK[], unsigned int COUNT, unsigned char B
 	iv[13] = iv[5];
 	iv[14] = iv[6];
 	iv[15] = iv[7];
-
-	//L,the length of key stream,taking 32bit as a unit
-	L = (LENGTH + 31) / 32;
-	k = malloc(sizeof(unsigned int) * L);
-
-	//generate key stream k
-	ZUC_GenKeyStream(CK, iv, k, L); //generate key stream
-
-	//OBS=IBS^k
-	for (i = 0; i < L; i++)
-		OBS[i] = IBS[i] ^ k[i];
-	t = LENGTH % 32;
-	if (t)
-		OBS[L - 1] = ((OBS[L - 1] >> (32 - t)) << (32 - t));
-	free(k);
 }
 
 /****************************************************************
-Function:       ZUC_Integrity
-Description:    the ZUC-based integrity algorithm
-Calls:          ZUC_GenKeyStream,BitValue,GetWord
-Called By:      ZUC_SelfCheck
-Input:          IK[]              //integrity key,128bit,used to gain the key of ZUC KeyStream generation algorithm
-                COUNT             //128bit
-                BEARER            //5bit,bearing layer identification,
-                DIRECTION         //1bit
-                M[]               //message
-                LENGTH            //the bit length of M
-Output:
-Return:         MAC            //message authentication code
+Function:         ZUC_EIA3IV
+Description:      the iv of the integrity algorithm
+Calls:
+Called By:        ZUC_Integrity,ZUC_IntegrityBytes,ZUC_PDCP_Run,
+                  ZUC_ConfidentialityIntegrityBytes
+Input:            COUNT            //32bit counter
+                  BEARER           //5bit,bearing layer identification
+                  DIRECTION        //1bit
+Output:           iv[]             //initial iv,128bit
+Return:           null
 Others:
 ****************************************************************/
-unsigned int ZUC_Integrity(unsigned char IK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned int M[], int LENGTH)
+void ZUC_EIA3IV(unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned char iv[])
 {
-	unsigned int *k, ki, MAC;
-	int L, i;
-	unsigned char iv[16];
-	unsigned int T = 0;
-
 	//generate vector iv1,iv2,...iv15
 	iv[0] = (unsigned char)(COUNT >> 24);
 	iv[1] = (unsigned char)((COUNT >> 16) & 0xff);
@@ -432,40 +1150,1201 @@ unsigned int ZUC_Integrity(unsigned char IK[], unsigned int COUNT, unsigned char
 	iv[13] = iv[5];
 	iv[14] = iv[6] ^ (DIRECTION << 7);
 	iv[15] = iv[7];
-
-	//L,the length of key stream,taking 32bit as a unit
-	L = (LENGTH + 31) / 32 + 2;
-	k = malloc(sizeof(unsigned int) * L);
-
-	//generate key stream k
-	ZUC_GenKeyStream(IK, iv, k, L);
-
-	//T=T^ki
-	for (i = 0; i < LENGTH; i++)
-	{
-		if (BitValue(M, i))
-		{
-			ki = GetWord(k, i);
-			T = T ^ ki;
-		}
-	}
-
-	//T=T^kLENGTH
-	ki = GetWord(k, LENGTH);
-	T = T ^ ki;
-
-	//MAC=T^k(32*(L-1))
-	ki = GetWord(k, 32 * (L - 1));
-	MAC = T ^ ki;
-
-	free(k);
-	return MAC;
 }
 
 /****************************************************************
-Function:         ZUC_SelfCheck
-Description:      Self-check with standard data
-Calls:            ZUC_GenKeyStream,ZUC_Confidentiality,ZUC_Integrity
+Function:         ZUC_Confidentiality
+Description:      the ZUC-based confidentiality algorithm
+Calls:            ZUC_EEA3IV,ZUC_CtxInit,ZUC_CtxXor
+Called By:        ZUC_SelfCheck
+Input:            CK[]             //initial key,128bit,used to gain the key of ZUC KeyStream generation algorithm
+                  COUNT            //128bit
+                  BEARER           //5bit,bearing layer identification,
+                  DIRECTION        //1bit
+                  IBS[]            //input bit stream,
+                  LENGTH           //the bit length of IBS
+Output:           OBS[]            //output bit stream,
+Return:           null
+Others:
+****************************************************************/
+void ZUC_Confidentiality(unsigned char CK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned int IBS[], int LENGTH, unsigned int OBS[])
+
+{
+	ZUC_CTX ctx;
+	int L, t;
+	unsigned char iv[16];
+
+	ZUC_EEA3IV(COUNT, BEARER, DIRECTION, iv);
+
+	//L,the length of key stream,taking 32bit as a unit
+	L = (LENGTH + 31) / 32;
+
+	//OBS=IBS^k, the key stream is generated chunk by chunk
+	ZUC_CtxInit(&ctx, CK, iv);
+	ZUC_CtxXor(&ctx, IBS, OBS, L);
+	t = LENGTH % 32;
+	if (t)
+		OBS[L - 1] = ((OBS[L - 1] >> (32 - t)) << (32 - t));
+	memset(&ctx, 0, sizeof(ctx));
+}
+
+/****************************************************************
+Function:       ZUC_EIA3Bit
+Description:    the tag of EIA3 from a fresh context, one message bit at
+                a time
+Calls:          ZUC_CtxGenerate,BitValue,GetWord
+Called By:      ZUC_SelfCheck
+Input:          ctx               //context just initialised with the integrity key and iv
+                M[]               //message
+                LENGTH            //the bit length of M
+Output:         ctx               //ZUC context
+Return:         MAC            //message authentication code
+Others:         reference for ZUC_EIA3Word
+****************************************************************/
+unsigned int ZUC_EIA3Bit(ZUC_CTX *ctx, unsigned int M[], int LENGTH)
+{
+	unsigned int k[2], ki, MAC;
+	int i, m;
+	unsigned int T = 0;
+
+	//k[0],k[1] slide over the key stream: k[0] holds the word of bit i
+	ZUC_CtxGenerate(ctx, k, 2);
+
+	//T=T^ki
+	for (i = 0; i < LENGTH; i++)
+	{
+		m = i & 0x1f;
+		if (i && !m)
+		{
+			k[0] = k[1];
+			ZUC_CtxGenerate(ctx, k + 1, 1);
+		}
+		if (BitValue(M, i))
+		{
+			ki = GetWord(k, m);
+			T = T ^ ki;
+		}
+	}
+
+	//T=T^kLENGTH, the word of bit LENGTH starts in k[0] unless LENGTH is a multiple of 32
+	if (LENGTH && !(LENGTH & 0x1f))
+	{
+		k[0] = k[1];
+		ZUC_CtxGenerate(ctx, k + 1, 1);
+	}
+	ki = GetWord(k, LENGTH & 0x1f);
+	T = T ^ ki;
+
+	//MAC=T^k(32*(L-1)), L=(LENGTH+31)/32+2: the word after the current k[1],
+	//or k[1] itself when LENGTH is a multiple of 32
+	if (LENGTH & 0x1f)
+	{
+		k[0] = k[1];
+		ZUC_CtxGenerate(ctx, k + 1, 1);
+	}
+	MAC = T ^ k[1];
+
+	memset(k, 0, sizeof(k));
+	return MAC;
+}
+
+//EEA3 over a byte range that is run 4 bytes at a time while EIA3 reads the message
+typedef struct
+{
+	ZUC_CTX *ctx;             //confidentiality key stream
+	const unsigned char *in;  //input bytes from the byte of the first bit
+	unsigned char *out;       //output bytes, may be the same as in
+	int s, bits, L, ng;       //bit offset, s+LENGTH, key stream words, groups of 4 bytes
+	int next;                 //the next group to run
+	int macout;               //1 the groups are returned as output, 0 as input
+	unsigned int k[ZUC_CHUNK], prev, G; //key stream, its previous word, the last group
+} ZUC_EEA3_STREAM;
+
+/****************************************************************
+Function:       ZUC_EEA3Groups
+Description:    run the next groups of 4 bytes of an EEA3 stream
+Calls:          ZUC_CtxGenerate
+Called By:      ZUC_EIA3Fetch,ZUC_EEA3EIA3Bytes
+Input:          X                 //EEA3 stream
+                count             //the number of groups, X->next+count <= X->ng
+Output:         X                 //EEA3 stream, the groups written to X->out
+                G[]               //the groups as big-endian words of input or
+                                  //output, bits outside the range cleared
+Return:         null
+Others:         the key stream is applied as in ZUC_CtxXorBytes; a group
+                is read before it is written, so in place works. The
+                stream is kept in locals, out may alias anything.
+****************************************************************/
+static void ZUC_EEA3Groups(ZUC_EEA3_STREAM *X, unsigned int G[], int count)
+{
+	const unsigned char *in = X->in + 4 * X->next;
+	unsigned char *out = X->out + 4 * X->next;
+	unsigned int cur, x, w, mask, prev = X->prev;
+	int s = X->s, bits = X->bits, L = X->L, macout = X->macout;
+	int g = X->next, end = X->next + count, m, c, i;
+
+	for (; g < end; g++, in += 4, out += 4)
+	{
+		if (g % ZUC_CHUNK == 0 && g < L)
+		{
+			c = L - g < ZUC_CHUNK ? L - g : ZUC_CHUNK;
+			ZUC_CtxGenerate(X->ctx, X->k, c);
+		}
+		cur = g < L ? X->k[g % ZUC_CHUNK] : 0;
+		x = s ? (prev << (32 - s)) | (cur >> s) : cur;
+		prev = cur;
+
+		mask = g ? 0xffffffff : 0xffffffff >> s;
+		if (bits - 32 * g < 32)
+			mask &= 0xffffffff << (32 - (bits - 32 * g));
+		x &= mask;
+
+		m = (bits + 7) / 8 - 4 * g;
+		if (m >= 4)
+		{
+			w = ((unsigned int)in[0] << 24) | ((unsigned int)in[1] << 16) | ((unsigned int)in[2] << 8) | in[3];
+			out[0] = (unsigned char)((w ^ x) >> 24);
+			out[1] = (unsigned char)((w ^ x) >> 16);
+			out[2] = (unsigned char)((w ^ x) >> 8);
+			out[3] = (unsigned char)(w ^ x);
+		}
+		else
+			for (w = 0, i = 0; i < m; i++)
+			{
+				w |= (unsigned int)in[i] << (24 - 8 * i);
+				out[i] = in[i] ^ (unsigned char)(x >> (24 - 8 * i));
+			}
+		*G++ = (macout ? w ^ x : w) & mask;
+	}
+	X->prev = prev;
+	X->next = end;
+}
+
+//the message of an EIA3 tag: host order words, or big-endian bytes from a bit offset
+typedef struct
+{
+	const unsigned int *M;  //words, NULL for bytes
+	const unsigned char *B; //bytes, the first bit is bit 7-s of B[0]
+	int s;                  //bit offset into B[0], 0..7
+	int LENGTH;             //the bit length of the message
+	ZUC_EEA3_STREAM *X;     //NULL, or the bytes are those of X, ciphered as they are read
+} ZUC_EIA3_MSG;
+
+/****************************************************************
+Function:       ZUC_EIA3Fetch
+Description:    words i..i+n-1 of an EIA3 message
+Calls:          ZUC_EEA3Groups
+Called By:      ZUC_EIA3WordMsg,ZUC_EIA3Clmul
+Input:          msg               //message
+                i                 //the first word
+                n                 //the number of words
+Output:         W[]               //words, bits past LENGTH cleared
+Return:         null
+Others:         a byte message is read as 40bit big-endian windows and
+                never past the byte of its last bit; with an EEA3 stream
+                its groups are ciphered as they are reached
+****************************************************************/
+static void ZUC_EIA3Fetch(const ZUC_EIA3_MSG *msg, int i, int n, unsigned int W[])
+{
+	int nw = (msg->LENGTH + 31) / 32, r = msg->LENGTH & 0x1f;
+	int nb = (msg->s + msg->LENGTH + 7) / 8, j, p, q;
+	unsigned long long v;
+	unsigned int G[ZUC_CHUNK + 1];
+
+	if (msg->M)
+		memcpy(W, msg->M + i, n * sizeof(unsigned int));
+	else if (msg->X)
+	{
+		//word i+j takes groups i+j and i+j+1, group i was run by the previous call
+		G[0] = msg->X->G;
+		if (i == msg->X->next && i < msg->X->ng)
+			ZUC_EEA3Groups(msg->X, G, 1);
+		q = (i + n < msg->X->ng ? i + n : msg->X->ng - 1) - i;
+		if (q > 0)
+			ZUC_EEA3Groups(msg->X, G + 1, q);
+		for (j = (q > 0 ? q : 0) + 1; j <= n; j++)
+			G[j] = 0;
+		for (j = 0; j < n; j++)
+			W[j] = msg->s ? (G[j] << msg->s) | (G[j + 1] >> (32 - msg->s)) : G[j];
+		msg->X->G = G[n];
+	}
+	else
+		for (j = 0; j < n; j++)
+		{
+			p = 4 * (i + j);
+			if (p + 5 <= nb)
+				v = ((unsigned long long)msg->B[p] << 32) | ((unsigned long long)msg->B[p + 1] << 24) |
+				    ((unsigned long long)msg->B[p + 2] << 16) | ((unsigned long long)msg->B[p + 3] << 8) | msg->B[p + 4];
+			else
+				for (v = 0, q = 0; q < 5; q++)
+					v = (v << 8) | (p + q < nb ? msg->B[p + q] : 0);
+			W[j] = (unsigned int)(v >> (8 - msg->s));
+		}
+	if (i + n == nw && r)
+		W[n - 1] &= 0xffffffff << (32 - r);
+}
+
+/****************************************************************
+Function:       ZUC_EIA3WordSum
+Description:    the part of an EIA3 tag from n message words, one bit
+                at a time
+Calls:
+Called By:      ZUC_EIA3WordMsg,ZUC256_Mac
+Input:          W[]               //message words
+                k[]               //key stream, k[i]||k[i+1] is the window of word i
+                n                 //the number of words
+Output:
+Return:         xor of the key windows of the set bits
+Others:         K=k[i]||k[i+1] is shifted left once per bit, its high
+                half is then the key word of that bit; a set bit selects
+                it through an all-ones mask, so there is no branch on
+                the message
+****************************************************************/
+static unsigned int ZUC_EIA3WordSum(const unsigned int W[], const unsigned int k[], int n)
+{
+	unsigned long long K;
+	unsigned int T = 0, w;
+	int i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		w = W[i];
+		K = ((unsigned long long)k[i] << 32) | k[i + 1];
+		for (j = 0; j < 32; j++)
+		{
+			T ^= (unsigned int)(K >> 32) & (0 - (w >> 31));
+			K <<= 1;
+			w <<= 1;
+		}
+	}
+	K = 0;
+	return T;
+}
+
+/****************************************************************
+Function:       ZUC_EIA3WordMsg
+Description:    the tag of EIA3 from a fresh context, one message word
+                at a time
+Calls:          ZUC_CtxGenerate,ZUC_EIA3Fetch,ZUC_EIA3WordSum
+Called By:      ZUC_EIA3Word,ZUC_EIA3Msg
+Input:          ctx               //context just initialised with the integrity key and iv
+                msg               //message
+Output:         ctx               //ZUC context
+Return:         MAC            //message authentication code
+Others:
+****************************************************************/
+static unsigned int ZUC_EIA3WordMsg(ZUC_CTX *ctx, const ZUC_EIA3_MSG *msg)
+{
+	unsigned int k[ZUC_CHUNK + 1], W[ZUC_CHUNK], MAC;
+	unsigned long long K = 0;
+	unsigned int T = 0;
+	int nw = (msg->LENGTH + 31) / 32, r = msg->LENGTH & 0x1f;
+	int d, n;
+
+	//k[0] is the word of the first bit of the chunk, k[1..n] follow it
+	ZUC_CtxGenerate(ctx, k, 1);
+	for (d = 0; d < nw; d += n)
+	{
+		n = nw - d < ZUC_CHUNK ? nw - d : ZUC_CHUNK;
+		ZUC_CtxGenerate(ctx, k + 1, n);
+		ZUC_EIA3Fetch(msg, d, n, W);
+		T ^= ZUC_EIA3WordSum(W, k, n);
+		K = ((unsigned long long)k[n - 1] << 32) | k[n];
+		k[0] = k[n];
+	}
+
+	//T=T^kLENGTH: the word r bits into the last word pair, or the next
+	//key word k[0] when LENGTH is a multiple of 32
+	T ^= r ? (unsigned int)(K >> (32 - r)) : k[0];
+	//MAC=T^k(32*(L-1)), the key word after k[0]
+	ZUC_CtxGenerate(ctx, k + 1, 1);
+	MAC = T ^ k[1];
+
+	memset(k, 0, sizeof(k));
+	memset(W, 0, sizeof(W));
+	K = 0;
+	return MAC;
+}
+
+/****************************************************************
+Function:       ZUC_EIA3Word
+Description:    the tag of EIA3 from a fresh context, one message word
+                at a time
+Calls:          ZUC_EIA3WordMsg
+Called By:      ZUC_SelfCheck
+Input:          ctx               //context just initialised with the integrity key and iv
+                M[]               //message
+                LENGTH            //the bit length of M
+Output:         ctx               //ZUC context
+Return:         MAC            //message authentication code
+Others:         bits of the last word past LENGTH are ignored, as in
+                ZUC_EIA3Bit
+****************************************************************/
+unsigned int ZUC_EIA3Word(ZUC_CTX *ctx, const unsigned int M[], int LENGTH)
+{
+	ZUC_EIA3_MSG msg = {M, NULL, 0, LENGTH, NULL};
+
+	return ZUC_EIA3WordMsg(ctx, &msg);
+}
+
+#ifdef ZUC_X86
+
+/*
+ * Carry-less multiply path. With m_j the message bits and k_i the key
+ * stream bits, bit b of T is the sum of m_j*k_(j+b), a correlation. The
+ * 64 message bits of a word pair are bit reversed, m_j at x^j, and the
+ * key stream is taken as 128bit k_0..k_127 from x^127 down, then bit b
+ * of T is the coefficient of x^(127-b) in their product. Key bits past
+ * k_94 and the garbage behind a short message only reach lower powers.
+ */
+
+#define ZUC_HAS_CLMUL() (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+
+//reverse the bits of each 32bit lane
+__attribute__((target("pclmul,ssse3"))) static inline __m128i ZUC_Rev32(__m128i x)
+{
+	const __m128i nib = _mm_setr_epi8(0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe, 0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf);
+	const __m128i low = _mm_set1_epi8(0x0f);
+
+	x = _mm_shuffle_epi8(x, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+	return _mm_or_si128(_mm_slli_epi16(_mm_shuffle_epi8(nib, _mm_and_si128(x, low)), 4),
+	                    _mm_shuffle_epi8(nib, _mm_and_si128(_mm_srli_epi16(x, 4), low)));
+}
+
+/****************************************************************
+Function:       ZUC_EIA3ClmulSum
+Description:    the part of an EIA3 tag from n message words with
+                PCLMULQDQ, four words at a time
+Calls:          ZUC_Rev32
+Called By:      ZUC_EIA3Clmul,ZUC256_Mac
+Input:          W[]               //message words, 0 up to a multiple of four
+                k[]               //key stream, k[i]||k[i+1] is the window of word i,
+                                  //readable up to two words past the padded W
+                n                 //the number of words
+Output:
+Return:         xor of the key windows of the set bits
+Others:         the products are summed unreduced, T is taken from
+                them once at the end
+****************************************************************/
+__attribute__((target("pclmul,ssse3"))) static unsigned int ZUC_EIA3ClmulSum(const unsigned int W[], const unsigned int k[], int n)
+{
+	__m128i hi = _mm_setzero_si128(), lo = _mm_setzero_si128(), R, Q0, Q1;
+	int i;
+
+	for (i = 0; i < n; i += 4)
+	{
+		R = ZUC_Rev32(_mm_loadu_si128((const __m128i *)(W + i)));
+		//64bit lanes k[i]||k[i+1],k[i+2]||k[i+3] and k[i+2]||k[i+3],k[i+4]||k[i+5]
+		Q0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(k + i)), 0xb1);
+		Q1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(k + i + 2)), 0xb1);
+		hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(R, Q0, 0x00));
+		lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(R, Q0, 0x10));
+		hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(R, Q1, 0x01));
+		lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(R, Q1, 0x11));
+	}
+
+	//the high key half weighs x^64 more, T is bits 96..127 of the sum
+	lo = _mm_xor_si128(lo, _mm_slli_si128(hi, 8));
+	return (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(lo, 12));
+}
+
+/****************************************************************
+Function:       ZUC_EIA3Clmul
+Description:    the tag of EIA3 from a fresh context with PCLMULQDQ,
+                four message words at a time
+Calls:          ZUC_CtxGenerate,ZUC_EIA3Fetch,ZUC_EIA3ClmulSum
+Called By:      ZUC_EIA3Msg
+Input:          ctx               //context just initialised with the integrity key and iv
+                msg               //message
+Output:         ctx               //ZUC context
+Return:         MAC            //message authentication code
+Others:
+****************************************************************/
+__attribute__((target("pclmul,ssse3"))) static unsigned int ZUC_EIA3Clmul(ZUC_CTX *ctx, const ZUC_EIA3_MSG *msg)
+{
+	unsigned int k[ZUC_CHUNK + 2], W[ZUC_CHUNK], T = 0, MAC;
+	unsigned long long K = 0;
+	int nw = (msg->LENGTH + 31) / 32, r = msg->LENGTH & 0x1f;
+	int d, n;
+
+	//k[0],k[1] are the words of the first pair of the chunk, k[2..n+1] follow them
+	memset(k, 0, sizeof(k));
+	ZUC_CtxGenerate(ctx, k, 2);
+	for (d = 0; d < nw; d += n)
+	{
+		n = nw - d < ZUC_CHUNK ? nw - d : ZUC_CHUNK;
+		ZUC_CtxGenerate(ctx, k + 2, n);
+		//a short last chunk is padded with 0 to four words
+		memset(W, 0, sizeof(W));
+		ZUC_EIA3Fetch(msg, d, n, W);
+		T ^= ZUC_EIA3ClmulSum(W, k, n);
+		K = ((unsigned long long)k[n - 1] << 32) | k[n];
+		k[0] = k[n];
+		k[1] = k[n + 1];
+	}
+
+	//T=T^kLENGTH and MAC=T^k(32*(L-1)) as in ZUC_EIA3WordMsg, k[1] is already that word
+	T ^= r ? (unsigned int)(K >> (32 - r)) : k[0];
+	MAC = T ^ k[1];
+
+	memset(k, 0, sizeof(k));
+	memset(W, 0, sizeof(W));
+	K = 0;
+	return MAC;
+}
+
+#endif
+
+//the carry-less multiply path when the CPU has PCLMULQDQ, else the word-at-a-time one
+static unsigned int ZUC_EIA3Msg(ZUC_CTX *ctx, const ZUC_EIA3_MSG *msg)
+{
+#ifdef ZUC_X86
+	if (ZUC_HAS_CLMUL())
+		return ZUC_EIA3Clmul(ctx, msg);
+#endif
+	return ZUC_EIA3WordMsg(ctx, msg);
+}
+
+/****************************************************************
+Function:       ZUC_EIA3
+Description:    the tag of EIA3 from a fresh context
+Calls:          ZUC_EIA3Msg
+Called By:      ZUC_Integrity,ZUC_SelfCheck
+Input:          ctx               //context just initialised with the integrity key and iv
+                M[]               //message
+                LENGTH            //the bit length of M
+Output:         ctx               //ZUC context
+Return:         MAC            //message authentication code
+Others:         the carry-less multiply path is taken when the CPU has
+                PCLMULQDQ, else the word-at-a-time one
+****************************************************************/
+unsigned int ZUC_EIA3(ZUC_CTX *ctx, const unsigned int M[], int LENGTH)
+{
+	ZUC_EIA3_MSG msg = {M, NULL, 0, LENGTH, NULL};
+
+	return ZUC_EIA3Msg(ctx, &msg);
+}
+
+/****************************************************************
+Function:       ZUC_EIA3Bytes
+Description:    the tag of EIA3 from a fresh context over a byte buffer
+Calls:          ZUC_EIA3Msg
+Called By:      ZUC_IntegrityBytes,ZUC_PDCP_Run
+Input:          ctx               //context just initialised with the integrity key and iv
+                M[]               //message bytes, bit 0 is the most significant bit of M[0]
+                offset            //the bit of M where the message starts
+                LENGTH            //the bit length of the message
+Output:         ctx               //ZUC context
+Return:         MAC            //message authentication code
+Others:         the bytes are read in place, words are formed from them
+                ZUC_CHUNK at a time on the stack
+****************************************************************/
+unsigned int ZUC_EIA3Bytes(ZUC_CTX *ctx, const unsigned char M[], int offset, int LENGTH)
+{
+	ZUC_EIA3_MSG msg = {NULL, M + (offset >> 3), offset & 7, LENGTH, NULL};
+
+	return ZUC_EIA3Msg(ctx, &msg);
+}
+
+/****************************************************************
+Function:       ZUC_EEA3EIA3Bytes
+Description:    EEA3 and the tag of EIA3 over a byte buffer in one pass
+Calls:          ZUC_EIA3Msg,ZUC_EEA3Groups
+Called By:      ZUC_ConfidentialityIntegrityBytes,ZUC_PDCP_Run
+Input:          cctx              //context initialised with the confidentiality key and iv
+                ictx              //context just initialised with the integrity key and iv
+                in[]              //input bytes, bit 0 is the most significant bit of in[0]
+                offset            //the bit where the bit stream starts
+                LENGTH            //the bit length of the bit stream
+                macout            //1 the MAC covers out, 0 it covers in
+Output:         cctx,ictx         //ZUC contexts
+                out[]             //output bytes, may be the same as in
+Return:         MAC            //message authentication code
+Others:         out equals that of ZUC_CtxXorBytes and the MAC that of
+                ZUC_EIA3Bytes over in or out. Every 4 bytes are read
+                once, ciphered and handed to EIA3 while the integrity
+                key stream is generated alongside.
+****************************************************************/
+unsigned int ZUC_EEA3EIA3Bytes(ZUC_CTX *cctx, ZUC_CTX *ictx, const unsigned char in[], unsigned char out[], int offset, int LENGTH, int macout)
+{
+	ZUC_EEA3_STREAM X;
+	ZUC_EIA3_MSG msg = {NULL, NULL, offset & 7, LENGTH, &X};
+	unsigned int MAC;
+
+	X.ctx = cctx;
+	X.in = in + (offset >> 3);
+	X.out = out + (offset >> 3);
+	X.s = offset & 7;
+	X.bits = X.s + LENGTH;
+	X.L = (LENGTH + 31) / 32;
+	X.ng = (X.bits + 31) / 32;
+	X.next = 0;
+	X.macout = macout;
+	X.prev = X.G = 0;
+
+	MAC = ZUC_EIA3Msg(ictx, &msg);
+	//the group no message word reached: a last partial byte, or all of an empty range
+	if (X.next < X.ng)
+		ZUC_EEA3Groups(&X, &X.G, X.ng - X.next);
+
+	memset(&X, 0, sizeof(X));
+	return MAC;
+}
+
+/****************************************************************
+Function:       ZUC_Integrity
+Description:    the ZUC-based integrity algorithm
+Calls:          ZUC_EIA3IV,ZUC_CtxInit,ZUC_EIA3
+Called By:      ZUC_SelfCheck
+Input:          IK[]              //integrity key,128bit,used to gain the key of ZUC KeyStream generation algorithm
+                COUNT             //128bit
+                BEARER            //5bit,bearing layer identification,
+                DIRECTION         //1bit
+                M[]               //message
+                LENGTH            //the bit length of M
+Output:
+Return:         MAC            //message authentication code
+Others:
+****************************************************************/
+unsigned int ZUC_Integrity(unsigned char IK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned int M[], int LENGTH)
+{
+	ZUC_CTX ctx;
+	unsigned int MAC;
+	unsigned char iv[16];
+
+	ZUC_EIA3IV(COUNT, BEARER, DIRECTION, iv);
+	ZUC_CtxInit(&ctx, IK, iv);
+	MAC = ZUC_EIA3(&ctx, M, LENGTH);
+
+	memset(&ctx, 0, sizeof(ctx));
+	return MAC;
+}
+
+/****************************************************************
+Function:         ZUC_ConfidentialityBytes
+Description:      the ZUC-based confidentiality algorithm over a byte buffer
+Calls:            ZUC_EEA3IV,ZUC_CtxInit,ZUC_CtxXorBytes
+Called By:        ZUC_SelfCheck
+Input:            CK[]             //confidentiality key,128bit
+                  COUNT            //32bit counter
+                  BEARER           //5bit,bearing layer identification
+                  DIRECTION        //1bit
+                  IBS[]            //input bytes, bit 0 is the most significant bit of IBS[0]
+                  offset           //the bit of IBS where the bit stream starts
+                  LENGTH           //the bit length of the bit stream
+Output:           OBS[]            //output bytes, may be the same as IBS
+Return:           null
+Others:           only bits offset..offset+LENGTH-1 of OBS are written
+                  with the cipher; the rest of their first and last byte
+                  comes from IBS
+****************************************************************/
+void ZUC_ConfidentialityBytes(unsigned char CK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, const unsigned char IBS[], unsigned char OBS[], int offset, int LENGTH)
+{
+	ZUC_CTX ctx;
+	unsigned char iv[16];
+
+	ZUC_EEA3IV(COUNT, BEARER, DIRECTION, iv);
+	ZUC_CtxInit(&ctx, CK, iv);
+	ZUC_CtxXorBytes(&ctx, IBS, OBS, offset, LENGTH);
+	memset(&ctx, 0, sizeof(ctx));
+}
+
+/****************************************************************
+Function:       ZUC_IntegrityBytes
+Description:    the ZUC-based integrity algorithm over a byte buffer
+Calls:          ZUC_EIA3IV,ZUC_CtxInit,ZUC_EIA3Bytes
+Called By:      ZUC_SelfCheck
+Input:          IK[]              //integrity key,128bit
+                COUNT             //32bit counter
+                BEARER            //5bit,bearing layer identification
+                DIRECTION         //1bit
+                M[]               //message bytes, bit 0 is the most significant bit of M[0]
+                offset            //the bit of M where the message starts
+                LENGTH            //the bit length of the message
+Output:
+Return:         MAC            //message authentication code
+Others:
+****************************************************************/
+unsigned int ZUC_IntegrityBytes(unsigned char IK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, const unsigned char M[], int offset, int LENGTH)
+{
+	ZUC_CTX ctx;
+	unsigned char iv[16];
+	unsigned int MAC;
+
+	ZUC_EIA3IV(COUNT, BEARER, DIRECTION, iv);
+	ZUC_CtxInit(&ctx, IK, iv);
+	MAC = ZUC_EIA3Bytes(&ctx, M, offset, LENGTH);
+	memset(&ctx, 0, sizeof(ctx));
+	return MAC;
+}
+
+/****************************************************************
+Function:       ZUC_ConfidentialityIntegrityBytes
+Description:    the confidentiality and integrity algorithms over a byte
+                buffer in one pass
+Calls:          ZUC_EEA3IV,ZUC_EIA3IV,ZUC_CtxInit,ZUC_EEA3EIA3Bytes
+Called By:      ZUC_SelfCheck
+Input:          CK[]              //confidentiality key,128bit
+                IK[]              //integrity key,128bit
+                COUNT             //32bit counter
+                BEARER            //5bit,bearing layer identification
+                DIRECTION         //1bit
+                IBS[]             //input bytes, bit 0 is the most significant bit of IBS[0]
+                offset            //the bit of IBS where the bit stream starts
+                LENGTH            //the bit length of the bit stream
+                macout            //1 the MAC covers OBS, 0 it covers IBS
+Output:         OBS[]             //output bytes, may be the same as IBS
+Return:         MAC            //message authentication code
+Others:         equals ZUC_IntegrityBytes before (macout 0) or after
+                (macout 1) ZUC_ConfidentialityBytes
+****************************************************************/
+unsigned int ZUC_ConfidentialityIntegrityBytes(unsigned char CK[], unsigned char IK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, const unsigned char IBS[], unsigned char OBS[], int offset, int LENGTH, int macout)
+{
+	ZUC_CTX cctx, ictx;
+	unsigned char iv[16];
+	unsigned int MAC;
+
+	ZUC_EEA3IV(COUNT, BEARER, DIRECTION, iv);
+	ZUC_CtxInit(&cctx, CK, iv);
+	ZUC_EIA3IV(COUNT, BEARER, DIRECTION, iv);
+	ZUC_CtxInit(&ictx, IK, iv);
+	MAC = ZUC_EEA3EIA3Bytes(&cctx, &ictx, IBS, OBS, offset, LENGTH, macout);
+	memset(&cctx, 0, sizeof(cctx));
+	memset(&ictx, 0, sizeof(ictx));
+	return MAC;
+}
+
+/****************************************************************
+Function:         ZUC_PDCP_Run
+Description:      EEA3 and EIA3 of a run of packets
+Calls:            ZUC_EEA3IV,ZUC_EIA3IV,ZUC_CtxLoad,ZUC_CtxStartMany,
+                  ZUC_EEA3EIA3Bytes,ZUC_EIA3Bytes,ZUC_CtxXorBytes
+Called By:        ZUC_PDCP_Task,ZUC_PDCP_Batch
+Input:            pkt[]            //packets
+                  count            //the number of packets
+Output:           pkt[]            //ciphered buffers and MACs
+Return:           null
+Others:           the key streams of ZUC_PDCP_GROUP packets are
+                  initialised together, then each is run on its own
+****************************************************************/
+static void ZUC_PDCP_Run(ZUC_PDCP_PKT pkt[], int count)
+{
+	ZUC_CTX ctx[2 * ZUC_PDCP_GROUP];
+	unsigned char iv[16];
+	int i, j, n, m, ni, mi, mc, op;
+
+	for (i = 0; i < count; i += n)
+	{
+		n = count - i < ZUC_PDCP_GROUP ? count - i : ZUC_PDCP_GROUP;
+		//integrity contexts first, confidentiality ones after them, in packet order
+		for (m = 0, j = 0; j < n; j++)
+			if (pkt[i + j].op & ZUC_PDCP_EIA3)
+			{
+				ZUC_EIA3IV(pkt[i + j].COUNT, pkt[i + j].BEARER, pkt[i + j].DIRECTION, iv);
+				ZUC_CtxLoad(&ctx[m++], pkt[i + j].IK, iv);
+			}
+		ni = m;
+		for (j = 0; j < n; j++)
+			if (pkt[i + j].op & ZUC_PDCP_EEA3)
+			{
+				ZUC_EEA3IV(pkt[i + j].COUNT, pkt[i + j].BEARER, pkt[i + j].DIRECTION, iv);
+				ZUC_CtxLoad(&ctx[m++], pkt[i + j].CK, iv);
+			}
+		ZUC_CtxStartMany(ctx, m);
+
+		//a packet with both operations runs them in one pass
+		for (mi = 0, mc = ni, j = 0; j < n; j++)
+		{
+			op = pkt[i + j].op;
+			if ((op & ZUC_PDCP_EEA3) && (op & ZUC_PDCP_EIA3))
+				pkt[i + j].MAC = ZUC_EEA3EIA3Bytes(&ctx[mc++], &ctx[mi++], pkt[i + j].buf, pkt[i + j].buf, 0, pkt[i + j].LENGTH,
+				                                   !!(op & ZUC_PDCP_MAC_OUT));
+			else if (op & ZUC_PDCP_EIA3)
+				pkt[i + j].MAC = ZUC_EIA3Bytes(&ctx[mi++], pkt[i + j].buf, 0, pkt[i + j].LENGTH);
+			else if (op & ZUC_PDCP_EEA3)
+				ZUC_CtxXorBytes(&ctx[mc++], pkt[i + j].buf, pkt[i + j].buf, 0, pkt[i + j].LENGTH);
+		}
+	}
+	memset(ctx, 0, sizeof(ctx));
+}
+
+//the body of every worker thread of a ZUC_POOL
+static void *ZUC_PoolWorker(void *p)
+{
+	ZUC_POOL *pool = (ZUC_POOL *)p;
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;)
+	{
+		while (!pool->quit && pool->next >= pool->count)
+			pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->quit)
+			break;
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		pool->fn(pool->arg, i);
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->pending == 0)
+			pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/****************************************************************
+Function:         ZUC_PoolInit
+Description:      start a pool of worker threads, kept for many batches
+Calls:            ZUC_PoolFree
+Called By:        ZUC_SelfCheck
+Input:            threads          //worker threads, 0..ZUC_POOL_MAX_THREADS;
+                                   //the calling thread always works as well
+Output:           pool             //worker pool
+Return:           1 bad thread count or a thread could not be created; 0 success
+Others:
+****************************************************************/
+int ZUC_PoolInit(ZUC_POOL *pool, int threads)
+{
+	int i;
+
+	if (threads < 0 || threads > ZUC_POOL_MAX_THREADS)
+		return 1;
+
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	for (i = 0; i < threads; i++)
+	{
+		if (pthread_create(&pool->tid[i], NULL, ZUC_PoolWorker, pool))
+		{
+			pool->threads = i;
+			ZUC_PoolFree(pool);
+			return 1;
+		}
+	}
+	pool->threads = threads;
+	return 0;
+}
+
+/****************************************************************
+Function:         ZUC_PoolFree
+Description:      stop the worker threads and release the pool
+Calls:
+Called By:        ZUC_PoolInit,ZUC_SelfCheck
+Input:            pool             //worker pool, no batch may be running
+Output:
+Return:           null
+Others:
+****************************************************************/
+void ZUC_PoolFree(ZUC_POOL *pool)
+{
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->threads; i++)
+		pthread_join(pool->tid[i], NULL);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	pthread_mutex_destroy(&pool->lock);
+	pool->threads = 0;
+}
+
+/****************************************************************
+Function:         ZUC_PoolRun
+Description:      run fn(arg,i) for i=0..count-1 on the workers and the
+                  calling thread, and wait until all tasks are finished
+Calls:
+Called By:        ZUC_PDCP_Batch
+Input:            pool             //worker pool
+                  fn               //task function
+                  arg              //argument passed to every task
+                  count            //the number of tasks
+Output:
+Return:           null
+Others:           one batch at a time: a pool must not be shared by
+                  threads that call ZUC_PoolRun concurrently
+****************************************************************/
+void ZUC_PoolRun(ZUC_POOL *pool, void (*fn)(void *arg, int i), void *arg, int count)
+{
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->next = 0;
+	pool->count = count;
+	pool->pending = count;
+	pthread_cond_broadcast(&pool->start);
+	while (pool->next < pool->count)
+	{
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		fn(arg, i);
+		pthread_mutex_lock(&pool->lock);
+		pool->pending--;
+	}
+	while (pool->pending)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+//the packets of ZUC_PDCP_Batch, cut into runs of per packets
+typedef struct
+{
+	ZUC_PDCP_PKT *pkt;
+	int count, per;
+} ZUC_PDCP_JOB;
+
+static void ZUC_PDCP_Task(void *arg, int i)
+{
+	ZUC_PDCP_JOB *job = (ZUC_PDCP_JOB *)arg;
+	int n = job->count - i * job->per;
+
+	ZUC_PDCP_Run(job->pkt + i * job->per, n < job->per ? n : job->per);
+}
+
+/****************************************************************
+Function:         ZUC_PDCP_Batch
+Description:      EEA3 and/or EIA3 of a batch of PDCP packets
+Calls:            ZUC_PDCP_Run,ZUC_PoolRun
+Called By:        ZUC_SelfCheck
+Input:            pool             //worker pool of ZUC_PoolInit, NULL to run in the caller
+                  pkt[]            //packets, see ZUC_PDCP_PKT
+                  count            //the number of packets
+Output:           pkt[].buf        //ciphered in place with ZUC_PDCP_EEA3
+                  pkt[].MAC        //MAC with ZUC_PDCP_EIA3
+Return:           1 bad operation or length; 0 success
+Others:           the results equal those of ZUC_ConfidentialityBytes and
+                  ZUC_IntegrityBytes, with both operations the MAC is
+                  over the buffer as given, or as ciphered with
+                  ZUC_PDCP_MAC_OUT, in one pass. The packets are cut
+                  into one run per thread of the pool and the caller,
+                  each of at least ZUC_PDCP_MIN_PKTS packets.
+****************************************************************/
+int ZUC_PDCP_Batch(ZUC_POOL *pool, ZUC_PDCP_PKT pkt[], int count)
+{
+	ZUC_PDCP_JOB job;
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (pkt[i].op & ~(ZUC_PDCP_EEA3 | ZUC_PDCP_EIA3 | ZUC_PDCP_MAC_OUT) || pkt[i].LENGTH < 0)
+			return 1;
+
+	job.pkt = pkt;
+	job.count = count;
+	job.per = pool ? (count + pool->threads) / (pool->threads + 1) : count;
+	if (job.per < ZUC_PDCP_MIN_PKTS)
+		job.per = ZUC_PDCP_MIN_PKTS;
+	if (!pool || count <= job.per)
+		ZUC_PDCP_Run(pkt, count);
+	else
+		ZUC_PoolRun(pool, ZUC_PDCP_Task, &job, (count + job.per - 1) / job.per);
+	return 0;
+}
+
+/*
+ * ZUC-256, "The ZUC-256 Stream Cipher", 2018. The key is 256bit, the iv
+ * 25 bytes of which iv[17]..iv[24] hold 6 bits each. The constants d of
+ * key loading tell the key stream apart from the three tag sizes; the
+ * LFSR, F and the rest of the initialisation are those of ZUC.
+ */
+
+static const unsigned char ZUC256_D[4][16] = {
+		{0x22, 0x2F, 0x24, 0x2A, 0x6D, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x52, 0x10, 0x30},  //key stream
+		{0x22, 0x2F, 0x25, 0x2A, 0x6D, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x52, 0x10, 0x30},  //32bit MAC
+		{0x23, 0x2F, 0x24, 0x2A, 0x6D, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x52, 0x10, 0x30},  //64bit MAC
+		{0x23, 0x2F, 0x25, 0x2A, 0x6D, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x52, 0x10, 0x30}}; //128bit MAC
+
+//si = a||b||c||e with a 7bit b, in ZUC-256 key loading
+#define ZUC256_Link(a, b, c, e) (((unsigned int)(a) << 23) | ((unsigned int)(b) << 16) | ((unsigned int)(c) << 8) | (unsigned int)(e))
+
+/****************************************************************
+Function:          ZUC256_CtxLoad
+Description:       ZUC-256 key loading into a context
+Calls:
+Called By:         ZUC256_CtxInit,ZUC256_LoadStream
+Input:             k[]             //initial key,256bit
+                   iv[]            //initial iv,25 bytes, iv[17]..iv[24] 6bit
+                   taglen          //0 for the key stream, else 32,64 or 128
+Output:            ctx             //LFSR s0..s15 loaded, R1=R2=0
+Return:            null
+Others:
+****************************************************************/
+void ZUC256_CtxLoad(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[], int taglen)
+{
+	const unsigned char *d = ZUC256_D[taglen == 32 ? 1 : taglen == 64 ? 2 : taglen == 128 ? 3 : 0];
+	unsigned int *s = ctx->LFSR_S;
+
+	s[0] = ZUC256_Link(k[0], d[0], k[21], k[16]);
+	s[1] = ZUC256_Link(k[1], d[1], k[22], k[17]);
+	s[2] = ZUC256_Link(k[2], d[2], k[23], k[18]);
+	s[3] = ZUC256_Link(k[3], d[3], k[24], k[19]);
+	s[4] = ZUC256_Link(k[4], d[4], k[25], k[20]);
+	s[5] = ZUC256_Link(iv[0], d[5] | (iv[17] & 0x3f), k[5], k[26]);
+	s[6] = ZUC256_Link(iv[1], d[6] | (iv[18] & 0x3f), k[6], k[27]);
+	s[7] = ZUC256_Link(iv[10], d[7] | (iv[19] & 0x3f), k[7], iv[2]);
+	s[8] = ZUC256_Link(k[8], d[8] | (iv[20] & 0x3f), iv[3], iv[11]);
+	s[9] = ZUC256_Link(k[9], d[9] | (iv[21] & 0x3f), iv[12], iv[4]);
+	s[10] = ZUC256_Link(iv[5], d[10] | (iv[22] & 0x3f), k[10], k[28]);
+	s[11] = ZUC256_Link(k[11], d[11] | (iv[23] & 0x3f), iv[6], iv[13]);
+	s[12] = ZUC256_Link(k[12], d[12] | (iv[24] & 0x3f), iv[7], iv[14]);
+	s[13] = ZUC256_Link(k[13], d[13], iv[15], iv[8]);
+	s[14] = ZUC256_Link(k[14], d[14] | (k[31] >> 4), iv[16], iv[9]);
+	s[15] = ZUC256_Link(k[15], d[15] | (k[31] & 0x0f), k[30], k[29]);
+	ctx->F_R[0] = 0x00;
+	ctx->F_R[1] = 0x00;
+}
+
+/****************************************************************
+Function:          ZUC256_CtxInit
+Description:       initialise a ZUC-256 context
+Calls:             ZUC256_CtxLoad,ZUC_CtxStart
+Called By:         ZUC256_GenKeyStream,ZUC256_Confidentiality,
+                   ZUC256_Integrity
+Input:             k[]             //initial key,256bit
+                   iv[]            //initial iv,25 bytes
+                   taglen          //0 for the key stream, else 32,64 or 128
+Output:            ctx             //ZUC context, used with ZUC_CtxGenerate,ZUC_CtxXor
+Return:            null
+Others:
+****************************************************************/
+void ZUC256_CtxInit(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[], int taglen)
+{
+	ZUC256_CtxLoad(ctx, k, iv, taglen);
+	ZUC_CtxStart(ctx);
+}
+
+/****************************************************************
+Function:          ZUC256_GenKeyStream
+Description:       generate ZUC-256 key stream
+Calls:             ZUC256_CtxInit,ZUC_CtxGenerate
+Called By:         ZUC_SelfCheck
+Input:             k[]             //initial key,256bit
+                   iv[]            //initial iv,25 bytes
+                   KeyStreamLen    //the number of 32bit words
+Output:            KeyStream[]     //key stream
+Return:            null
+Others:
+****************************************************************/
+void ZUC256_GenKeyStream(unsigned char k[], unsigned char iv[], unsigned int KeyStream[], int KeyStreamLen)
+{
+	ZUC_CTX ctx;
+
+	ZUC256_CtxInit(&ctx, k, iv, 0);
+	ZUC_CtxGenerate(&ctx, KeyStream, KeyStreamLen);
+	memset(&ctx, 0, sizeof(ctx));
+}
+
+//key loading of ZUC_RunJobs for ZUC-256 key streams
+static void ZUC256_LoadStream(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[])
+{
+	ZUC256_CtxLoad(ctx, k, iv, 0);
+}
+
+/****************************************************************
+Function:          ZUC256_GenKeyStreams
+Description:       generate the ZUC-256 key streams of many key/iv pairs,
+                   16 (AVX-512) or 8 (AVX2) of them side by side
+Calls:             ZUC_RunJobs
+Called By:         ZUC_SelfCheck
+Input:             job[]           //256bit key, 25 byte iv, output and length of every key stream
+                   count           //the number of jobs
+Output:            job[].KeyStream //key streams
+Return:            null
+Others:
+****************************************************************/
+void ZUC256_GenKeyStreams(const ZUC_JOB job[], int count)
+{
+	ZUC_RunJobs(job, count, ZUC256_LoadStream);
+}
+
+/****************************************************************
+Function:         ZUC256_Confidentiality
+Description:      encryption with the ZUC-256 key stream
+Calls:            ZUC256_CtxInit,ZUC_CtxXor
+Called By:        ZUC_SelfCheck
+Input:            K[]              //key,256bit
+                  IV[]             //iv,25 bytes
+                  IBS[]            //input bit stream
+                  LENGTH           //the bit length of IBS
+Output:           OBS[]            //output bit stream, may be the same as IBS
+Return:           null
+Others:           bits of the last word past LENGTH are cleared, as in
+                  ZUC_Confidentiality
+****************************************************************/
+void ZUC256_Confidentiality(unsigned char K[], unsigned char IV[], unsigned int IBS[], int LENGTH, unsigned int OBS[])
+{
+	ZUC_CTX ctx;
+	int L = (LENGTH + 31) / 32, t = LENGTH % 32;
+
+	ZUC256_CtxInit(&ctx, K, IV, 0);
+	ZUC_CtxXor(&ctx, IBS, OBS, L);
+	if (t)
+		OBS[L - 1] = ((OBS[L - 1] >> (32 - t)) << (32 - t));
+	memset(&ctx, 0, sizeof(ctx));
+}
+
+/****************************************************************
+Function:       ZUC256_Mac
+Description:    the tag of n words from a fresh ZUC-256 context
+Calls:          ZUC_CtxGenerate,ZUC_EIA3Fetch,ZUC_EIA3ClmulSum,
+                ZUC_EIA3WordSum
+Called By:      ZUC256_Integrity
+Input:          ctx               //context initialised for a 32n bit tag
+                M[]               //message
+                LENGTH            //the bit length of M
+                n                 //1,2 or 4
+Output:         MAC[]             //tag, n words
+Return:         null
+Others:         with z the key stream bits and t=32n, the tag is
+                z[0..t) ^ z[t+i..2t+i) for every set bit i ^ z[t+L..2t+L).
+                Word j of the tag is the EIA3 correlation of the message
+                with the key stream from word n+j, one ZUC_EIA3ClmulSum
+                (or ZUC_EIA3WordSum) per chunk and tag word.
+****************************************************************/
+static void ZUC256_Mac(ZUC_CTX *ctx, const unsigned int M[], int LENGTH, int n, unsigned int MAC[])
+{
+	//k[j..j+c] are the windows of tag word j, read up to two words past the padded chunk
+	unsigned int k[ZUC_CHUNK + 6], W[ZUC_CHUNK], h = 0;
+	ZUC_EIA3_MSG msg = {M, NULL, 0, LENGTH, NULL};
+	int nw = (LENGTH + 31) / 32, r = LENGTH & 0x1f, clmul = 0;
+	int d, j, c;
+
+#ifdef ZUC_X86
+	clmul = ZUC_HAS_CLMUL();
+#endif
+	memset(k, 0, sizeof(k));
+	//the tag starts as the first n words, k[0..n] then follow them
+	ZUC_CtxGenerate(ctx, MAC, n);
+	ZUC_CtxGenerate(ctx, k, n + 1);
+	for (d = 0; d < nw; d += c)
+	{
+		c = nw - d < ZUC_CHUNK ? nw - d : ZUC_CHUNK;
+		ZUC_CtxGenerate(ctx, k + n + 1, c);
+		memset(W, 0, sizeof(W));
+		ZUC_EIA3Fetch(&msg, d, c, W);
+		for (j = 0; j < n; j++)
+#ifdef ZUC_X86
+			if (clmul)
+				MAC[j] ^= ZUC_EIA3ClmulSum(W, k + j, c);
+			else
+#endif
+				MAC[j] ^= ZUC_EIA3WordSum(W, k + j, c);
+		//h is the key word before the new k[0]
+		h = k[c - 1];
+		memmove(k, k + c, (n + 1) * sizeof(unsigned int));
+	}
+
+	//the window at bit LENGTH: k[j] when LENGTH is a multiple of 32, else
+	//r bits into the word pair that starts one word before k[j]
+	for (j = 0; j < n; j++)
+		MAC[j] ^= r ? ((j ? k[j - 1] : h) << r) | (k[j] >> (32 - r)) : k[j];
+
+	memset(k, 0, sizeof(k));
+	memset(W, 0, sizeof(W));
+	h = 0;
+}
+
+/****************************************************************
+Function:       ZUC256_Integrity
+Description:    the ZUC-256 MAC
+Calls:          ZUC256_CtxInit,ZUC256_Mac
+Called By:      ZUC_SelfCheck
+Input:          K[]               //key,256bit
+                IV[]              //iv,25 bytes
+                M[]               //message
+                LENGTH            //the bit length of M
+                taglen            //32,64 or 128
+Output:         MAC[]             //tag, taglen/32 words
+Return:         0:success
+                1:taglen is not 32,64 or 128
+Others:
+****************************************************************/
+int ZUC256_Integrity(unsigned char K[], unsigned char IV[], unsigned int M[], int LENGTH, int taglen, unsigned int MAC[])
+{
+	ZUC_CTX ctx;
+
+	if (taglen != 32 && taglen != 64 && taglen != 128)
+		return 1;
+	ZUC256_CtxInit(&ctx, K, IV, taglen);
+	ZUC256_Mac(&ctx, M, LENGTH, taglen / 32, MAC);
+	memset(&ctx, 0, sizeof(ctx));
+	return 0;
+}
+
+#ifdef ZUC_TRACE
+/****************************************************************
+Function:         ZUC_SetTrace
+Description:      install the callback reporting the intermediate state
+Calls:
+Called By:        main
+Input:            fn               //trace callback, NULL to switch tracing off
+                  arg              //first argument of fn
+Output:
+Return:           null
+Others:           only built with ZUC_TRACE defined; the callback is
+                  global, set it before any thread runs ZUC
+****************************************************************/
+void ZUC_SetTrace(ZUC_TRACE_FUNC fn, void *arg)
+{
+	ZUC_TraceFn = fn;
+	ZUC_TraceArg = arg;
+}
+
+/****************************************************************
+Function:         ZUC_TracePrint
+Description:      trace callback printing the LFSR after key loading and
+                  the LFSR and FSM after the initialisation to stdout
+Calls:
+Called By:        ZUC_TRACE_EVENT, installed by main through ZUC_SetTrace
+Input:            arg              //unused
+                  event            //ZUC_TRACE_LOAD,ZUC_TRACE_INIT,ZUC_TRACE_FINAL or ZUC_TRACE_WORK
+                  LFSR_S[]         //state of LFSR
+                  F_R[]            //R1,R2
+                  W                //output of F or key stream word
+Output:
+Return:           null
+Others:           only built with ZUC_TRACE defined
+****************************************************************/
+void ZUC_TracePrint(void *arg, int event, const unsigned int LFSR_S[16], const unsigned int F_R[2], unsigned int W)
+{
+	int i;
+
+	(void)arg;
+	(void)W;
+	if (event == ZUC_TRACE_LOAD)
+	{
+		printf("\ninitial state of LFSR: S[0]-S[15]\n");
+		for (i = 0; i < 16; i++)
+			printf("%08x     ", LFSR_S[i]);
+	}
+	else if (event == ZUC_TRACE_FINAL)
+	{
+		printf("\nstate of LFSR after executing initialization: S[0]-S[15]\n");
+		for (i = 0; i < 16; i++)
+			printf("%08x     ", LFSR_S[i]);
+		printf("\ninternal state of Finite State Machine:\n");
+		printf("R1=%08x\n", F_R[0]);
+		printf("R2=%08x\n", F_R[1]);
+	}
+}
+#endif
+
+/****************************************************************
+Function:         ZUC_SelfCheck
+Description:      Self-check with standard data
+Calls:            ZUC_Init,ZUC_Work,ZUC_GenKeyStream,ZUC_CtxInit,
+                  ZUC_CtxGenerate,ZUC_CtxXor,ZUC_EIA3Bit,ZUC_EIA3Word,ZUC_EIA3,
+                  ZUC_GenKeyStreams,ZUC_Confidentiality,ZUC_Integrity,
+                  ZUC_ConfidentialityBytes,ZUC_IntegrityBytes,
+                  ZUC_ConfidentialityIntegrityBytes,ZUC_PoolInit,ZUC_PDCP_Batch,
+                  ZUC_PoolFree,
+                  ZUC256_GenKeyStream,ZUC256_GenKeyStreams,
+                  ZUC256_Confidentiality,ZUC256_Integrity
 Called By:
 Input:
 Output:
@@ -617,6 +2496,23 @@ int ZUC_SelfCheck()
 #endif
 
 	unsigned int MAC;
+	unsigned int LongStream[40], Reference[40];
+	unsigned int LongState[16], BR_X[4], F_R[2];
+	unsigned int Streams[20][40];
+	unsigned char Bytes[164], Saved[164], Ciphered[164];
+	int j, n, b;
+	unsigned char Packets[64][40], Expected[64][40];
+	ZUC_PDCP_PKT pkt[64];
+	ZUC_POOL pool;
+	unsigned char Key256[32], IV256[25];
+	unsigned int Std_Keystream256[2] = {0x58d03ad6, 0x2e032ce2};
+	//tags of 32,64,128 bits one after the other
+	unsigned int Std_MAC256[2][7] = {
+			{0x9b972a74, 0x673e5499, 0x0034d38c, 0xd85e54bb, 0xcb960096, 0x7084c952, 0xa1654b26},
+			{0x8754f5cf, 0x130dc225, 0xe72240cc, 0xdf1e8307, 0xb31cc62b, 0xeca1ac6f, 0x8190c22f}};
+	unsigned int Message256[125], MAC256[4];
+	ZUC_JOB jobs[20];
+	ZUC_CTX ctx;
 	/**************** KeyStream generation testing ***************************/
 	ZUC_GenKeyStream(k, iv, Keystream, KeystreamLen);
 	for (i = 0; i < KeystreamLen; i++)
@@ -624,8 +2520,41 @@ int ZUC_SelfCheck()
 		printf("%s", "z = ");
 		printf("%08x\n", Keystream[i]);
 	}
-	if (memcmp(Keystream, Std_Keystream, KeystreamLen * 8))
+	if (memcmp(Keystream, Std_Keystream, KeystreamLen * sizeof(unsigned int)))
+		return 1;
+
+	//the unrolled ring gives the same key stream as the reference clock functions
+	ZUC_Init(k, iv, LongState, BR_X, F_R);
+	ZUC_Work(LongState, BR_X, F_R, LongStream, 40);
+	ZUC_GenKeyStream(k, iv, Reference, 40);
+	if (memcmp(LongStream, Reference, sizeof(Reference)))
+		return 1;
+
+	//a context gives the same key stream in pieces of any size
+	ZUC_CtxInit(&ctx, k, iv);
+	ZUC_CtxGenerate(&ctx, Keystream, 1);
+	ZUC_CtxXor(&ctx, LongStream + 1, LongStream + 1, 39);
+	if (Keystream[0] != Std_Keystream[0])
 		return 1;
+	for (i = 1; i < 40; i++)
+		if (LongStream[i])
+			return 1;
+
+	//key streams of different lengths side by side, keys and ivs taken from Reference
+	for (i = 0; i < 20; i++)
+	{
+		jobs[i].k = (unsigned char *)(Reference + i);
+		jobs[i].iv = (unsigned char *)(Reference + 20 - i);
+		jobs[i].KeyStream = Streams[i];
+		jobs[i].KeyStreamLen = 3 + (i * 7) % 38;
+	}
+	ZUC_GenKeyStreams(jobs, 20);
+	for (i = 0; i < 20; i++)
+	{
+		ZUC_GenKeyStream(jobs[i].k, jobs[i].iv, LongStream, jobs[i].KeyStreamLen);
+		if (memcmp(LongStream, Streams[i], jobs[i].KeyStreamLen * sizeof(unsigned int)))
+			return 1;
+	}
 
 	/**************** Confidentiality testing ***************************/
 	printf("\n****************confidentiality validation******************");
@@ -636,7 +2565,7 @@ int ZUC_SelfCheck()
 	printf("\nOBS:\n");
 	for (i = 0; i < (plainlen + 31) / 32; i++)
 		printf("%08x   ", cipher[i]);
-	if (memcmp(cipher, Std_cipher, (plainlen + 31) / 32))
+	if (memcmp(cipher, Std_cipher, (plainlen + 31) / 32 * sizeof(unsigned int)))
 		return 1;
 
 	/**************** Integrity testing ***************************/
@@ -646,10 +2575,139 @@ int ZUC_SelfCheck()
 	if (MAC != Std_MAC)
 		return 1;
 
+	//the word-at-a-time and the selected tag equal the bit loop for every length, Reference is the message
+	for (i = 0; i <= 40 * 32; i += i < 96 ? 1 : 37)
+	{
+		ZUC_CtxInit(&ctx, IK, iv);
+		MAC = ZUC_EIA3Bit(&ctx, Reference, i);
+		ZUC_CtxInit(&ctx, IK, iv);
+		if (ZUC_EIA3Word(&ctx, Reference, i) != MAC)
+			return 1;
+		ZUC_CtxInit(&ctx, IK, iv);
+		if (ZUC_EIA3(&ctx, Reference, i) != MAC)
+			return 1;
+	}
+
+	//byte buffers from bit offsets 0..15 agree with the word API, Reference is the bit stream;
+	//encrypting in place keeps the bits around the range
+	for (i = 0; i < 16; i++)
+		for (n = 0; n <= 40 * 32 - 32; n += n < 96 ? 7 : 263)
+		{
+			for (j = 0; j < (int)sizeof(Bytes); j++)
+				Bytes[j] = (unsigned char)(0xa5 ^ j);
+			for (j = 0; j < n; j++)
+			{
+				b = (Reference[j >> 5] >> (31 - (j & 31))) & 1;
+				Bytes[(i + j) >> 3] = (unsigned char)((Bytes[(i + j) >> 3] & ~(0x80 >> ((i + j) & 7))) | (b << (7 - ((i + j) & 7))));
+			}
+			memcpy(Saved, Bytes, sizeof(Bytes));
+			if (ZUC_IntegrityBytes(IK, counter, bear, direc, Bytes, i, n) != ZUC_Integrity(IK, counter, bear, direc, Reference, n))
+				return 1;
+			ZUC_Confidentiality(key, COUNT, BEARER, DIRECTION, Reference, n, LongStream);
+			ZUC_ConfidentialityBytes(key, COUNT, BEARER, DIRECTION, Bytes, Bytes, i, n);
+			for (j = 0; j < (int)sizeof(Bytes) * 8; j++)
+			{
+				if (j >= i && j < i + n)
+					b = (LongStream[(j - i) >> 5] >> (31 - ((j - i) & 31))) & 1;
+				else
+					b = (Saved[j >> 3] >> (7 - (j & 7))) & 1;
+				if (((Bytes[j >> 3] >> (7 - (j & 7))) & 1) != b)
+					return 1;
+			}
+
+			//one pass gives the same bytes, the MAC over the input in place or over the output
+			//written into another buffer, where only the bytes of the range are touched
+			memcpy(Ciphered, Bytes, sizeof(Bytes));
+			memcpy(Bytes, Saved, sizeof(Bytes));
+			MAC = ZUC_ConfidentialityIntegrityBytes(key, IK, COUNT, BEARER, DIRECTION, Bytes, Bytes, i, n, 0);
+			if (MAC != ZUC_IntegrityBytes(IK, COUNT, BEARER, DIRECTION, Saved, i, n) || memcmp(Bytes, Ciphered, sizeof(Bytes)))
+				return 1;
+			memset(Bytes, 0, sizeof(Bytes));
+			MAC = ZUC_ConfidentialityIntegrityBytes(key, IK, COUNT, BEARER, DIRECTION, Saved, Bytes, i, n, 1);
+			if (MAC != ZUC_IntegrityBytes(IK, COUNT, BEARER, DIRECTION, Ciphered, i, n) ||
+			    memcmp(Bytes + (i >> 3), Ciphered + (i >> 3), (i + n + 7) / 8 - (i >> 3)))
+				return 1;
+		}
+
+	//a batch of packets with every combination of operations, keys taken from Reference, on 3 threads
+	for (i = 0; i < 64; i++)
+	{
+		pkt[i].CK = (unsigned char *)Reference + 2 * i;
+		pkt[i].IK = (unsigned char *)Reference + 130 - 2 * i;
+		pkt[i].COUNT = 0x01000193 * i;
+		pkt[i].BEARER = (unsigned char)(i & 0x1f);
+		pkt[i].DIRECTION = (unsigned char)(i >> 5 & 1);
+		pkt[i].buf = Packets[i];
+		pkt[i].LENGTH = (i * 83) % 321;
+		pkt[i].op = i % 8;
+		for (j = 0; j < 40; j++)
+			Packets[i][j] = Expected[i][j] = (unsigned char)(i * 40 + j);
+	}
+	if (ZUC_PoolInit(&pool, 3))
+		return 1;
+	i = ZUC_PDCP_Batch(&pool, pkt, 64);
+	ZUC_PoolFree(&pool);
+	if (i)
+		return 1;
+	for (i = 0; i < 64; i++)
+	{
+		//ZUC_PDCP_MAC_OUT with both operations, the MAC after EEA3
+		b = pkt[i].op == (ZUC_PDCP_EEA3 | ZUC_PDCP_EIA3 | ZUC_PDCP_MAC_OUT);
+		if (pkt[i].op & ZUC_PDCP_EIA3 && !b &&
+		    pkt[i].MAC != ZUC_IntegrityBytes(pkt[i].IK, pkt[i].COUNT, pkt[i].BEARER, pkt[i].DIRECTION, Expected[i], 0, pkt[i].LENGTH))
+			return 1;
+		if (pkt[i].op & ZUC_PDCP_EEA3)
+			ZUC_ConfidentialityBytes(pkt[i].CK, pkt[i].COUNT, pkt[i].BEARER, pkt[i].DIRECTION, Expected[i], Expected[i], 0, pkt[i].LENGTH);
+		if (b && pkt[i].MAC != ZUC_IntegrityBytes(pkt[i].IK, pkt[i].COUNT, pkt[i].BEARER, pkt[i].DIRECTION, Expected[i], 0, pkt[i].LENGTH))
+			return 1;
+		if (memcmp(Packets[i], Expected[i], 40))
+			return 1;
+	}
+
+	/**************** ZUC-256 testing, all 0 key and iv ***************************/
+	memset(Key256, 0, sizeof(Key256));
+	memset(IV256, 0, sizeof(IV256));
+	ZUC256_GenKeyStream(Key256, IV256, Keystream, KeystreamLen);
+	if (memcmp(Keystream, Std_Keystream256, KeystreamLen * sizeof(unsigned int)))
+		return 1;
+	//400 bits of 0, then 4000 bits of 0x11
+	memset(Message256, 0, sizeof(Message256));
+	for (i = 0; i < 3; i++)
+		if (ZUC256_Integrity(Key256, IV256, Message256, 400, 32 << i, MAC256) ||
+		    memcmp(MAC256, Std_MAC256[0] + (1 << i) - 1, (1 << i) * sizeof(unsigned int)))
+			return 1;
+	memset(Message256, 0x11, sizeof(Message256));
+	for (i = 0; i < 3; i++)
+		if (ZUC256_Integrity(Key256, IV256, Message256, 4000, 32 << i, MAC256) ||
+		    memcmp(MAC256, Std_MAC256[1] + (1 << i) - 1, (1 << i) * sizeof(unsigned int)))
+			return 1;
+
+	//encryption and the key streams side by side agree with ZUC256_GenKeyStream
+	ZUC256_Confidentiality(Key256, IV256, Message256, 4000, Message256);
+	ZUC256_GenKeyStream(Key256, IV256, Streams[0], 40);
+	for (i = 0; i < 40; i++)
+		if ((Message256[i] ^ 0x11111111) != Streams[0][i])
+			return 1;
+	for (i = 0; i < 20; i++)
+	{
+		jobs[i].k = (unsigned char *)Message256 + 8 * i;
+		jobs[i].iv = (unsigned char *)Message256 + 200 - 8 * i;
+	}
+	ZUC256_GenKeyStreams(jobs, 20);
+	for (i = 0; i < 20; i++)
+	{
+		ZUC256_GenKeyStream(jobs[i].k, jobs[i].iv, LongStream, jobs[i].KeyStreamLen);
+		if (memcmp(LongStream, Streams[i], jobs[i].KeyStreamLen * sizeof(unsigned int)))
+			return 1;
+	}
+
 	return 0;
 }
 
 int main(void)
 {
+#ifdef ZUC_TRACE
+	ZUC_SetTrace(ZUC_TracePrint, NULL);
+#endif
 	return ZUC_SelfCheck();
 }
@@ -21,56 +21,125 @@ Function List:
 13.ZUC_GenKeyStream      // generate key stream
 14.ZUC_Confidentiality   // the ZUC-based confidentiality algorithm
 15.ZUC_Integrity         // the ZUC-based integrity algorithm
+16.ZUC_CtxInit           // initialise a ZUC context
+17.ZUC_CtxGenerate       // generate the next words of key stream
+18.ZUC_CtxXor            // xor the next key stream words into a buffer
+19.ZUC_SetTrace          // install the trace callback, ZUC_TRACE only
+20.ZUC_TracePrint        // trace callback printing the state, ZUC_TRACE only
+21.ZUC_EIA3Bit           // the tag of EIA3, one message bit at a time
+22.ZUC_EIA3Word          // the tag of EIA3, one message word at a time
+23.ZUC_EIA3              // the tag of EIA3, PCLMULQDQ when available
+24.ZUC_CtxLoad           // key loading into a context
+25.ZUC_GenKeyStreams     // key streams of many key/iv pairs side by side
+26.ZUC_CtxStart          // initialisation stage of a loaded context
+27.ZUC256_CtxLoad        // ZUC-256 key loading into a context
+28.ZUC256_CtxInit        // initialise a ZUC-256 context
+29.ZUC256_GenKeyStream   // generate ZUC-256 key stream
+30.ZUC256_GenKeyStreams  // ZUC-256 key streams side by side
+31.ZUC256_Confidentiality // the ZUC-256 encryption
+32.ZUC256_Integrity      // the ZUC-256 MAC of 32, 64 or 128 bits
+33.ZUC_CtxXorBytes       // xor the key stream into a bit range of bytes
+34.ZUC_EIA3Bytes         // the tag of EIA3 over a bit range of bytes
+35.ZUC_EEA3IV            // the iv of the confidentiality algorithm
+36.ZUC_EIA3IV            // the iv of the integrity algorithm
+37.ZUC_ConfidentialityBytes // the confidentiality algorithm over bytes
+38.ZUC_IntegrityBytes    // the integrity algorithm over bytes
+39.ZUC_PoolInit          // start a pool of worker threads
+40.ZUC_PoolFree          // stop a pool of worker threads
+41.ZUC_PoolRun           // run tasks on the pool and the caller
+42.ZUC_PDCP_Batch        // EEA3 and/or EIA3 of a batch of PDCP packets
+43.ZUC_EEA3EIA3Bytes     // EEA3 and EIA3 of a context pair in one pass
+44.ZUC_ConfidentialityIntegrityBytes // both algorithms over bytes in one pass
 **************************************************************************/
 
 #pragma once
 
-unsigned char ZUC_S0[256] = {
-		0x3e, 0x72, 0x5b, 0x47, 0xca, 0xe0, 0x00, 0x33, 0x04, 0xd1, 0x54, 0x98, 0x09, 0xb9, 0x6d, 0xcb,
-		0x7b, 0x1b, 0xf9, 0x32, 0xaf, 0x9d, 0x6a, 0xa5, 0xb8, 0x2d, 0xfc, 0x1d, 0x08, 0x53, 0x03, 0x90,
-		0x4d, 0x4e, 0x84, 0x99, 0xe4, 0xce, 0xd9, 0x91, 0xdd, 0xb6, 0x85, 0x48, 0x8b, 0x29, 0x6e, 0xac,
-		0xcd, 0xc1, 0xf8, 0x1e, 0x73, 0x43, 0x69, 0xc6, 0xb5, 0xbd, 0xfd, 0x39, 0x63, 0x20, 0xd4, 0x38,
-		0x76, 0x7d, 0xb2, 0xa7, 0xcf, 0xed, 0x57, 0xc5, 0xf3, 0x2c, 0xbb, 0x14, 0x21, 0x06, 0x55, 0x9b,
-		0xe3, 0xef, 0x5e, 0x31, 0x4f, 0x7f, 0x5a, 0xa4, 0x0d, 0x82, 0x51, 0x49, 0x5f, 0xba, 0x58, 0x1c,
-		0x4a, 0x16, 0xd5, 0x17, 0xa8, 0x92, 0x24, 0x1f, 0x8c, 0xff, 0xd8, 0xae, 0x2e, 0x01, 0xd3, 0xad,
-		0x3b, 0x4b, 0xda, 0x46, 0xeb, 0xc9, 0xde, 0x9a, 0x8f, 0x87, 0xd7, 0x3a, 0x80, 0x6f, 0x2f, 0xc8,
-		0xb1, 0xb4, 0x37, 0xf7, 0x0a, 0x22, 0x13, 0x28, 0x7c, 0xcc, 0x3c, 0x89, 0xc7, 0xc3, 0x96, 0x56,
-		0x07, 0xbf, 0x7e, 0xf0, 0x0b, 0x2b, 0x97, 0x52, 0x35, 0x41, 0x79, 0x61, 0xa6, 0x4c, 0x10, 0xfe,
-		0xbc, 0x26, 0x95, 0x88, 0x8a, 0xb0, 0xa3, 0xfb, 0xc0, 0x18, 0x94, 0xf2, 0xe1, 0xe5, 0xe9, 0x5d,
-		0xd0, 0xdc, 0x11, 0x66, 0x64, 0x5c, 0xec, 0x59, 0x42, 0x75, 0x12, 0xf5, 0x74, 0x9c, 0xaa, 0x23,
-		0x0e, 0x86, 0xab, 0xbe, 0x2a, 0x02, 0xe7, 0x67, 0xe6, 0x44, 0xa2, 0x6c, 0xc2, 0x93, 0x9f, 0xf1,
-		0xf6, 0xfa, 0x36, 0xd2, 0x50, 0x68, 0x9e, 0x62, 0x71, 0x15, 0x3d, 0xd6, 0x40, 0xc4, 0xe2, 0x0f,
-		0x8e, 0x83, 0x77, 0x6b, 0x25, 0x05, 0x3f, 0x0c, 0x30, 0xea, 0x70, 0xb7, 0xa1, 0xe8, 0xa9, 0x65,
-		0x8d, 0x27, 0x1a, 0xdb, 0x81, 0xb3, 0xa0, 0xf4, 0x45, 0x7a, 0x19, 0xdf, 0xee, 0x78, 0x34, 0x60};
-
-unsigned char ZUC_S1[256] = {
-		0x55, 0xc2, 0x63, 0x71, 0x3b, 0xc8, 0x47, 0x86, 0x9f, 0x3c, 0xda, 0x5b, 0x29, 0xaa, 0xfd, 0x77,
-		0x8c, 0xc5, 0x94, 0x0c, 0xa6, 0x1a, 0x13, 0x00, 0xe3, 0xa8, 0x16, 0x72, 0x40, 0xf9, 0xf8, 0x42,
-		0x44, 0x26, 0x68, 0x96, 0x81, 0xd9, 0x45, 0x3e, 0x10, 0x76, 0xc6, 0xa7, 0x8b, 0x39, 0x43, 0xe1,
-		0x3a, 0xb5, 0x56, 0x2a, 0xc0, 0x6d, 0xb3, 0x05, 0x22, 0x66, 0xbf, 0xdc, 0x0b, 0xfa, 0x62, 0x48,
-		0xdd, 0x20, 0x11, 0x06, 0x36, 0xc9, 0xc1, 0xcf, 0xf6, 0x27, 0x52, 0xbb, 0x69, 0xf5, 0xd4, 0x87,
-		0x7f, 0x84, 0x4c, 0xd2, 0x9c, 0x57, 0xa4, 0xbc, 0x4f, 0x9a, 0xdf, 0xfe, 0xd6, 0x8d, 0x7a, 0xeb,
-		0x2b, 0x53, 0xd8, 0x5c, 0xa1, 0x14, 0x17, 0xfb, 0x23, 0xd5, 0x7d, 0x30, 0x67, 0x73, 0x08, 0x09,
-		0xee, 0xb7, 0x70, 0x3f, 0x61, 0xb2, 0x19, 0x8e, 0x4e, 0xe5, 0x4b, 0x93, 0x8f, 0x5d, 0xdb, 0xa9,
-		0xad, 0xf1, 0xae, 0x2e, 0xcb, 0x0d, 0xfc, 0xf4, 0x2d, 0x46, 0x6e, 0x1d, 0x97, 0xe8, 0xd1, 0xe9,
-		0x4d, 0x37, 0xa5, 0x75, 0x5e, 0x83, 0x9e, 0xab, 0x82, 0x9d, 0xb9, 0x1c, 0xe0, 0xcd, 0x49, 0x89,
-		0x01, 0xb6, 0xbd, 0x58, 0x24, 0xa2, 0x5f, 0x38, 0x78, 0x99, 0x15, 0x90, 0x50, 0xb8, 0x95, 0xe4,
-		0xd0, 0x91, 0xc7, 0xce, 0xed, 0x0f, 0xb4, 0x6f, 0xa0, 0xcc, 0xf0, 0x02, 0x4a, 0x79, 0xc3, 0xde,
-		0xa3, 0xef, 0xea, 0x51, 0xe6, 0x6b, 0x18, 0xec, 0x1b, 0x2c, 0x80, 0xf7, 0x74, 0xe7, 0xff, 0x21,
-		0x5a, 0x6a, 0x54, 0x1e, 0x41, 0x31, 0x92, 0x35, 0xc4, 0x33, 0x07, 0x0a, 0xba, 0x7e, 0x0e, 0x34,
-		0x88, 0xb1, 0x98, 0x7c, 0xf3, 0x3d, 0x60, 0x6c, 0x7b, 0xca, 0xd3, 0x1f, 0x32, 0x65, 0x04, 0x28,
-		0x64, 0xbe, 0x85, 0x9b, 0x2f, 0x59, 0x8a, 0xd7, 0xb0, 0x25, 0xac, 0xaf, 0x12, 0x03, 0xe2, 0xf2};
+#include <pthread.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+//x86 SIMD kernels selected at run time
+#define ZUC_X86
+#endif
+
+extern unsigned char ZUC_S0[256];
+extern unsigned char ZUC_S1[256];
 //D value in key loading
-unsigned int ZUC_d[16] = {
-		0x44D7, 0x26BC, 0x626B, 0x135E, 0x5789, 0x35E2, 0x7135, 0x09AF,
-		0x4D78, 0x2F13, 0x6BC4, 0x1AF1, 0x5E26, 0x3C4D, 0x789A, 0x47AC};
+extern unsigned int ZUC_d[16];
 
 //rotate n bits to the left in a 32bit buffer
 #define ZUC_rotl32(x, k) (((x) << k) | ((x) >> (32 - k)))
 //si = ki di ivi,in key loading
 #define ZUC_LinkToS(a, b, c) (((unsigned int)(a) << 23) | ((unsigned int)(b) << 8) | (unsigned int)(c))
 
+//words of key stream generated per step of ZUC_CtxXor, kept on the stack
+#define ZUC_CHUNK 16
+
+//state of a running key stream generator
+typedef struct
+{
+	unsigned int LFSR_S[16]; //LFSR state s0,s1,s2,...s15
+	unsigned int F_R[2];     //R1,R2,variables of nonlinear function F
+} ZUC_CTX;
+
+//one key stream of ZUC_GenKeyStreams
+typedef struct
+{
+	unsigned char *k;        //initial key,128bit
+	unsigned char *iv;       //initial iv,128bit
+	unsigned int *KeyStream; //key stream to be outputed
+	int KeyStreamLen;        //the number of 32bit words
+} ZUC_JOB;
+
+//operations of a PDCP packet, EEA3 and EIA3 may be combined
+#define ZUC_PDCP_EEA3 1
+#define ZUC_PDCP_EIA3 2
+//with both, the MAC covers the buffer after EEA3 rather than before
+#define ZUC_PDCP_MAC_OUT 4
+
+//packets whose key streams are initialised side by side in ZUC_PDCP_Batch
+#define ZUC_PDCP_GROUP 16
+//fewest packets given to one thread
+#define ZUC_PDCP_MIN_PKTS 16
+
+#define ZUC_POOL_MAX_THREADS 64
+
+//worker threads kept from one ZUC_PDCP_Batch to the next
+typedef struct
+{
+	int threads;                    //worker threads, the caller works too
+	pthread_t tid[ZUC_POOL_MAX_THREADS];
+	pthread_mutex_t lock;
+	pthread_cond_t start, done;
+	void (*fn)(void *arg, int i);   //task function of the current batch
+	void *arg;
+	int next, count, pending;       //next task, tasks of the batch, tasks not finished
+	int quit;
+} ZUC_POOL;
+
+//one packet of ZUC_PDCP_Batch
+typedef struct
+{
+	unsigned char *CK;       //confidentiality key,128bit
+	unsigned char *IK;       //integrity key,128bit
+	unsigned int COUNT;      //32bit counter
+	unsigned char BEARER;    //5bit,bearing layer identification
+	unsigned char DIRECTION; //1bit
+	unsigned char *buf;      //bit stream, bit 0 is the most significant bit of buf[0]
+	int LENGTH;              //the bit length of the bit stream
+	int op;                  //ZUC_PDCP_EEA3 and/or ZUC_PDCP_EIA3, ZUC_PDCP_MAC_OUT
+	unsigned int MAC;        //message authentication code, output of EIA3
+} ZUC_PDCP_PKT;
+
+#ifdef ZUC_TRACE
+//events reported to the trace callback
+#define ZUC_TRACE_LOAD  0 //LFSR after key loading
+#define ZUC_TRACE_INIT  1 //after one clock of the initialisation stage, W is the output of F
+#define ZUC_TRACE_FINAL 2 //LFSR and R1,R2 at the end of the initialisation stage
+#define ZUC_TRACE_WORK  3 //after one clock of the working stage, W is the key stream word
+
+typedef void (*ZUC_TRACE_FUNC)(void *arg, int event, const unsigned int LFSR_S[16], const unsigned int F_R[2], unsigned int W);
+#endif
+
 unsigned int AddMod(unsigned int a, unsigned int b);
 unsigned int PowMod(unsigned int x, unsigned int k);
 unsigned int L1(unsigned int X);
@@ -86,4 +155,35 @@ void ZUC_Work(unsigned int LFSR_S[], unsigned int BR_X[], unsigned int F_R[], un
 void ZUC_GenKeyStream(unsigned char k[], unsigned char iv[], unsigned int KeyStream[], int KeyStreamLen);
 void ZUC_Confidentiality(unsigned char CK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned int IBS[], int LENGTH, unsigned int OBS[]);
 unsigned int ZUC_Integrity(unsigned char IK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned int M[], int LENGTH);
+void ZUC_CtxLoad(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[]);
+void ZUC_CtxInit(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[]);
+void ZUC_CtxGenerate(ZUC_CTX *ctx, unsigned int KeyStream[], int KeyStreamLen);
+void ZUC_CtxXor(ZUC_CTX *ctx, const unsigned int IBS[], unsigned int OBS[], int len);
+void ZUC_CtxXorBytes(ZUC_CTX *ctx, const unsigned char in[], unsigned char out[], int offset, int LENGTH);
+unsigned int ZUC_EIA3Bit(ZUC_CTX *ctx, unsigned int M[], int LENGTH);
+unsigned int ZUC_EIA3Word(ZUC_CTX *ctx, const unsigned int M[], int LENGTH);
+unsigned int ZUC_EIA3(ZUC_CTX *ctx, const unsigned int M[], int LENGTH);
+unsigned int ZUC_EIA3Bytes(ZUC_CTX *ctx, const unsigned char M[], int offset, int LENGTH);
+void ZUC_EEA3IV(unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned char iv[]);
+void ZUC_EIA3IV(unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, unsigned char iv[]);
+void ZUC_ConfidentialityBytes(unsigned char CK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, const unsigned char IBS[], unsigned char OBS[], int offset, int LENGTH);
+unsigned int ZUC_IntegrityBytes(unsigned char IK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, const unsigned char M[], int offset, int LENGTH);
+unsigned int ZUC_EEA3EIA3Bytes(ZUC_CTX *cctx, ZUC_CTX *ictx, const unsigned char in[], unsigned char out[], int offset, int LENGTH, int macout);
+unsigned int ZUC_ConfidentialityIntegrityBytes(unsigned char CK[], unsigned char IK[], unsigned int COUNT, unsigned char BEARER, unsigned char DIRECTION, const unsigned char IBS[], unsigned char OBS[], int offset, int LENGTH, int macout);
+void ZUC_GenKeyStreams(const ZUC_JOB job[], int count);
+int ZUC_PoolInit(ZUC_POOL *pool, int threads);
+void ZUC_PoolFree(ZUC_POOL *pool);
+void ZUC_PoolRun(ZUC_POOL *pool, void (*fn)(void *arg, int i), void *arg, int count);
+int ZUC_PDCP_Batch(ZUC_POOL *pool, ZUC_PDCP_PKT pkt[], int count);
+void ZUC_CtxStart(ZUC_CTX *ctx);
+void ZUC256_CtxLoad(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[], int taglen);
+void ZUC256_CtxInit(ZUC_CTX *ctx, unsigned char k[], unsigned char iv[], int taglen);
+void ZUC256_GenKeyStream(unsigned char k[], unsigned char iv[], unsigned int KeyStream[], int KeyStreamLen);
+void ZUC256_GenKeyStreams(const ZUC_JOB job[], int count);
+void ZUC256_Confidentiality(unsigned char K[], unsigned char IV[], unsigned int IBS[], int LENGTH, unsigned int OBS[]);
+int ZUC256_Integrity(unsigned char K[], unsigned char IV[], unsigned int M[], int LENGTH, int taglen, unsigned int MAC[]);
 int ZUC_SelfCheck();
+#ifdef ZUC_TRACE
+void ZUC_SetTrace(ZUC_TRACE_FUNC fn, void *arg);
+void ZUC_TracePrint(void *arg, int event, const unsigned int LFSR_S[16], const unsigned int F_R[2], unsigned int W);
+#endif